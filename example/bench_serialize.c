@@ -0,0 +1,204 @@
+/**
+ *  Serialization benchmark. Compares binson_serialize() with the same output
+ *  produced by binson_traverse() and per-node callback, the way it was done
+ *  before direct serializer was introduced. Both wide and deep trees are used
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "binson/binson.h"
+#include "common.h"
+
+#define BENCH_BUF_SIZE        (4*1024*1024)
+#define BENCH_ITERATIONS      200
+#define BENCH_WIDE_ITEMS      20000
+#define BENCH_DEEP_CHAINS     2000
+#define BENCH_DEEP_LEVELS     12
+
+/* \brief Callback writing single node, mirrors former binson_cb_dump()
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \param status binson_traverse_cb_status*
+ * \param param void*             binson_writer*
+ * \return binson_res
+ */
+static binson_res  cb_dump_legacy( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+{
+  binson_writer   *writer = (binson_writer *)param;
+  const char      *key = binson_node_get_key( node );
+  bool             closing = binson_traverse_get_dir( status ) == BINSON_TRAVERSE_DIR_UP;
+  bool             bval;
+  int64_t          ival;
+  double           dval;
+  char            *str;
+  uint8_t         *bytes;
+  binson_raw_size  size;
+
+  UNUSED(obj);
+
+  switch (binson_node_get_type( node ))
+  {
+    case BINSON_TYPE_OBJECT:
+      return closing? binson_writer_write_object_end( writer ) : binson_writer_write_object_begin( writer, key );
+
+    case BINSON_TYPE_ARRAY:
+      return closing? binson_writer_write_array_end( writer ) : binson_writer_write_array_begin( writer, key );
+
+    case BINSON_TYPE_BOOLEAN:
+      binson_node_get_boolean( node, &bval );
+      return binson_writer_write_boolean( writer, key, bval );
+
+    case BINSON_TYPE_INTEGER:
+      binson_node_get_integer( node, &ival );
+      return binson_writer_write_integer( writer, key, ival );
+
+    case BINSON_TYPE_DOUBLE:
+      binson_node_get_double( node, &dval );
+      return binson_writer_write_double( writer, key, dval );
+
+    case BINSON_TYPE_STRING:
+      binson_node_get_string( node, &str );
+      return binson_writer_write_str( writer, key, str );
+
+    case BINSON_TYPE_BYTES:
+      binson_node_get_bytes( node, &bytes, &size );
+      return binson_writer_write_bytes( writer, key, bytes, size );
+
+    default:
+      return BINSON_RES_ERROR_TYPE_UNKNOWN;
+  }
+}
+
+/* \brief Root OBJECT with lots of leaves
+ *
+ * \param ctx binson*
+ * \return void
+ */
+static void  gen_wide( binson *ctx )
+{
+  binson_node  *root = binson_get_root( ctx );
+  char          key[16];
+  int           i;
+
+  for (i = 0; i < BENCH_WIDE_ITEMS; i++)
+  {
+    sprintf( key, "k%05d", i );
+    if (i % 2)
+      binson_node_add_integer( ctx, root, key, NULL, i );
+    else
+      binson_node_add_str( ctx, root, key, NULL, "value" );
+  }
+}
+
+/* \brief ARRAY of long OBJECT chains with single leaf on each level
+ *
+ * \param ctx binson*
+ * \return void
+ */
+static void  gen_deep( binson *ctx )
+{
+  binson_node  *arr, *node;
+  int           i, j;
+
+  binson_node_add_array_empty( ctx, binson_get_root( ctx ), "chains", &arr );
+
+  for (i = 0; i < BENCH_DEEP_CHAINS; i++)
+  {
+    binson_node_add_object_empty( ctx, arr, NULL, &node );
+
+    for (j = 0; j < BENCH_DEEP_LEVELS; j++)
+    {
+      binson_node_add_integer( ctx, node, "i", NULL, j );
+      binson_node_add_object_empty( ctx, node, "o", &node );
+    }
+  }
+}
+
+/* \brief Serialize tree both ways, check output is the same and print timings
+ *
+ * \param name const char*
+ * \param ctx binson*
+ * \param writer binson_writer*
+ * \param io binson_io*
+ * \param ref uint8_t*
+ * \param buf uint8_t*
+ * \return int                   0 if outputs match
+ */
+static int  bench( const char *name, binson *ctx, binson_writer *writer, binson_io *io, uint8_t *ref, uint8_t *buf )
+{
+  binson_raw_size  size, ref_size, cnt;
+  clock_t          t0;
+  double           t_legacy, t_direct;
+  int              i;
+
+  t0 = clock();
+  for (i = 0; i < BENCH_ITERATIONS; i++)
+  {
+    binson_io_attach_bytebuf( io, ref, BENCH_BUF_SIZE );
+    binson_io_get_write_counter( io, &cnt );
+    binson_traverse( ctx, binson_get_root( ctx ), BINSON_TRAVERSE_BOTHORDER, BINSON_DEPTH_LIMIT, cb_dump_legacy, writer );
+  }
+  t_legacy = (double)(clock() - t0) / CLOCKS_PER_SEC;
+  binson_io_get_write_counter( io, &ref_size );
+  ref_size -= cnt;   /* counter is not reset by attach */
+
+  t0 = clock();
+  for (i = 0; i < BENCH_ITERATIONS; i++)
+  {
+    binson_io_attach_bytebuf( io, buf, BENCH_BUF_SIZE );
+    binson_serialize( ctx, writer, &size );
+  }
+  t_direct = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+  printf( "%-6s %8u bytes   traverse+callback: %7.3f s   binson_serialize: %7.3f s   speedup: %.2fx\n",
+          name, size, t_legacy, t_direct, t_direct > 0? t_legacy / t_direct : 0.0 );
+
+  if (size != ref_size || memcmp( ref, buf, size ))
+  {
+    printf( "%-6s output mismatch\n", name );
+    return 1;
+  }
+
+  return 0;
+}
+
+int main()
+{
+    binson          *context;
+    binson_writer   *writer;
+    binson_io       *io;
+    uint8_t         *ref, *buf;
+    int              fail = 0;
+
+    ref = (uint8_t *)malloc( BENCH_BUF_SIZE );
+    buf = (uint8_t *)malloc( BENCH_BUF_SIZE );
+
+    binson_io_new( &io );
+    binson_io_attach_bytebuf( io, buf, BENCH_BUF_SIZE );
+
+    binson_writer_new( &writer );
+    binson_writer_init( writer, io, BINSON_WRITER_FORMAT_RAW );
+
+    binson_new( &context );
+    binson_init( context, NULL );
+
+    gen_wide( context );
+    fail |= bench( "wide", context, writer, io, ref, buf );
+
+    binson_reset( context );
+    gen_deep( context );
+    fail |= bench( "deep", context, writer, io, ref, buf );
+
+    binson_free( context );
+    binson_writer_free( writer );
+    binson_io_free( io );
+
+    free( ref );
+    free( buf );
+
+    return fail;
+}
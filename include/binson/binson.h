@@ -91,6 +91,18 @@ typedef enum binson_traverse_dir
 
 } binson_traverse_dir;
 
+/**
+ *  Conflict resolution policy of binson_node_merge() and binson_node_bulk_commit(). Applies to
+ *  children with the same key, unless both are OBJECTs, which are merged recursively
+ */
+typedef enum binson_merge_policy
+{
+    BINSON_MERGE_OVERWRITE    = 0,   /**< Source child replaces destination one */
+    BINSON_MERGE_KEEP,               /**< Destination child stays as is */
+    BINSON_MERGE_ERROR               /**< Merge stops with \c BINSON_RES_ERROR_TREE_KEY_CONFLICT */
+
+} binson_merge_policy;
+
 /*
  *  General purpose binson library API calls
  */
@@ -98,14 +110,23 @@ uint32_t        binson_lib_get_version();
 bool            binson_lib_is_compatible();
 
 binson_res      binson_new( binson **pobj );
+binson_res      binson_new_with_allocator( binson **pobj, const binson_allocator *allocator );
 binson_res      binson_init( binson *obj, binson_io *error_io );
 binson_res      binson_free( binson *obj );
 binson_res      binson_reset( binson *obj );
+binson_res      binson_compact( binson *obj );
 
 /*
  *  Binson context getters/setters
  */
 binson_node*    binson_get_root( binson *obj );
+const binson_allocator*  binson_get_allocator( binson *obj );
+binson_res      binson_set_sorted_input( binson *obj, bool sorted );
+binson_res      binson_set_serialize_cache( binson *obj, bool enable );
+binson_res      binson_set_hash_cache( binson *obj, bool enable );
+binson_res      binson_set_limits( binson *obj, const binson_limits *limits );
+binson_res      binson_get_stats( binson *obj, binson_stats *stats );
+binson_res      binson_set_max_depth( binson *obj, binson_depth max_depth );
 
 /*
  *  Node/tree creation/removal
@@ -121,9 +142,20 @@ binson_res  binson_node_add_double( binson *obj, binson_node *parent, const char
 binson_res  binson_node_add_str( binson *obj, binson_node *parent, const char* key, binson_node **dst, const char* val );
 binson_res  binson_node_add_bytes( binson *obj, binson_node *parent, const char* key, binson_node **dst, uint8_t *src_ptr,  size_t src_size );
 
+binson_res  binson_node_add_str_take( binson *obj, binson_node *parent, const char* key, binson_node **dst, char* str );
+binson_res  binson_node_add_bytes_take( binson *obj, binson_node *parent, const char* key, binson_node **dst, uint8_t *src_ptr, size_t src_size );
+binson_res  binson_node_add_str_ref( binson *obj, binson_node *parent, const char* key, binson_node **dst, const char* str );
+binson_res  binson_node_add_bytes_ref( binson *obj, binson_node *parent, const char* key, binson_node **dst, const uint8_t *src_ptr, size_t src_size );
+binson_res  binson_node_take_string( binson *obj, binson_node *node, char **pstr );
+binson_res  binson_node_take_bytes( binson *obj, binson_node *node, uint8_t **ppbytes, size_t *psize );
+
 binson_res  binson_node_clone( binson *obj, binson_node *parent, binson_node **dst, binson_node *node, const char* new_key );
-binson_res  binson_node_clone_tree( binson *obj, binson_node *node, const char* new_key );  /* not implemented */
+binson_res  binson_node_clone_tree( binson *obj, binson_node *parent, binson_node **dst, binson_node *node, const char* new_key );
 binson_res  binson_node_remove( binson *obj, binson_node *node );
+binson_res  binson_node_merge( binson *obj, binson_node *dst, binson *src_obj, binson_node *src, binson_merge_policy policy );
+
+binson_res  binson_node_bulk_begin( binson *obj, binson_node *node );
+binson_res  binson_node_bulk_commit( binson *obj, binson_node *node, binson_merge_policy policy );
 binson_res  binson_node_remove_( binson *obj, binson_node *node );
 
 /*
@@ -137,11 +169,13 @@ binson_res  binson_deserialize( binson *obj, binson_parser *pparser, binson_node
  */
 binson_node_type      binson_node_get_type( binson_node *node );
 const char*           binson_node_get_key( binson_node *node );
+binson_res            binson_node_get_key_ref( binson_node *node, const char **pkey, binson_raw_size *plen );
 
 binson_res            binson_node_get_boolean( binson_node *node, bool *pbool );
 binson_res            binson_node_get_integer( binson_node *node, int64_t *pinteger );
 binson_res            binson_node_get_double( binson_node *node, double *pdouble );
 binson_res            binson_node_get_string( binson_node *node, char **ppstr );
+binson_res            binson_node_get_string_ref( binson_node *node, const char **ppstr, binson_raw_size *plen );
 binson_res            binson_node_get_bytes( binson_node *node, uint8_t **ppbytes, binson_raw_size *psize );
 
 bool                  binson_node_is_leaf_type( binson_node *node );
@@ -157,11 +191,34 @@ binson_node*    binson_node_get_first_sibling( binson_node *node );
 binson_node*    binson_node_get_last_sibling( binson_node *node );
 binson_node*    binson_node_get_first_child( binson_node *node );
 binson_node*    binson_node_get_last_child( binson_node *node );
+binson_res      binson_node_get_first_child_ex( binson_node *node, binson_node **pchild );
+binson_res      binson_node_get_last_child_ex( binson_node *node, binson_node **pchild );
 
-binson_res      binson_node_get_child_by_idx( );
+binson_res      binson_node_get_child_by_idx( binson *obj, binson_node *parent, binson_child_num idx, binson_node **pnode );
 binson_res      binson_node_get_child_by_key( binson *obj, binson_node *parent, const char *key, binson_node **pnode );
-binson_res      binson_node_get_sibling_count( );
-binson_res      binson_node_get_child_count( );
+binson_res      binson_node_get_children_by_keys( binson *obj, binson_node *parent, const char **keys, size_t key_cnt, binson_node **pnodes );
+binson_res      binson_node_get_sibling_count( binson_node *node, binson_child_num *pcnt );
+binson_res      binson_node_get_child_count( binson_node *node, binson_child_num *pcnt );
+
+/*
+ *  Subtree comparison
+ */
+binson_res      binson_node_hash( binson *obj, binson_node *node, uint64_t *phash );
+binson_res      binson_node_equal( binson_node *a, binson_node *b, bool *pequal );
+
+/*
+ *  Tree diff and patch. Patch is binson OBJECT, see binson_diff() for its layout
+ */
+typedef enum binson_patch_op
+{
+    BINSON_PATCH_OP_REMOVE    = 0,   /**< Remove node at path */
+    BINSON_PATCH_OP_ADD       = 1,   /**< Add new node at path. ARRAY item may be added at the end only */
+    BINSON_PATCH_OP_REPLACE   = 2    /**< Replace node at path */
+
+} binson_patch_op;
+
+binson_res      binson_diff( binson *from, binson *to, binson_writer *writer );
+binson_res      binson_patch_apply( binson *obj, binson_parser *parser );
 
 /*
  *  Binson tree traversal API calls
@@ -182,6 +239,32 @@ binson_res    binson_traverse_first( binson *obj, binson_node *root_node, binson
 binson_res    binson_traverse_next( binson_traverse_cb_status *status );
 bool          binson_traverse_is_done( binson_traverse_cb_status *status );
 binson_node*  binson_traverse_get_current_node( binson_traverse_cb_status *status );
+binson_traverse_dir  binson_traverse_get_dir( binson_traverse_cb_status *status );
+
+/*
+ *  Binson tree iteration API calls. Lightweight alternative to traversal:
+ *  no callbacks, no node copies, iteration may be abandoned at any step.
+ *  Iterator lives on caller's stack, its fields are private
+ */
+typedef struct binson_iter_
+{
+    binson                 *obj;
+    binson_node            *root_node;
+    binson_node            *node;       /* last reported node */
+    binson_node            *next;       /* 'node->next' saved when 'node' is fully processed */
+    binson_node            *parent;     /* 'node->parent' saved when 'node' is fully processed */
+    int                     depth;
+    int                     max_depth;
+    binson_traverse_method  t_method;
+    int                     state;
+
+} binson_iter;
+
+binson_res    binson_iter_init( binson_iter *it, binson *obj, binson_node *root_node, binson_traverse_method t_method, int max_depth );
+binson_res    binson_iter_next( binson_iter *it, binson_node **pnode );
+binson_res    binson_iter_skip_children( binson_iter *it );
+bool          binson_iter_is_closing( binson_iter *it );
+int           binson_iter_get_depth( binson_iter *it );
 
 #ifdef __cplusplus
 }
@@ -39,6 +39,8 @@
 #ifndef BINSON_COMMON_H_INCLUDED
 #define BINSON_COMMON_H_INCLUDED
 
+#include <stddef.h>
+
 #include "binson_config.h"
 #include "binson_error.h"
 
@@ -114,6 +116,43 @@ typedef union binson_raw_value {
 
 } binson_raw_value;
 
+/**
+ *  Memory allocator used by library objects for all their allocations. Each callback
+ *  gets 'param' as first argument. Either all callbacks or none are set. Objects keep
+ *  a copy of the struct. NULL allocator or one with no callbacks means malloc(), realloc()
+ *  and free()
+ */
+typedef struct binson_allocator {
+
+    void*     (*alloc_cb)( void *param, size_t size );
+    void*     (*realloc_cb)( void *param, void *ptr, size_t size );
+    void      (*free_cb)( void *param, void *ptr );
+    void       *param;
+
+} binson_allocator;
+
+/**
+ *  Resource ceilings of binson context or parser. Zero means no limit. Calls which
+ *  would exceed them fail with BINSON_RES_ERROR_LIMIT_EXCEEDED
+ */
+typedef struct binson_limits {
+
+    size_t             max_bytes;    /* live memory: DOM storage and adopted payloads, or parser's token buffer */
+    binson_raw_size    max_token;    /* STRING/BYTES payload size */
+    binson_size        max_nodes;    /* live DOM nodes, not used by parser */
+
+} binson_limits;
+
+/**
+ *  Resource usage of binson context or parser
+ */
+typedef struct binson_stats {
+
+    size_t             bytes;        /* live memory, as accounted by binson_limits.max_bytes */
+    binson_size        nodes;        /* live DOM nodes, always 0 for parser */
+
+} binson_stats;
+
 #ifdef __cplusplus
 }
 #endif
@@ -93,6 +93,7 @@ typedef enum binson_res_ {
 
     /* tree access errors */
     BINSON_RES_ERROR_TREE_OUT_OF_ARRAY  = 128,    /* unable to access ARRAY item specified */
+    BINSON_RES_ERROR_TREE_KEY_CONFLICT,           /* OBJECT already has child with the key */
 
     /* binson raw data input errors */
     BINSON_RES_ERROR_IO_EOF             = 256,
@@ -115,7 +116,8 @@ typedef enum binson_res_ {
     BINSON_RES_ERROR_NOT_SUPPORTED,       /* feature not supported in this binson model type or still not implemented in library */
     BINSON_RES_ERROR_OUT_OF_MEMORY,
     BINSON_RES_ERROR_BROKEN_INT_STRUCT,   /* internal structure consistency is broken */
-    BINSON_RES_ERROR_STREAM               /*  stream/file access or read/write error */
+    BINSON_RES_ERROR_STREAM,              /*  stream/file access or read/write error */
+    BINSON_RES_ERROR_LIMIT_EXCEEDED       /* configured memory, token size or node count limit hit, see binson_limits */
 
 } binson_res;
 
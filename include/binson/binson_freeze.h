@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2015 ASSA ABLOY AB
+ *
+ *  This file is part of binson-c, BINSON serialization format library in C.
+ *
+ *  binson-c is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License (LGPL) as published
+ *  by the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  As a special exception, the Contributors give you permission to link
+ *  this library with independent modules to produce an executable,
+ *  regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the
+ *  terms and conditions of the license of that module. An independent
+ *  module is a module which is not derived from or based on this library.
+ *  If you modify this library, you must extend this exception to your
+ *  version of the library.
+ *
+ *  binson-c is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/********************************************//**
+ * \file binson_freeze.h
+ * \brief Read-only flat DOM compiled from binson tree
+ *
+ ***********************************************/
+
+#ifndef BINSON_FREEZE_H_INCLUDED
+#define BINSON_FREEZE_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "binson_config.h"
+#include "binson_common.h"
+#include "binson_error.h"
+#include "binson.h"
+
+/*
+ *  Forward declarations
+ */
+typedef struct binson_frozen_        binson_frozen;
+typedef struct binson_frozen_node_   binson_frozen_node;
+
+/*
+ *  Freezing API calls
+ */
+binson_res            binson_freeze( binson *obj, binson_node *node, binson_frozen **pfrozen );
+binson_res            binson_frozen_free( binson_frozen *frozen );
+
+binson_frozen_node*   binson_frozen_get_root( binson_frozen *frozen );
+size_t                binson_frozen_get_size( binson_frozen *frozen );
+
+/*
+ *  Frozen node level getters. Mirror \c binson_node_get_* ones
+ */
+binson_node_type      binson_frozen_node_get_type( binson_frozen_node *node );
+const char*           binson_frozen_node_get_key( binson_frozen_node *node );
+binson_res            binson_frozen_node_get_key_ref( binson_frozen_node *node, const char **pkey, binson_raw_size *plen );
+
+binson_res            binson_frozen_node_get_boolean( binson_frozen_node *node, bool *pbool );
+binson_res            binson_frozen_node_get_integer( binson_frozen_node *node, int64_t *pinteger );
+binson_res            binson_frozen_node_get_double( binson_frozen_node *node, double *pdouble );
+binson_res            binson_frozen_node_get_string( binson_frozen_node *node, const char **ppstr );
+binson_res            binson_frozen_node_get_string_ref( binson_frozen_node *node, const char **ppstr, binson_raw_size *plen );
+binson_res            binson_frozen_node_get_bytes( binson_frozen_node *node, const uint8_t **ppbytes, binson_raw_size *psize );
+
+bool                  binson_frozen_node_is_leaf_type( binson_frozen_node *node );
+
+/*
+ *  Frozen tree level getters
+ */
+binson_frozen_node*   binson_frozen_node_get_parent( binson_frozen_node *node );
+binson_frozen_node*   binson_frozen_node_get_prev( binson_frozen_node *node );
+binson_frozen_node*   binson_frozen_node_get_next( binson_frozen_node *node );
+binson_frozen_node*   binson_frozen_node_get_first_child( binson_frozen_node *node );
+binson_frozen_node*   binson_frozen_node_get_last_child( binson_frozen_node *node );
+
+binson_res            binson_frozen_node_get_child_by_idx( binson_frozen_node *parent, binson_child_num idx, binson_frozen_node **pnode );
+binson_res            binson_frozen_node_get_child_by_key( binson_frozen_node *parent, const char *key, binson_frozen_node **pnode );
+binson_res            binson_frozen_node_get_child_count( binson_frozen_node *node, binson_child_num *pcnt );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BINSON_FREEZE_H_INCLUDED */
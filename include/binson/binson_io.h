@@ -43,6 +43,7 @@
 #include <stdarg.h>
 
 #include "binson_config.h"
+#include "binson_common.h"
 #include "binson_error.h"
 
 #ifdef __cplusplus
@@ -85,6 +86,7 @@ typedef enum {
  *  Binson IO abstraction layer API calls
  */
 binson_res  binson_io_new( binson_io **pio );
+binson_res  binson_io_new_with_allocator( binson_io **pio, const binson_allocator *allocator );
 binson_res  binson_io_init( binson_io *io );
 binson_res  binson_io_free( binson_io *io );
 
@@ -92,6 +94,8 @@ binson_res  binson_io_reset_counters( binson_io *io );
 binson_res  binson_io_get_read_counter( binson_io *io, binson_raw_size *pcnt );
 binson_res  binson_io_get_write_counter( binson_io *io, binson_raw_size *pcnt );
 binson_res  binson_io_seek( binson_io *io, binson_raw_size pos );
+binson_res  binson_io_get_buf_ptr( binson_io *io, uint8_t **pptr, size_t *pavail );
+binson_res  binson_io_skip( binson_io *io, size_t size );
 
 bool        binson_io_is_random( binson_io *io );
 
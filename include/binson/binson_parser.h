@@ -59,8 +59,10 @@ typedef struct binson_token_ref_  binson_token_ref;
  *  Binson parser mode enum type
  */
 typedef enum {
-  BINSON_PARSER_MODE_RAW    = 0,        /**< Raw mode. Serialized binson raw data used as underlying storage  */
-  BINSON_PARSER_MODE_SMART,             /**< Raw mode + some caching */
+  BINSON_PARSER_MODE_RAW    = 0,        /**< Raw mode. Serialized binson raw data used as underlying storage. Requires
+                                             \c BINSON_IO_TYPE_BUFFER source which must outlive DOM tree */
+  BINSON_PARSER_MODE_SMART,             /**< Raw mode + lazy parsing. OBJECT/ARRAY children are parsed on first access.
+                                             Requires \c BINSON_IO_TYPE_BUFFER source which must outlive DOM tree */
   BINSON_PARSER_MODE_DOM,               /**< Full DOM creation. Raw data not stored but reconstructed on binson_serialize() call */
   
   BINSON_PARSER_MODE_LAST               /* Enum terminator. Need for arg validation */
@@ -76,12 +78,17 @@ typedef binson_res (*binson_parser_cb)( binson_parser *parser, uint8_t token_cnt
  *  Binson parser API calls
  */
 binson_res  binson_parser_new( binson_parser **pparser );
+binson_res  binson_parser_new_with_allocator( binson_parser **pparser, const binson_allocator *allocator );
 binson_res  binson_parser_init( binson_parser *parser, binson_io *source, binson_parser_mode mode );
 binson_res  binson_parser_reset( binson_parser *parser );
 binson_res  binson_parser_free( binson_parser *parser );
 binson_res  binson_parser_set_io( binson_parser *parser, binson_io *source );
 binson_io*  binson_parser_get_io( binson_parser *parser );
 binson_res  binson_parser_set_mode( binson_parser *parser, binson_parser_mode mode );
+binson_parser_mode  binson_parser_get_mode( binson_parser *parser );
+binson_res  binson_parser_set_max_depth( binson_parser *parser, binson_depth max_depth );
+binson_res  binson_parser_set_limits( binson_parser *parser, const binson_limits *limits );
+binson_res  binson_parser_get_stats( binson_parser *parser, binson_stats *stats );
 
 binson_res  binson_parser_parse( binson_parser *parser, binson_parser_cb cb, void* param );
 binson_res  binson_parser_parse_first( binson_parser *parser, binson_parser_cb cb, void* param );
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2015 ASSA ABLOY AB
+ *
+ *  This file is part of binson-c, BINSON serialization format library in C.
+ *
+ *  binson-c is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License (LGPL) as published
+ *  by the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  As a special exception, the Contributors give you permission to link
+ *  this library with independent modules to produce an executable,
+ *  regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the
+ *  terms and conditions of the license of that module. An independent
+ *  module is a module which is not derived from or based on this library.
+ *  If you modify this library, you must extend this exception to your
+ *  version of the library.
+ *
+ *  binson-c is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/********************************************//**
+ * \file binson_path.h
+ * \brief Compiled path queries over binson DOM tree
+ *
+ ***********************************************/
+
+#ifndef BINSON_PATH_H_INCLUDED
+#define BINSON_PATH_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "binson_config.h"
+#include "binson_common.h"
+#include "binson_error.h"
+#include "binson.h"
+
+/*
+ *  Forward declarations
+ */
+typedef struct binson_path_   binson_path;
+
+/*
+ *  Path query API calls
+ *
+ *  Expression syntax:  device.sensors[12].reading
+ *    key         OBJECT child with given key. '\' escapes '.', '[', '\' and leading '*'.
+ *                Empty keys can not be addressed, "a..b" and "a." are syntax errors
+ *    *           any OBJECT child
+ *    [N]         ARRAY item with index N
+ *    [*]         any ARRAY item
+ *  Empty expression selects start node itself
+ */
+binson_res    binson_path_compile( const char *expr, binson_path **ppath );
+binson_res    binson_path_compile_with_allocator( const char *expr, binson_path **ppath, const binson_allocator *allocator );
+binson_res    binson_path_free( binson_path *path );
+size_t        binson_path_get_size( binson_path *path );
+
+binson_res    binson_path_eval( binson *obj, binson_path *path, binson_node *root, binson_node **pnode );
+binson_res    binson_path_eval_all( binson *obj, binson_path *path, binson_node *root, binson_node **nodes, size_t max_cnt, size_t *pcnt );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BINSON_PATH_H_INCLUDED */
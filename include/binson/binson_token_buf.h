@@ -56,6 +56,7 @@ typedef struct binson_token_buf_  binson_token_buf;
  *  Token buffer API calls
  */
 binson_res  binson_token_buf_new( binson_token_buf **ptbuf );
+binson_res  binson_token_buf_new_with_allocator( binson_token_buf **ptbuf, const binson_allocator *allocator );
 binson_res  binson_token_buf_init( binson_token_buf *tbuf, uint8_t *bptr, binson_raw_size bsize, binson_io *source );
 binson_res  binson_token_buf_reset( binson_token_buf *tbuf );
 binson_res  binson_token_buf_free( binson_token_buf *tbuf );
@@ -65,10 +66,14 @@ binson_res  binson_token_buf_set_io( binson_token_buf *tbuf, binson_io *source )
 binson_io*  binson_token_buf_get_io( binson_token_buf *tbuf  );
 binson_res  binson_token_buf_get_buf( binson_token_buf *tbuf, uint8_t **pbptr, binson_raw_size *pbsize );
 binson_res  binson_token_buf_set_buf( binson_token_buf *tbuf, uint8_t *bptr, binson_raw_size bsize );
+binson_res  binson_token_buf_set_limits( binson_token_buf *tbuf, const binson_limits *limits );
+binson_res  binson_token_buf_get_stats( binson_token_buf *tbuf, binson_stats *stats );
 
 binson_res  binson_token_buf_token_fill( binson_token_buf *tbuf, uint8_t *tok_count );
 binson_res  binson_token_buf_get_token_payload( binson_token_buf *tbuf, uint8_t tok_num, binson_raw_value *raw_val );
 binson_res  binson_token_buf_get_sig( binson_token_buf *tbuf, uint8_t tok_num, uint8_t *psig );
+binson_res  binson_token_buf_get_token_ptr( binson_token_buf *tbuf, uint8_t tok_num, uint8_t **pptr );
+binson_res  binson_token_buf_get_token_size( binson_token_buf *tbuf, uint8_t tok_num, binson_raw_size *pbsize );
 
 binson_res  binson_token_buf_get_node_type( binson_token_buf *tbuf, uint8_t tok_num, binson_node_type *pntype, bool *is_closing_token );
 
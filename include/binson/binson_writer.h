@@ -71,11 +71,14 @@ typedef enum {
  *  Binson/JSON low-level output API calls
  */
 binson_res  binson_writer_new( binson_writer **pwriter);
+binson_res  binson_writer_new_with_allocator( binson_writer **pwriter, const binson_allocator *allocator );
 binson_res  binson_writer_init( binson_writer *writer, binson_io *io, binson_writer_format format  );
 binson_res  binson_writer_free( binson_writer *writer );
 binson_res  binson_writer_set_format( binson_writer *writer, binson_writer_format format );
 binson_res  binson_writer_set_io( binson_writer *writer, binson_io *io );
 binson_io*  binson_writer_get_io( binson_writer *writer );
+binson_writer_format  binson_writer_get_format( binson_writer *writer );
+binson_res  binson_writer_set_max_depth( binson_writer *writer, binson_depth max_depth );
 
 binson_res  binson_writer_write_token( binson_writer *writer, binson_token_type token_type, const char* key, binson_value *val );
 
@@ -88,6 +91,7 @@ binson_res  binson_writer_write_integer( binson_writer *writer, const char* key,
 binson_res  binson_writer_write_double( binson_writer *writer, const char* key, double val );
 binson_res  binson_writer_write_str( binson_writer *writer, const char* key, const char* str );
 binson_res  binson_writer_write_bytes( binson_writer *writer, const char* key, uint8_t *src_ptr,  size_t src_size );
+binson_res  binson_writer_write_raw( binson_writer *writer, const uint8_t *src_ptr,  size_t src_size );
 
 #ifdef __cplusplus
 }
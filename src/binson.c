@@ -45,9 +45,11 @@
 #include "binson/binson_error.h"
 #include "binson/binson_io.h"
 #include "binson_util.h"
+#include "binson_arena.h"
 #include "binson/binson_writer.h"
 #include "binson/binson_parser.h"
 #include "binson/binson_token_buf.h"
+#include "binson_common_pvt.h"
 
 #define BINSON_VERSION_HEX    ((BINSON_MAJOR_VERSION << 16) |   \
                               (BINSON_MINOR_VERSION << 8)  |   \
@@ -59,8 +61,55 @@ typedef struct binson_ {
   binson_node     *root;
   binson_io       *error_io;
 
+  binson_arena    *arena;        /* storage for all nodes, keys and payloads of DOM tree */
+  binson_node     *free_nodes;   /* removed nodes ready for reuse, linked via 'next' */
+
+  bool             sorted_input; /* trust deserialized OBJECT keys are already sorted */
+  bool             serialize_cache; /* keep encoded copies of big containers, see binson_set_serialize_cache() */
+  bool             hash_cache;   /* keep structural hashes of big containers, see binson_set_hash_cache() */
+  bool             cache_used;   /* some container may have encoded copy or hash, so changes must drop it */
+  binson_size      shared;       /* number of registered clone links, see binson_node_share_add() */
+  binson_size      owned;        /* number of leaves holding adopted payloads, see binson_node_add_bytes_take() */
+  binson_allocator allocator;    /* used for context, arena blocks and adopted payloads, see binson_new_with_allocator() */
+  binson_limits    limits;       /* resource ceilings, see binson_set_limits() */
+  binson_size      nodes;        /* number of live nodes, including detached ones */
+  size_t           owned_size;   /* total size of adopted payloads */
+  binson_depth     max_depth;    /* see binson_set_max_depth() */
+
 } binson_;
 
+/* clone sharing container's children, registered in container's extension data */
+typedef struct binson_share_link_ {
+
+    binson_node                 *proxy;     /* stale if it is not BINSON_NODE_FLAG_SHARED clone of the container anymore */
+    struct binson_share_link_   *next;
+
+} binson_share_link;
+
+/* optional per-container data, allocated only for containers which need it */
+typedef struct binson_node_ext_ {
+
+    binson_node      **htab;       /* OBJECT's children hash index (open addressing), NULL if not built */
+    binson_size        hsize;      /* number of slots in 'htab', power of 2 */
+    binson_size        hused;      /* number of occupied slots */
+
+    binson_node      **cvec;       /* children pointers in sibling order, for indexed access */
+    binson_child_num   cvec_cap;   /* capacity of 'cvec' */
+    bool               cvec_valid; /* 'cvec' holds all 'child_cnt' children */
+
+    binson            *owner;      /* root only: context owning the tree, used by getters which have no context argument */
+
+    binson_share_link *proxies;    /* clones sharing children of this container */
+
+    uint8_t           *cache;      /* encoded container including own key, see binson_set_serialize_cache() */
+    binson_raw_size    cache_size; /* 0 if 'cache' is not valid */
+    binson_raw_size    cache_cap;  /* storage is reused when container is encoded again */
+
+    uint64_t           hash;       /* structural hash, see binson_node_hash() */
+    bool               hash_valid;
+
+} binson_node_ext;
+
 /* each node (both terminal and nonterminal) is 'binson_node' instance */
 typedef struct binson_node_ {
 
@@ -68,16 +117,66 @@ typedef struct binson_node_ {
     binson_node       *parent;
     binson_node       *prev;
     binson_node       *next;
-    binson_node       *first_child;
-    binson_node       *last_child;
 
-    /* payload */
+    union node_key
+    {
+        char          *ptr;
+        char           buf[sizeof(char *)];   /* short key with terminator, see BINSON_NODE_FLAG_KEY_INLINE */
+
+    } key;
+
+    /* containers have children, leaves have value, never both */
+    union node_data
+    {
+        struct node_container
+        {
+            binson_node       *first_child;
+            binson_node       *last_child;
+            binson_node_ext   *ext;
+
+        } c;
+
+        binson_value           val;
+
+        struct node_lazy                      /* see BINSON_NODE_FLAG_LAZY. Must not overlap 'c.ext' */
+        {
+            const uint8_t     *begin;         /* serialized container in parser's source buffer */
+            binson_raw_size    size;
+
+        } lazy;
+
+        struct node_share                     /* see BINSON_NODE_FLAG_SHARED. Must not overlap 'c.ext' */
+        {
+            binson_node       *src;           /* container whose children are shared */
+
+        } share;
+
+    } u;
+
+    binson_child_num   child_cnt;   /* always 0 for leaves */
     binson_node_type   type;
-    char              *key;
-    binson_value       val;
+    uint8_t            flags;       /* BINSON_NODE_FLAG_* bits */
+    uint8_t            val_len;     /* size of inline STRING/BYTES payload */
+    bool               lazy_sorted; /* binson_set_sorted_input() in effect when 'u.lazy' was parsed */
 
 } binson_node_;
 
+/* binson_node_ flags */
+#define BINSON_NODE_FLAG_KEY_INLINE   0x01    /* key is stored in 'key.buf' */
+#define BINSON_NODE_FLAG_VAL_INLINE   0x02    /* STRING/BYTES payload is stored in 'u.val' itself */
+#define BINSON_NODE_FLAG_KEY_RAW      0x04    /* 'key.ptr' refers to key's STRING token in parser's source buffer */
+#define BINSON_NODE_FLAG_VAL_RAW      0x08    /* 'u.val.bbuf_val.bptr' refers to value token in parser's source buffer */
+#define BINSON_NODE_FLAG_LAZY         0x10    /* container's children are not parsed yet, 'u.lazy' refers to serialized data */
+#define BINSON_NODE_FLAG_SHARED       0x20    /* container's children are not copied yet from 'u.share.src' */
+#define BINSON_NODE_FLAG_BULK         0x40    /* OBJECT's children are appended unsorted and not indexed, see binson_node_bulk_begin() */
+#define BINSON_NODE_FLAG_VAL_OWNED    0x80    /* 'u.val.bbuf_val.bptr' is buffer adopted from caller, freed with node by context's allocator */
+
+/* key, STRING and BYTES payload accessors aware of inline storage. Not valid for RAW references */
+#define BINSON_NODE_HAS_KEY(n)    (((n)->flags & BINSON_NODE_FLAG_KEY_INLINE) || (n)->key.ptr)
+#define BINSON_NODE_KEY(n)        (((n)->flags & BINSON_NODE_FLAG_KEY_INLINE)? (n)->key.buf : (n)->key.ptr)
+#define BINSON_NODE_VAL_PTR(n)    (((n)->flags & BINSON_NODE_FLAG_VAL_INLINE)? (uint8_t *)&(n)->u.val : (n)->u.val.bbuf_val.bptr)
+#define BINSON_NODE_VAL_SIZE(n)   (((n)->flags & BINSON_NODE_FLAG_VAL_INLINE)? (binson_raw_size)(n)->val_len : (n)->u.val.bbuf_val.bsize)
+
 /*
  *  Traversal status structure
  */
@@ -126,7 +225,6 @@ typedef struct binson_traverse_cb_param_
 
 } binson_traverse_cb_param_;
 
-
 /* used by binson_cb_build() callback */
 typedef struct binson_cb_build_param_
 {
@@ -138,12 +236,86 @@ typedef struct binson_cb_build_param_
 
 } binson_cb_build_param_;
 
+/* path step of binson_diff(). ARRAY items are addressed by index, OBJECT children by key */
+typedef struct binson_diff_step_
+{
+    binson                         *obj;          /* context owning 'node' */
+    binson_node                    *node;         /* keyed child, NULL for ARRAY item */
+    binson_child_num                idx;
+
+} binson_diff_step;
+
+/* used by binson_diff() */
+typedef struct binson_diff_ctx_
+{
+    binson                         *from;
+    binson                         *to;
+    binson_writer                  *writer;
+    bool                            use_hash;     /* both contexts keep hashes, so unchanged subtrees are not walked */
+
+    binson_diff_step               *path;
+    binson_diff_step                path_local[BINSON_DEPTH_STACK_SIZE];
+    size_t                          path_cap;
+    int                             depth;
+
+} binson_diff_ctx;
+
 /* private helper functions */
+binson_node*  binson_node_walk_next( binson_node *top, binson_node *node, bool descend );
+void        binson_node_relocate_size( binson_node *node, size_t *psize, size_t *pcnt );
+binson_res  binson_node_relocate( binson_arena *arena, binson_node *src, binson_node **dst );
+binson_res  binson_node_create( binson *obj, binson_node_type node_type, const char* key, size_t key_len, binson_node **dst );
+binson_res  binson_node_set_key( binson *obj, binson_node *node, const char* key, size_t key_len );
+void        binson_node_key_ref( binson_node *node, const char **pkey, binson_raw_size *plen );
+int         binson_node_key_cmp( binson_node *node, const char *key, binson_raw_size len );
+binson_res  binson_node_materialize( binson *obj, binson_node *node, uint8_t flags );
+binson*     binson_node_get_owner( binson_node *node );
+binson_res  binson_node_expand( binson *obj, binson_node *node );
+binson_res  binson_node_expand_shared( binson *obj, binson_node *node );
+binson_res  binson_node_expand_owned( binson_node *node );
+binson_res  binson_node_raw_scan( binson *obj, const uint8_t *ptr, binson_raw_size avail, binson_raw_size *psize );
+binson_res  binson_deserialize_lazy( binson *obj, binson_io *io, binson_node *parent, const char* key );
+binson_node_ext*  binson_node_ext_get( binson *obj, binson_node *node );
+binson_res  binson_node_index_build( binson *obj, binson_node *parent );
+binson_res  binson_node_share_body( binson *obj, binson_node *dst, binson_node *src );
+binson_res  binson_node_unshare( binson *obj, binson_node *node );
+binson_res  binson_node_unshare_path( binson *obj, binson_node *node );
+void        binson_node_cache_drop( binson *obj, binson_node *node );
+binson_res  binson_node_cache_store( binson *obj, binson_node *node, const uint8_t *src, binson_raw_size size );
+binson_res  binson_node_write( binson *obj, binson_writer *writer, binson_node *node, bool closing );
+binson_res  binson_serialize_close( binson *obj, binson_writer *writer, binson_node *node, const uint8_t *begin );
+binson_res  binson_serialize_tree( binson *obj, binson_writer *writer, binson_node *root, const char **root_key, bool use_cache );
+binson_res  binson_node_write_as( binson *obj, binson_writer *writer, binson_node *node, const char *key );
+binson_res  binson_node_write_value( binson_writer *writer, binson_node *node, const char *key, bool closing );
+uint64_t    binson_hash_bytes( uint64_t hash, const uint8_t *src, size_t size );
+uint64_t    binson_hash_mix( uint64_t hash );
+binson_res  binson_node_leaf_canon( binson_node *node, uint64_t *pval, uint8_t **ppbytes );
+binson_res  binson_node_hash_leaf( binson_node *node, uint64_t *phash );
+void        binson_node_hash_key( binson_node *child, uint64_t *phash );
+void        binson_node_hash_close( binson *obj, binson_node *node, uint64_t hash, uint64_t *phash );
+bool        binson_node_equal_leaf( binson_node *a, binson_node *b );
+binson_res  binson_diff_node( binson_diff_ctx *ctx, binson_node *a, binson_node *b );
+binson_res  binson_diff_emit( binson_diff_ctx *ctx, binson_patch_op op, binson_node *node );
+binson_res  binson_patch_apply_op( binson *obj, binson *patch, binson_node *op );
+binson_res  binson_node_copy_tree( binson *obj, binson_node *parent, const char *key, binson *src_obj, binson_node *src, binson_node **dst );
+binson_res  binson_node_move_before( binson *obj, binson_node *node, binson_node *before );
+binson_res  binson_node_merge_object( binson *obj, binson_node *dst, binson *src_obj, binson_node *src, binson_merge_policy policy, binson_depth depth );
+binson_node*  binson_node_sort_merge( binson_node *a, binson_node *b );
+void        binson_node_sort_children( binson_node *parent );
+void        binson_node_adopt_payload( binson *obj, binson_node *node, void *src, size_t size );
+binson_res  binson_node_borrow_payload( binson *obj, binson_node *node, const void *src, size_t size );
+binson_res  binson_node_take_payload( binson *obj, binson_node *node, binson_node_type type, uint8_t **pptr, size_t *psize );
+void        binson_free_owned( binson *obj );
+void        binson_limits_apply( binson *obj, binson_arena *arena );
+binson_res  binson_limits_check( binson *obj, size_t size, bool owned );
+binson_res  binson_no_memory( binson *obj );
 binson_res  binson_node_add_empty( binson *obj, binson_node *parent, binson_node_type node_type, const char* key, binson_node **dst );
-binson_res  binson_node_copy_val( binson_node_type node_type, binson_value *dst_val, binson_value *src_val );
-binson_res  binson_node_copy_val_from_raw( binson_node_type node_type, binson_value *dst_val, binson_raw_value *src_val );
+binson_res  binson_node_set_payload( binson *obj, binson_node *node, const void *src, size_t size );
+binson_res  binson_node_copy_val( binson *obj, binson_node *node, binson_value *src_val );
+binson_res  binson_node_copy_val_from_raw( binson *obj, binson_node *node, binson_raw_value *src_val );
 binson_res  binson_node_attach( binson *obj, binson_node *parent, binson_node *new_node );
 binson_res  binson_node_detach( binson *obj, binson_node *node );
+binson_res  binson_node_attach_last( binson *obj, binson_node *parent, binson_node *new_node );
 
 /* tree traversal iteration callbacks (iterators) */
 binson_res  binson_cb_lookup_key( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param );
@@ -181,13 +353,46 @@ bool  binson_lib_is_compatible()
  */
 binson_res  binson_new( binson **pobj )
 {
+  return binson_new_with_allocator( pobj, NULL );
+}
+
+/** \brief Creates new binson object which gets all its memory, including DOM tree storage,
+ *         from specified allocator
+ *
+ * \param pobj binson**
+ * \param allocator const binson_allocator*  NULL for malloc() and free()
+ * \return binson_res
+ */
+binson_res  binson_new_with_allocator( binson **pobj, const binson_allocator *allocator )
+{
+  binson_allocator  tmp;
+  binson_res        res;
+
   /* Initial parameter validation */
-  if (!pobj )
+  if (!pobj || !binson_common_allocator_set( &tmp, allocator ))
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *pobj = (binson *)malloc(sizeof(binson_));
+  *pobj = (binson *)binson_common_alloc( &tmp, sizeof(binson_) );
+  if (!*pobj)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
 
-  return BINSON_RES_OK;
+  (*pobj)->allocator = tmp;
+  memset( &(*pobj)->limits, 0, sizeof(binson_limits) );
+  (*pobj)->nodes      = 0;
+  (*pobj)->owned_size = 0;
+  (*pobj)->max_depth  = BINSON_DEPTH_LIMIT;
+
+  res = binson_arena_new_with_allocator( &(*pobj)->arena, allocator );
+  if (SUCCESS(res))
+    res = binson_arena_init( (*pobj)->arena, 0 );
+
+  if (FAILED(res))
+  {
+    binson_common_free( &tmp, *pobj );
+    *pobj = NULL;
+  }
+
+  return res;
 }
 
 /** \brief Initialize binson context object
@@ -201,6 +406,16 @@ binson_res  binson_init( binson *obj, binson_io *error_io )
 
   obj->root       = NULL;
   obj->error_io   = error_io;
+  obj->free_nodes = NULL;
+  obj->sorted_input = false;
+  obj->serialize_cache = false;
+  obj->hash_cache = false;
+  obj->cache_used = false;
+  obj->shared     = 0;
+  obj->owned      = 0;
+  obj->owned_size = 0;
+  obj->nodes      = 0;
+  binson_limits_apply( obj, obj->arena );
 
   res = binson_error_init( obj->error_io );
   if (FAILED(res)) return res;
@@ -224,16 +439,22 @@ binson_res  binson_reset( binson *obj )
   if (!obj)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  if (obj->root)
-  {
-    res = binson_node_remove( obj, obj->root );  
-    obj->root = NULL;
-  }
-  
+  binson_free_owned( obj );
+
+  /* whole tree lives in arena, so there is no need to visit nodes one by one */
+  res = binson_arena_reset( obj->arena );
+  obj->root       = NULL;
+  obj->free_nodes = NULL;
+  obj->nodes      = 0;
+  obj->shared     = 0;
+  obj->cache_used = false;
+  binson_limits_apply( obj, obj->arena );
+
   /* add empty root OBJECT */
-  res = binson_node_add_empty( obj, NULL, BINSON_TYPE_OBJECT, NULL, &(obj->root) );
-  
-  return res;  
+  if (SUCCESS(res))
+    res = binson_node_add_empty( obj, NULL, BINSON_TYPE_OBJECT, NULL, &(obj->root) );
+
+  return res;
 }
 
 /** \brief Free all memory used by binson object
@@ -243,1243 +464,4997 @@ binson_res  binson_reset( binson *obj )
  */
 binson_res  binson_free( binson *obj )
 {
-  binson_res res = BINSON_RES_OK;
+  binson_allocator  tmp;
+  binson_res        res = BINSON_RES_OK;
 
   /* Initial parameter validation */
   if (!obj)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  if (obj->root)
-    res = binson_node_remove( obj, obj->root );
+  binson_free_owned( obj );
 
-  if (obj)
-    free( obj );
+  /* releases all DOM tree nodes at once */
+  res = binson_arena_free( obj->arena );
+
+  tmp = obj->allocator;
+  binson_common_free( &tmp, obj );
 
   return res;
 }
 
 
-/* \brief Allocate storage and attach new empty node to binson DOM tree
+/** \brief Relocate whole DOM tree to new contiguous storage in depth-first order, so nodes, keys and
+ *         payloads visited one after another are neighbours in memory. Useful for long-lived trees
+ *         scanned many times after lots of changes
+ *
+ * All node pointers obtained before are invalid after successful call. Clones made by
+ * binson_node_clone_tree() get own children. Borrowed payloads, see binson_node_add_str_ref(),
+ * are copied, so caller's memory is not referred anymore. Adopted payloads and references
+ * to parser's source buffer are kept as is. On failure tree stays in old storage and node
+ * pointers remain valid, while clones may have got own children already
  *
  * \param obj binson*
- * \param parent binson_node*
- * \param node_type binson_node_type
- * \param key const char*
- * \param dst binson_node**
  * \return binson_res
  */
-binson_res  binson_node_add_empty( binson *obj, binson_node *parent, binson_node_type node_type, const char* key, binson_node **dst )
+binson_res  binson_compact( binson *obj )
 {
-  binson_res res = BINSON_RES_OK;
-  binson_node  *me;
+  binson_arena  *arena, *old;
+  binson_node   *src, *dst, *parent = NULL, *root = NULL;
+  size_t         size = 0, cnt = 0;
+  bool           owner;
+  binson_res     res;
 
-  /* arg's validation */
-  if (!obj || (!key && parent && (parent->type != BINSON_TYPE_ARRAY)))  /* missing key for non-array parent */
+  if (!obj)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-   me = (binson_node*) calloc(1, sizeof(binson_node));
+  if (!obj->root)
+    return BINSON_RES_OK;
 
-  if (!me)
-    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+  /* children of clones are copied first, so every node is reached from its parent only */
+  for (src = obj->root; src; src = binson_node_walk_next( obj->root, src, true ))
+    if (src->flags & BINSON_NODE_FLAG_SHARED)
+    {
+      res = binson_node_expand_shared( obj, src );
+      if (FAILED(res)) return res;
+    }
 
-  /* prepare our node structure */
-  me->type = node_type;
+  for (src = obj->root; src; src = binson_node_walk_next( obj->root, src, true ))
+    binson_node_relocate_size( src, &size, &cnt );
 
-   /* allocating and cloning key */
-   if (!parent || parent->type == BINSON_TYPE_ARRAY)  /* no keys for ARRAY children */
-   {
-     me->key = NULL;
-   }
-   else
-   {
-     me->key = (char*)malloc(strlen(key)+1);
-     strcpy(me->key, key);
-   }
+  res = binson_arena_new_with_allocator( &arena, &obj->allocator );
+  if (SUCCESS(res))
+    res = binson_arena_init( arena, 0 );
+  if (SUCCESS(res))
+  {
+    binson_limits_apply( obj, arena );
+    res = binson_arena_reserve( arena, size, cnt );
+    if (FAILED(res) && binson_arena_limit_hit( arena ))
+      res = BINSON_RES_ERROR_LIMIT_EXCEEDED;
+  }
+  if (FAILED(res))
+  {
+    binson_arena_free( arena );
+    return res;
+  }
 
-  binson_node_attach( obj, parent, me );
+  cnt = 0;
 
-  if (dst)
-   *dst = me;
+  /* 'parent' is always a copy of 'src->parent' */
+  for (src = obj->root; src; )
+  {
+    res = binson_node_relocate( arena, src, &dst );
+    if (FAILED(res))
+    {
+      binson_arena_free( arena );
+      return res;
+    }
+    cnt++;
 
-  return res;
-}
+    if (parent)
+    {
+      dst->parent = parent;
+      dst->prev   = parent->u.c.last_child;
 
-/* \brief Adds node with prefilled value in binson_value struct
- *
- * \param obj binson*
- * \param parent binson_node*
- * \param node_type binson_node_type
- * \param key const char*
- * \param dst binson_node**
- * \param tmp_val binson_value*
- * \return binson_res
- */
-binson_res  binson_node_add( binson *obj, binson_node *parent, binson_node_type node_type, const char* key, binson_node **dst, binson_value *tmp_val )
-{
-  binson_node  *node_ptr = NULL;
-  binson_res   res = binson_node_add_empty( obj, parent, node_type, key, &node_ptr );
+      if (parent->u.c.last_child)
+        parent->u.c.last_child->next = dst;
+      else
+        parent->u.c.first_child = dst;
 
-  if (!SUCCESS(res))
-    return res;
+      parent->u.c.last_child = dst;
+    }
+    else
+      root = dst;
 
-  if (dst)
-    *dst = node_ptr;
+    if (!binson_node_is_leaf_type( src ) && !(src->flags & BINSON_NODE_FLAG_LAZY) && src->u.c.first_child)
+    {
+      parent = dst;
+      src = src->u.c.first_child;
+      continue;
+    }
 
-  res = binson_node_copy_val( node_type, &(node_ptr->val), tmp_val );
+    while (src != obj->root && !src->next)
+    {
+      src = src->parent;
+      parent = parent->parent;
+    }
 
-  if (!SUCCESS(res))
+    src = (src == obj->root)? NULL : src->next;
+  }
+
+  owner = obj->root->u.c.ext && obj->root->u.c.ext->owner;
+
+  /* extensions of new tree go to new storage, old tree is kept in use till all of them are there */
+  old = obj->arena;
+  obj->arena = arena;
+
+  if (owner)
+  {
+    if (binson_node_ext_get( obj, root ))
+      root->u.c.ext->owner = obj;
+    else
+      res = binson_no_memory( obj );
+  }
+
+  /* hash indexes are rebuilt, children vectors are built on demand */
+  for (dst = root; dst && SUCCESS(res); dst = binson_node_walk_next( root, dst, true ))
+    if (dst->type == BINSON_TYPE_OBJECT && !(dst->flags & (BINSON_NODE_FLAG_LAZY | BINSON_NODE_FLAG_BULK)) &&
+        dst->child_cnt > BINSON_HASH_INDEX_THRESHOLD)
+      res = binson_node_index_build( obj, dst );
+
+  if (FAILED(res))
+  {
+    obj->arena = old;
+    binson_arena_free( arena );
     return res;
+  }
+
+  /* nothing refers to old storage anymore */
+  binson_arena_free( old );
+  obj->root       = root;
+  obj->free_nodes = NULL;
+  obj->nodes      = (binson_size)cnt;   /* detached nodes are gone too */
+  obj->shared     = 0;
+  obj->cache_used = false;
 
   return BINSON_RES_OK;
 }
 
-/* \brief Copy 'binson_value' structure, allocating memory for STRING and BYTES
+/* \brief Private helper. Next node of the subtree in depth-first order
  *
- * \param node_type binson_node_type
- * \param dst_val binson_value*
- * \param src_val binson_value*
- * \return binson_res
+ * \param top binson_node*        Subtree root
+ * \param node binson_node*
+ * \param descend bool            Visit node's children. Lazy and shared containers have none to visit
+ * \return binson_node*           NULL if subtree is done
+ */
+binson_node*  binson_node_walk_next( binson_node *top, binson_node *node, bool descend )
+{
+  if (descend && !binson_node_is_leaf_type( node ) && !(node->flags & (BINSON_NODE_FLAG_LAZY | BINSON_NODE_FLAG_SHARED)) &&
+      node->u.c.first_child)
+    return node->u.c.first_child;
+
+  while (node != top && !node->next)
+    node = node->parent;
+
+  return (node == top)? NULL : node->next;
+}
+
+/* \brief Private helper. Account storage needed by binson_node_relocate()
+ *
+ * \param node binson_node*
+ * \param psize size_t*           Incremented by number of bytes
+ * \param pcnt size_t*            Incremented by number of allocations
+ * \return void
  */
-binson_res  binson_node_copy_val( binson_node_type node_type, binson_value *dst_val, binson_value *src_val )
+void  binson_node_relocate_size( binson_node *node, size_t *psize, size_t *pcnt )
 {
-  size_t  sz = 0;
-  memcpy( dst_val, src_val, sizeof(binson_value) );
+  *psize += sizeof(binson_node);
+  (*pcnt)++;
 
-  if (node_type == BINSON_TYPE_STRING)
+  if (!(node->flags & (BINSON_NODE_FLAG_KEY_INLINE | BINSON_NODE_FLAG_KEY_RAW)) && node->key.ptr)
   {
-    sz = strlen(src_val->str_val)+1;
-    dst_val->str_val = (char*) malloc( sz );
-    BINSON_ASSERT( dst_val->str_val );
-    memcpy( dst_val->str_val, src_val->str_val, sz );
+    *psize += strlen( node->key.ptr ) + 1;
+    (*pcnt)++;
   }
-  else
-  if (node_type == BINSON_TYPE_BYTES)
+
+  if ((node->type == BINSON_TYPE_STRING || node->type == BINSON_TYPE_BYTES) &&
+      !(node->flags & (BINSON_NODE_FLAG_VAL_INLINE | BINSON_NODE_FLAG_VAL_RAW | BINSON_NODE_FLAG_VAL_OWNED)))
   {
-    sz = src_val->bbuf_val.bsize;
-    dst_val->bbuf_val.bptr = (uint8_t*) malloc( sz );
-    BINSON_ASSERT( dst_val->bbuf_val.bptr );
-    memcpy( dst_val->bbuf_val.bptr, src_val->bbuf_val.bptr, sz );
-    dst_val->bbuf_val.bsize = sz;
+    *psize += node->u.val.bbuf_val.bsize + 1;
+    (*pcnt)++;
   }
-
-  return BINSON_RES_OK;
 }
 
-/* \brief Translate 'binson_raw_value' structure to 'binson_value', converting raw strings
- *          to zero-terminated C-strings, automatically allocating memory required.
+/* \brief Private helper. Copy node with its key and payload to another arena. Navigation refs and
+ *         container's extension data are not copied
  *
- * \param node_type binson_node_type
- * \param dst_val binson_value*
- * \param src_val binson_value*
+ * \param arena binson_arena*
+ * \param src binson_node*        Node with no shared children
+ * \param dst binson_node**
  * \return binson_res
  */
-binson_res  binson_node_copy_val_from_raw( binson_node_type node_type, binson_value *dst_val, binson_raw_value *src_val )
+binson_res  binson_node_relocate( binson_arena *arena, binson_node *src, binson_node **dst )
 {
-  binson_res res = BINSON_RES_OK;
-
-  switch (node_type)
-  {
-    case BINSON_TYPE_BOOLEAN:
-      dst_val->bool_val = src_val->bool_val;  break;
+  binson_node  *me = (binson_node*) binson_arena_alloc( arena, sizeof(binson_node) );
 
-    case BINSON_TYPE_INTEGER:
-      dst_val->int_val = src_val->int_val;  break;
+  if (!me)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
 
-    case BINSON_TYPE_DOUBLE:
-      dst_val->double_val = src_val->double_val;  break;
+  *me = *src;
+  me->parent = NULL;
+  me->prev   = NULL;
+  me->next   = NULL;
 
-    case BINSON_TYPE_STRING:
-      dst_val->str_val = (char*) malloc( src_val->bbuf_val.bsize + 1 );  /* dst string will contain zero terminator */
-      BINSON_ASSERT( dst_val->str_val );
-      memcpy( dst_val->str_val, src_val->bbuf_val.bptr, src_val->bbuf_val.bsize );
-      dst_val->str_val[ src_val->bbuf_val.bsize ] = '\0';  /* string terminator */
-    break;
+  if (!binson_node_is_leaf_type( me ))
+  {
+    if (!(me->flags & BINSON_NODE_FLAG_LAZY))  /* lazy one keeps serialized data reference */
+    {
+      me->u.c.first_child = NULL;
+      me->u.c.last_child  = NULL;
+    }
+    me->u.c.ext = NULL;
+  }
 
-    case BINSON_TYPE_BYTES:
-      dst_val->bbuf_val.bptr = (uint8_t*) malloc( src_val->bbuf_val.bsize );
-      BINSON_ASSERT( dst_val->bbuf_val.bptr );
-      memcpy( dst_val->bbuf_val.bptr, src_val->bbuf_val.bptr, src_val->bbuf_val.bsize );
-      dst_val->bbuf_val.bsize = src_val->bbuf_val.bsize;
-    break;
+  if (!(me->flags & (BINSON_NODE_FLAG_KEY_INLINE | BINSON_NODE_FLAG_KEY_RAW)) && me->key.ptr)
+  {
+    me->key.ptr = (char*) binson_arena_memdup( arena, src->key.ptr, strlen( src->key.ptr ), true );
+    if (!me->key.ptr)
+      return BINSON_RES_ERROR_OUT_OF_MEMORY;
+  }
 
-    default:  /* skipping value copy for another node types are is not error case */
-    break;
+  if ((me->type == BINSON_TYPE_STRING || me->type == BINSON_TYPE_BYTES) &&
+      !(me->flags & (BINSON_NODE_FLAG_VAL_INLINE | BINSON_NODE_FLAG_VAL_RAW | BINSON_NODE_FLAG_VAL_OWNED)))
+  {
+    me->u.val.bbuf_val.bptr = (uint8_t*) binson_arena_memdup( arena, src->u.val.bbuf_val.bptr, src->u.val.bbuf_val.bsize,
+                                                              me->type == BINSON_TYPE_STRING );
+    if (!me->u.val.bbuf_val.bptr)
+      return BINSON_RES_ERROR_OUT_OF_MEMORY;
   }
 
-  return res;
+  *dst = me;
+
+  return BINSON_RES_OK;
 }
 
-/* \brief
+/* \brief Allocate storage for new detached empty node. Reuse previously removed node if possible
  *
  * \param obj binson*
- * \param parent binson_node*
- * \param new_node binson_node*
+ * \param node_type binson_node_type
+ * \param key const char*        Key bytes. Not required to be zero-terminated. Use NULL for no key.
+ * \param key_len size_t         Number of bytes in key
+ * \param dst binson_node**
  * \return binson_res
  */
-binson_res  binson_node_attach( binson *obj, binson_node *parent, binson_node *new_node )
+binson_res  binson_node_create( binson *obj, binson_node_type node_type, const char* key, size_t key_len, binson_node **dst )
 {
-  UNUSED(obj); 
-  
-  new_node->parent = parent;
-  new_node->next = NULL;
+  binson_node  *me;
 
-  /* connect new node to tree */
-  if (parent && parent->last_child)  /* parent is not empty */
+  if (obj->limits.max_nodes && obj->nodes >= obj->limits.max_nodes)
+    return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+  if (obj->free_nodes)
   {
-   binson_node  *pnode = parent->first_child;
+    me = obj->free_nodes;
+    obj->free_nodes = me->next;
+  }
+  else
+    me = (binson_node*) binson_arena_alloc( obj->arena, sizeof(binson_node) );
 
-   while (pnode)
-   {
-      if ( new_node->key && pnode->key && strcmp(new_node->key, pnode->key) < 0 )
-        break;
-      pnode = pnode->next;
-   };
+  if (!me)
+    return binson_no_memory( obj );
 
-   if (pnode)  /* insert before pnode */
-   {
-     new_node->prev    = pnode->prev;
-     new_node->next    = pnode;
-     if (pnode->prev)  /* insert non first - in-between */
-     {
-       pnode->prev->next = new_node;
-     }
-     else
-     {
-       parent->first_child = new_node;  /* insert as first item */
-     }
-
-     pnode->prev       = new_node;
-   }
-   else /* insert last */
-   {
-     new_node->prev = parent->last_child;
-     parent->last_child->next = new_node;
-     parent->last_child = new_node;
-   }
+  memset( me, 0, sizeof(binson_node) );
+  me->type = node_type;
+  obj->nodes++;
 
-  }
-  else /* parent is  empty */
-  {
-    new_node->prev = NULL;
-    if (parent)
-      parent->last_child = parent->first_child = new_node;
-  }
+  *dst = me;
 
-  return BINSON_RES_OK;
+  return key? binson_node_set_key( obj, me, key, key_len ) : BINSON_RES_OK;
 }
 
-/* \brief
+/* \brief Store node's key. Short keys are kept inside node itself, longer ones are copied to arena
  *
  * \param obj binson*
  * \param node binson_node*
+ * \param key const char*        Key bytes. Not required to be zero-terminated.
+ * \param key_len size_t         Number of bytes in key
  * \return binson_res
  */
-binson_res  binson_node_detach( binson *obj, binson_node *node )
+binson_res  binson_node_set_key( binson *obj, binson_node *node, const char* key, size_t key_len )
 {
-  if (!obj || !node)
-    return BINSON_RES_ERROR_ARG_WRONG;
-
-  if (node->parent && node->parent->last_child == node)
-    node->parent->last_child = NULL;
+  node->flags &= (uint8_t)~(BINSON_NODE_FLAG_KEY_INLINE | BINSON_NODE_FLAG_KEY_RAW);
 
-  if (node->parent && node->parent->first_child == node)
-    node->parent->first_child = NULL;
+  if (key_len < sizeof(node->key.buf))  /* short key fits into node itself */
+  {
+    memcpy( node->key.buf, key, key_len );
+    node->key.buf[key_len] = '\0';
+    node->flags |= BINSON_NODE_FLAG_KEY_INLINE;
+    return BINSON_RES_OK;
+  }
 
-  if (node->prev)
-    node->prev->next = node->next;
+  node->key.ptr = (char*) binson_arena_memdup( obj->arena, key, key_len, true );
 
-  if (node->next)
-    node->next->prev = node->prev;
+  return node->key.ptr? BINSON_RES_OK : binson_no_memory( obj );
+}
 
-  node->parent = NULL;
-  node->prev = NULL;
-  node->next = NULL;
+/* \brief Get node's key bytes and length, no matter where key is stored
+ *
+ * \param node binson_node*
+ * \param pkey const char**      Set to NULL if node has no key. Not zero-terminated for RAW references
+ * \param plen binson_raw_size*
+ * \return void
+ */
+void  binson_node_key_ref( binson_node *node, const char **pkey, binson_raw_size *plen )
+{
+  binson_raw_value  raw;
 
-  return BINSON_RES_OK;
+  if (node->flags & BINSON_NODE_FLAG_KEY_RAW)
+  {
+    binson_common_decode_token( (const uint8_t *)node->key.ptr, &raw );
+    *pkey = (const char *)raw.bbuf_val.bptr;
+    *plen = raw.bbuf_val.bsize;
+  }
+  else if (BINSON_NODE_HAS_KEY(node))
+  {
+    *pkey = BINSON_NODE_KEY(node);
+    *plen = (binson_raw_size)strlen( *pkey );
+  }
+  else
+  {
+    *pkey = NULL;
+    *plen = 0;
+  }
 }
 
-/* \brief Key lookup iterator (callback) to use with binson_traverse_*() functions
+/* \brief Compare node's key with specified one. Byte order gives the same result as strcmp() for UTF-8 strings
  *
- * \param obj binson*
  * \param node binson_node*
- * \param status binson_traverse_cb_status*
- * \param param void*
- * \return binson_res
+ * \param key const char*
+ * \param len binson_raw_size
+ * \return int                   <0, 0 or >0 if node's key is less, equal or greater
  */
-binson_res _binson_cb_lookup_key( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+int  binson_node_key_cmp( binson_node *node, const char *key, binson_raw_size len )
 {
-   binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
-   binson_child_num  requested_idx = p->in_param.idx;
+  const char       *nkey;
+  binson_raw_size   nlen;
+  int               cmp;
 
-   if (!obj || !node || !status || !param)
-    return BINSON_RES_ERROR_ARG_WRONG;
+  binson_node_key_ref( node, &nkey, &nlen );
 
-   if (status->child_num == requested_idx)
-   {
-     p->out_param.node = node;
-     status->done = true;  /* this force calling function to stop iterating; */
-   }
-   else
-     p->out_param.node = NULL;
+  cmp = memcmp( nkey, key, (nlen < len)? nlen : len );
+  if (cmp)
+    return cmp;
 
-   return BINSON_RES_OK;
+  return (nlen < len)? -1 : (nlen > len)? 1 : 0;
 }
 
-/* \brief Index lookup iterator (callback) to use with binson_traverse_*() functions
+/* \brief Replace node's references to parser's source buffer with own copies and decoded values
  *
  * \param obj binson*
  * \param node binson_node*
- * \param status binson_traverse_cb_status*
- * \param param void*
+ * \param flags uint8_t          BINSON_NODE_FLAG_KEY_RAW and/or BINSON_NODE_FLAG_VAL_RAW
  * \return binson_res
  */
-binson_res binson_cb_lookup_idx( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+binson_res  binson_node_materialize( binson *obj, binson_node *node, uint8_t flags )
 {
-   binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
-   const char *requested_key = p->in_param.key;
-
-   if (!obj || !node || !status || !param)
-    return BINSON_RES_ERROR_ARG_WRONG;
+  binson_res        res = BINSON_RES_OK;
+  binson_raw_value  raw;
+  const char       *key;
+  binson_raw_size   key_len;
 
+  flags &= node->flags;
 
-   if (!strcmp(requested_key, node->key))
-   {
-     p->out_param.node = node;
-     status->done = true;  /* this force calling function to stop iterating; */
-   }
-   else
-     p->out_param.node = NULL;
+  if (flags & BINSON_NODE_FLAG_KEY_RAW)
+  {
+    binson_node_key_ref( node, &key, &key_len );
+    res = binson_node_set_key( obj, node, key, key_len );
+    if (FAILED(res)) return res;
+  }
 
-   return BINSON_RES_OK;
+  if (flags & BINSON_NODE_FLAG_VAL_RAW)
+  {
+    binson_common_decode_token( node->u.val.bbuf_val.bptr, &raw );
+    node->flags &= (uint8_t)~BINSON_NODE_FLAG_VAL_RAW;
+    res = binson_node_copy_val_from_raw( obj, node, &raw );
+  }
+
+  return res;
 }
 
-/* \brief Node count iterator (callback) to use with binson_traverse_*() functions
+/* \brief Find context owning the tree node belongs to. Known for trees referring to parser's source buffer only
  *
- * \param obj binson*
  * \param node binson_node*
- * \param status binson_traverse_cb_status*
- * \param param void*
- * \return binson_res
+ * \return binson*
  */
-binson_res binson_cb_count( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+binson*  binson_node_get_owner( binson_node *node )
 {
-  binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
-
-   if (!obj || !node || !status || !param)
-    return BINSON_RES_ERROR_ARG_WRONG;
-
-  if (!status->done && status->current_node == status->root_node)  /* initialize counter in case of 1st iteration */
-    p->out_param.node_num = 0;
+  while (node->parent)
+    node = node->parent;
 
-  p->out_param.node_num++;
+  if (binson_node_is_leaf_type(node) || !node->u.c.ext)
+    return NULL;
 
-  return BINSON_RES_OK;
+  return node->u.c.ext->owner;
 }
 
-/* \brief Callback used to convert in-memory node to raw binson data or to it's JSON string representation
+/* \brief Private helper. Check serialized OBJECT/ARRAY is well-formed and find its size
  *
- * \param obj binson*
- * \param node binson_node*
- * \param status binson_traverse_cb_status*
- * \param param void*
+ * \param obj binson*             Gives max nesting depth and allocator for nesting stack
+ * \param ptr const uint8_t*      Container's begin signature
+ * \param avail binson_raw_size   Number of bytes available starting from \c ptr
+ * \param psize binson_raw_size*  Container size including end signature
  * \return binson_res
  */
-binson_res binson_cb_dump( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+binson_res  binson_node_raw_scan( binson *obj, const uint8_t *ptr, binson_raw_size avail, binson_raw_size *psize )
 {
-  binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
-  binson_res  res = BINSON_RES_OK;
+  uint8_t          local[BINSON_DEPTH_STACK_SIZE], *stack = local, *tmp;
+  size_t           cap = BINSON_DEPTH_STACK_SIZE;
+  binson_depth     depth = 0;
+  binson_raw_size  pos = 0, size;
+  uint8_t          sig;
+  bool             has_key = false;
+  binson_res       res = BINSON_RES_OK;
+
+  /* malformed input sets 'res' and leaves the loop */
+  do
+  {
+    if (pos >= avail)
+    {
+      res = BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+      continue;
+    }
 
-  if (!obj || !(p->in_param.writer) || !node || !status || !status->current_node )
-    return BINSON_RES_ERROR_ARG_WRONG;
+    sig = ptr[pos];
 
-  switch (node->type)
-  {
-    case BINSON_TYPE_OBJECT:
-      if (status->dir == BINSON_TRAVERSE_DIR_UP)
-        res = binson_writer_write_object_end( p->in_param.writer );
-      else
-        res = binson_writer_write_object_begin( p->in_param.writer, node->key );
-    break;
+    /* OBJECT items are key-value pairs */
+    if (depth && stack[depth-1] == BINSON_SIG_OBJ_BEGIN && sig != BINSON_SIG_OBJ_END)
+    {
+      size = (sig >= BINSON_SIG_STRING_8 && sig <= BINSON_SIG_STRING_32)? binson_common_token_size( ptr + pos, avail - pos ) : 0;
+      if (!size || pos + size >= avail)
+      {
+        res = BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+        continue;
+      }
 
-    case BINSON_TYPE_ARRAY:
-      if (status->dir == BINSON_TRAVERSE_DIR_UP)
-        res = binson_writer_write_array_end( p->in_param.writer );
-      else
-        res = binson_writer_write_array_begin( p->in_param.writer, node->key );
-    break;
+      pos += size;
+      sig = ptr[pos];
+      has_key = true;
+    }
 
-    case BINSON_TYPE_BOOLEAN:
-      res = binson_writer_write_boolean( p->in_param.writer, node->key, node->val.bool_val );
-    break;
+    switch (sig)
+    {
+      case BINSON_SIG_OBJ_BEGIN:
+      case BINSON_SIG_ARRAY_BEGIN:
+        if (depth >= obj->max_depth)
+        {
+          res = BINSON_RES_ERROR_LIMIT_EXCEEDED;
+          continue;
+        }
 
-    case BINSON_TYPE_INTEGER:
-      res = binson_writer_write_integer( p->in_param.writer, node->key, node->val.int_val );
-    break;
+        tmp = (uint8_t *)binson_common_stack_grow( &obj->allocator, stack, &cap, depth, sizeof(uint8_t), local );
+        if (!tmp)
+        {
+          res = BINSON_RES_ERROR_OUT_OF_MEMORY;
+          continue;
+        }
 
-    case BINSON_TYPE_DOUBLE:
-      res = binson_writer_write_double( p->in_param.writer, node->key, node->val.double_val );
-    break;
+        stack = tmp;
+        stack[depth++] = sig;
+        pos += BINSON_RAW_SIG_SIZE;
+      break;
 
-    case BINSON_TYPE_STRING:
-      res = binson_writer_write_str( p->in_param.writer, node->key, (const char*)(node->val.bbuf_val.bptr) );
-    break;
+      case BINSON_SIG_OBJ_END:
+      case BINSON_SIG_ARRAY_END:
+        if (!depth || has_key || stack[depth-1] + 1 != sig)  /* unbalanced or value missing */
+        {
+          res = BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+          continue;
+        }
 
-    case BINSON_TYPE_BYTES:
-      res = binson_writer_write_bytes( p->in_param.writer, node->key, node->val.bbuf_val.bptr, node->val.bbuf_val.bsize );
-    break;
+        depth--;
+        pos += BINSON_RAW_SIG_SIZE;
+      break;
 
-    case BINSON_TYPE_UNKNOWN:
-    default:
-      res = BINSON_RES_ERROR_TYPE_UNKNOWN;
-    break;
-  }
+      default:
+        size = depth? binson_common_token_size( ptr + pos, avail - pos ) : 0;  /* top level must be container */
+        if (!size)
+        {
+          res = BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+          continue;
+        }
+
+        pos += size;
+      break;
+    }
+
+    has_key = false;
+
+  } while (depth && res == BINSON_RES_OK);
+
+  binson_common_stack_free( &obj->allocator, stack, local );
+  *psize = pos;
 
   return res;
 }
 
-/* \brief Callback useful for debugging DOM tree traversal functionality
+/* \brief Private helper. Make container \c dst share children of \c src. Children are
+ *         copied on first access to \c dst or before \c src is changed
  *
- * \param
- * \param
- * \return
+ * \param obj binson*
+ * \param dst binson_node*       Empty container
+ * \param src binson_node*
+ * \return binson_res
  */
-#ifdef DEBUG
-binson_res  binson_node_dump_debug( binson *obj, binson_node *node )
+binson_res  binson_node_share_body( binson *obj, binson_node *dst, binson_node *src )
 {
-  const char* fmt = "[node=%p, type=%d, key=\"%s\", val=%x] : \n parent=%p, prev=%p, next=%p, fch=%p, lch=%p\n\n";
-  binson_io   *io;
+  binson_node_ext    *ext;
+  binson_share_link  *link;
 
-  if (obj)
+  /* unsorted children stay unsorted in the copy, so it needs own binson_node_bulk_commit() */
+  dst->flags |= (uint8_t)(src->flags & BINSON_NODE_FLAG_BULK);
+
+  if (src->flags & BINSON_NODE_FLAG_LAZY)  /* serialized data never changes, so it's shared as is */
   {
-    io = obj->error_io; /*binson_writer_get_io( obj->writer );*/
-    return binson_io_printf( io, fmt, node, node->type, node->key, node->val.int_val,
-                                      node->parent, node->prev, node->next, node->first_child, node->last_child );
+    dst->u.lazy = src->u.lazy;
+    dst->lazy_sorted = src->lazy_sorted;
+    dst->flags |= BINSON_NODE_FLAG_LAZY;
+    return BINSON_RES_OK;
   }
-  else
-    printf(fmt, node, node->type, node->key, node->val.int_val,
-                                      node->parent, node->prev, node->next, node->first_child, node->last_child );
-    
-  return BINSON_RES_OK;
-}
 
-binson_res  binson_cb_dump_debug( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
-{
-  binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
-  binson_res  res = BINSON_RES_OK;
-  binson_io   *io = obj->error_io; 
+  if (src->flags & BINSON_NODE_FLAG_SHARED)  /* clone of clone shares the same children */
+    src = src->u.share.src;
+  else if (!src->u.c.first_child)
+    return BINSON_RES_OK;
 
-  UNUSED(p);
-  UNUSED(res);
-  UNUSED(node);  
+  ext  = binson_node_ext_get( obj, src );
+  link = (binson_share_link *) binson_arena_alloc( obj->arena, sizeof(binson_share_link) );
+  if (!ext || !link || !binson_node_ext_get( obj, obj->root ))
+    return binson_no_memory( obj );
 
-  res = binson_io_printf( io, "-> #%02d, depth=%02d, dir=%02d : ", status->child_num, status->depth, status->dir );
-  return binson_node_dump_debug( obj, status->current_node );
+  link->proxy   = dst;
+  link->next    = ext->proxies;
+  ext->proxies  = link;
+  obj->shared++;
+
+  obj->root->u.c.ext->owner = obj;  /* clones are expanded by getters without context argument */
+
+  dst->u.share.src = src;
+  dst->flags |= BINSON_NODE_FLAG_SHARED;
+
+  return BINSON_RES_OK;
 }
-#endif
 
-/* \brief Callback used to node key against str key passed via param
+/* \brief Private helper. Copy children of container shared by clone. Keys and payloads are
+ *         not copied, nested containers are shared in turn
  *
  * \param obj binson*
  * \param node binson_node*
- * \param status binson_traverse_cb_status*
- * \param param void*
  * \return binson_res
  */
-binson_res binson_cb_key_compare( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+binson_res  binson_node_expand_shared( binson *obj, binson_node *node )
 {
-  binson_traverse_cb_param   *p = (binson_traverse_cb_param *)param;
+  binson_node  *src = node->u.share.src;
+  binson_node  *child, *me;
+  binson_res    res;
 
-  if (!obj || !node || !status || !param)
-    return BINSON_RES_ERROR_ARG_WRONG;
+  node->flags &= (uint8_t)~BINSON_NODE_FLAG_SHARED;
+  node->u.c.first_child = NULL;
+  node->u.c.last_child  = NULL;
+
+  for (child = src->u.c.first_child; child; child = child->next)
+  {
+    res = binson_node_create( obj, child->type, NULL, 0, &me );
+    if (FAILED(res)) return res;
+
+    /* arena keeps keys and payloads till reset and never changes them in place */
+    me->key   = child->key;
+    me->flags = (uint8_t)(child->flags & (BINSON_NODE_FLAG_KEY_INLINE | BINSON_NODE_FLAG_KEY_RAW));
+
+    if (child->flags & BINSON_NODE_FLAG_VAL_OWNED)  /* adopted buffer goes away with its node, so copy is needed */
+    {
+      res = binson_node_set_payload( obj, me, child->u.val.bbuf_val.bptr, child->u.val.bbuf_val.bsize );
+      if (FAILED(res)) return res;
+    }
+    else if (binson_node_is_leaf_type( child ))
+    {
+      me->u.val   = child->u.val;
+      me->val_len = child->val_len;
+      me->flags  |= (uint8_t)(child->flags & (BINSON_NODE_FLAG_VAL_INLINE | BINSON_NODE_FLAG_VAL_RAW));
+    }
+    else
+    {
+      res = binson_node_share_body( obj, me, child );
+      if (FAILED(res)) return res;
+    }
 
-  p->out_param.cmp_res = strcmp(node->key, p->in_param.key);  /* is ok for UTF-8 strings since strcmp() preserves lexicographic order */
+    res = binson_node_attach_last( obj, node, me );  /* source is ordered already */
+    if (FAILED(res)) return res;
+  }
 
   return BINSON_RES_OK;
 }
 
-/* \brief Callback used free node value's memory and finally node itself
+/* \brief Private helper. Copy children to all clones sharing them, so container can be changed
  *
  * \param obj binson*
  * \param node binson_node*
- * \param status binson_traverse_cb_status*
- * \param param void*
  * \return binson_res
  */
-binson_res binson_cb_remove( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+binson_res  binson_node_unshare( binson *obj, binson_node *node )
 {
-  binson_traverse_cb_param   *p = (binson_traverse_cb_param *)param;
-  UNUSED(p);
-  UNUSED(status);
+  binson_share_link  *link;
+  binson_res          res;
 
-/*binson_cb_dump_debug( obj, node, status, param);*/
+  if (binson_node_is_leaf_type( node ) || (node->flags & (BINSON_NODE_FLAG_LAZY | BINSON_NODE_FLAG_SHARED)) ||
+      !node->u.c.ext || !node->u.c.ext->proxies)
+    return BINSON_RES_OK;
 
-  if (!obj)
-    return BINSON_RES_ERROR_ARG_WRONG;
+  link = node->u.c.ext->proxies;
+  node->u.c.ext->proxies = NULL;
 
-  /* frees node's key memory */
-  if (node->key)
+  for (; link; link = link->next)
   {
-    free(node->key);
-    node->key = NULL;
-  }
+    obj->shared--;
 
-  /* frees node's value memory */
-  if (node->type == BINSON_TYPE_STRING && node->val.str_val)
-  {
-    free( node->val.str_val );
-    node->val.str_val = NULL;
-  }
-  else
-  if (node->type == BINSON_TYPE_BYTES && node->val.bbuf_val.bptr)
-  {
-    free( node->val.bbuf_val.bptr );
-    node->val.bbuf_val.bptr = NULL;
-  }
+    if (!(link->proxy->flags & BINSON_NODE_FLAG_SHARED) || link->proxy->u.share.src != node)
+      continue;
 
-  /* frees node itself */
-  free(node);
+    res = binson_node_expand_shared( obj, link->proxy );
+    if (FAILED(res)) return res;
+  }
 
   return BINSON_RES_OK;
 }
 
-/** \brief Creates empty OBJECT node and connects it to specified parent
+/* \brief Private helper. Make sure changes of container are not visible in clones. Containers are
+ *         processed top-down, since copying children of a container makes its children shared
  *
  * \param obj binson*
- * \param parent binson_node*
- * \param key const char*
- * \param dst binson_node**
+ * \param node binson_node*       Container going to be changed
  * \return binson_res
  */
-binson_res  binson_node_add_object_empty( binson *obj, binson_node *parent, const char* key, binson_node **dst )
+binson_res  binson_node_unshare_path( binson *obj, binson_node *node )
 {
-  return  binson_node_add_empty( obj, parent, BINSON_TYPE_OBJECT, key, dst );
+  binson_node  *cur, *top;
+  binson_res    res;
+
+  while (obj->shared)
+  {
+    for (top = NULL, cur = node; cur; cur = cur->parent)
+      if (!binson_node_is_leaf_type( cur ) && cur->u.c.ext && cur->u.c.ext->proxies)
+        top = cur;
+
+    if (!top)
+      break;
+
+    res = binson_node_unshare( obj, top );
+    if (FAILED(res)) return res;
+  }
+
+  return BINSON_RES_OK;
 }
 
-/** \brief Creates BOOLEAN node and connects it to specified parent
+/* \brief Private helper. Drop encoded copies and hashes of the container and all its ancestors. Called
+ *         before any change of the subtree
  *
  * \param obj binson*
- * \param parent binson_node*
- * \param key const char*
- * \param dst binson_node**
- * \param val bool
- * \return binson_res
+ * \param node binson_node*
+ * \return void
  */
-binson_res  binson_node_add_boolean( binson *obj, binson_node *parent, const char* key, binson_node **dst, bool val )
+void  binson_node_cache_drop( binson *obj, binson_node *node )
 {
-  binson_value  tmp_val;
+  if (!obj->cache_used)
+    return;
 
-  tmp_val.bool_val = val;
-  return binson_node_add( obj, parent, BINSON_TYPE_BOOLEAN, key, dst, &tmp_val );
+  for (; node; node = node->parent)
+    if (node->u.c.ext)
+    {
+      node->u.c.ext->cache_size = 0;
+      node->u.c.ext->hash_valid = false;
+    }
 }
 
-/** \brief Creates INTEGER node and connects it to specified parent
+/* \brief Private helper. Keep copy of container's encoding, so next binson_serialize() writes
+ *         it at once. Storage grows twice at least, so repeated changes don't exhaust arena
  *
  * \param obj binson*
- * \param parent binson_node*
- * \param key const char*
- * \param dst binson_node**
- * \param val int64_t
+ * \param node binson_node*
+ * \param src const uint8_t*
+ * \param size binson_raw_size
  * \return binson_res
  */
-binson_res  binson_node_add_integer( binson *obj, binson_node *parent,  const char* key, binson_node **dst, int64_t val )
+binson_res  binson_node_cache_store( binson *obj, binson_node *node, const uint8_t *src, binson_raw_size size )
 {
-  binson_value  tmp_val;
+  binson_node_ext  *ext = binson_node_ext_get( obj, node );
 
-  tmp_val.int_val = val;
-  return binson_node_add( obj, parent, BINSON_TYPE_INTEGER, key, dst, &tmp_val );
+  if (!ext)
+    return binson_no_memory( obj );
+
+  if (ext->cache_cap < size)
+  {
+    ext->cache_cap = (ext->cache_cap && size < 2 * ext->cache_cap)? 2 * ext->cache_cap : size;
+    ext->cache     = (uint8_t *) binson_arena_alloc( obj->arena, ext->cache_cap );
+
+    if (!ext->cache)
+    {
+      ext->cache_cap = 0;
+      return binson_no_memory( obj );
+    }
+  }
+
+  memcpy( ext->cache, src, size );
+  ext->cache_size = size;
+  obj->cache_used = true;
+
+  return BINSON_RES_OK;
 }
 
-/** \brief Creates DOUBLE node and connects it to specified parent
+/* \brief Private helper. Parse children of lazy container. Keys and values refer to parser's
+ *         source buffer, nested containers become lazy ones. On failure children parsed so far
+ *         are released and container stays lazy
  *
  * \param obj binson*
- * \param key binson_node *parentconst char*
- * \param dst binson_node**
- * \param val double
+ * \param node binson_node*
  * \return binson_res
  */
-binson_res  binson_node_add_double( binson *obj, binson_node *parent, const char* key, binson_node **dst, double val )
+binson_res  binson_node_expand( binson *obj, binson_node *node )
 {
-  binson_value  tmp_val;
+  const uint8_t    *begin, *ptr, *end, *key_tok;
+  binson_node      *child;
+  binson_node_type  type;
+  binson_raw_value  raw;
+  binson_raw_size   size, lazy_size;
+  binson_res        res = BINSON_RES_OK;
+  bool              closing;
 
-  tmp_val.double_val = val;
-  return binson_node_add( obj, parent, BINSON_TYPE_DOUBLE, key, dst, &tmp_val );
-}
+  if (node->flags & BINSON_NODE_FLAG_SHARED)
+    return binson_node_expand_shared( obj, node );
 
-/** \brief Creates STRING node and connects it to specified parent
- *
- * \param
- * \param
- * \return
- */
-binson_res  binson_node_add_str( binson *obj, binson_node *parent, const char* key, binson_node **dst, const char* val )
-{
-  binson_value  tmp_val;
+  if (!(node->flags & BINSON_NODE_FLAG_LAZY))
+    return BINSON_RES_OK;
 
-  tmp_val.str_val = (char *)val;
-  return binson_node_add( obj, parent, BINSON_TYPE_STRING, key, dst, &tmp_val );
+  begin     = node->u.lazy.begin;
+  lazy_size = node->u.lazy.size;
+
+  ptr = begin + BINSON_RAW_SIG_SIZE;
+  end = begin + lazy_size - BINSON_RAW_SIG_SIZE;   /* end signature */
+
+  node->flags &= (uint8_t)~BINSON_NODE_FLAG_LAZY;
+  node->u.c.first_child = NULL;
+  node->u.c.last_child  = NULL;
+  child = NULL;
+
+  /* range is validated by binson_node_raw_scan() already */
+  while (ptr < end)
+  {
+    key_tok = NULL;
+    if (node->type == BINSON_TYPE_OBJECT)
+    {
+      key_tok = ptr;
+      ptr += binson_common_decode_token( ptr, NULL );
+    }
+
+    type = binson_common_map_sig_to_node_type( *ptr, &closing );
+
+    res = binson_node_create( obj, type, NULL, 0, &child );
+    if (FAILED(res))
+    {
+      child = NULL;
+      break;
+    }
+
+    if (key_tok)
+    {
+      child->key.ptr = (char*)key_tok;
+      child->flags |= BINSON_NODE_FLAG_KEY_RAW;
+    }
+
+    if (type == BINSON_TYPE_OBJECT || type == BINSON_TYPE_ARRAY)
+    {
+      res = binson_node_raw_scan( obj, ptr, (binson_raw_size)(end - ptr), &size );
+      if (FAILED(res)) break;
+
+      child->u.lazy.begin = ptr;
+      child->u.lazy.size  = size;
+      child->lazy_sorted  = node->lazy_sorted;
+      child->flags |= BINSON_NODE_FLAG_LAZY;
+    }
+    else if (type == BINSON_TYPE_BOOLEAN)
+    {
+      size = binson_common_decode_token( ptr, &raw );
+      child->u.val.bool_val = raw.bool_val;
+    }
+    else
+    {
+      size = binson_common_decode_token( ptr, NULL );
+      child->u.val.bbuf_val.bptr = (uint8_t *)ptr;
+      child->flags |= BINSON_NODE_FLAG_VAL_RAW;
+    }
+
+    ptr += size;
+
+    /* child is linked even if indexing fails */
+    if (node->lazy_sorted)
+      res = binson_node_attach_last( obj, node, child );
+    else
+      res = binson_node_attach( obj, node, child );
+
+    child = NULL;
+    if (FAILED(res)) break;
+  }
+
+  if (res == BINSON_RES_OK)
+    return BINSON_RES_OK;
+
+  /* roll back, so next access parses container again */
+  if (child)
+    binson_cb_remove( obj, child, NULL, NULL );
+
+  while (node->u.c.last_child)
+  {
+    child = node->u.c.last_child;
+    binson_node_detach( obj, child );
+    binson_cb_remove( obj, child, NULL, NULL );
+  }
+
+  if (node->u.c.ext)
+    node->u.c.ext->cvec_valid = false;
+
+  node->u.lazy.begin = begin;
+  node->u.lazy.size  = lazy_size;
+  node->flags |= BINSON_NODE_FLAG_LAZY;
+
+  return res;
 }
 
-/** \brief Creates BYTES node and connects it to specified parent
+/* \brief Allocate storage and attach new empty node to binson DOM tree
  *
  * \param obj binson*
  * \param parent binson_node*
+ * \param node_type binson_node_type
  * \param key const char*
  * \param dst binson_node**
- * \param src_ptr uint8_t
- * \param src_size size_t
  * \return binson_res
  */
-binson_res  binson_node_add_bytes( binson *obj, binson_node *parent, const char* key, binson_node **dst, uint8_t *src_ptr,  size_t src_size )
+binson_res  binson_node_add_empty( binson *obj, binson_node *parent, binson_node_type node_type, const char* key, binson_node **dst )
 {
-  binson_value  tmp_val;
+  binson_res res = BINSON_RES_OK;
+  binson_node  *me;
 
-  tmp_val.bbuf_val.bptr   = src_ptr;
-  tmp_val.bbuf_val.bsize  = src_size;
-  return binson_node_add( obj, parent, BINSON_TYPE_BYTES, key, dst, &tmp_val );
+  /* arg's validation */
+  if (!obj || (!key && parent && (parent->type != BINSON_TYPE_ARRAY)))  /* missing key for non-array parent */
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  /* no keys for ARRAY children */
+  if (!parent || parent->type == BINSON_TYPE_ARRAY)
+    key = NULL;
+
+  if (parent)
+  {
+    res = binson_node_unshare_path( obj, parent );
+    if (FAILED(res)) return res;
+
+    res = binson_node_expand( obj, parent );
+    if (FAILED(res)) return res;
+
+    binson_node_cache_drop( obj, parent );
+  }
+
+  res = binson_node_create( obj, node_type, key, key? strlen(key) : 0, &me );
+  if (FAILED(res)) return res;
+
+  res = binson_node_attach( obj, parent, me );
+  if (FAILED(res)) return res;
+
+  if (dst)
+   *dst = me;
+
+  return res;
 }
 
-/** \brief Add new node which is a copy of specified node
+/* \brief Adds node with prefilled value in binson_value struct
  *
  * \param obj binson*
  * \param parent binson_node*
+ * \param node_type binson_node_type
+ * \param key const char*
  * \param dst binson_node**
- * \param node binson_node*
- * \param new_key const char*
+ * \param tmp_val binson_value*
  * \return binson_res
  */
-binson_res  binson_node_clone( binson *obj, binson_node *parent, binson_node **dst, binson_node *node, const char* new_key )
+binson_res  binson_node_add( binson *obj, binson_node *parent, binson_node_type node_type, const char* key, binson_node **dst, binson_value *tmp_val )
 {
-  return  binson_node_add( obj, parent, node->type, new_key, dst, &node->val );
+  binson_node  *node_ptr = NULL;
+  binson_res   res = BINSON_RES_OK;
+
+  /* don't leave empty node behind if payload is refused */
+  if (node_type == BINSON_TYPE_STRING && tmp_val && tmp_val->str_val)
+    res = binson_limits_check( obj, strlen( tmp_val->str_val ), false );
+  else if (node_type == BINSON_TYPE_BYTES && tmp_val)
+    res = binson_limits_check( obj, tmp_val->bbuf_val.bsize, false );
+
+  if (SUCCESS(res))
+    res = binson_node_add_empty( obj, parent, node_type, key, &node_ptr );
+
+  if (!SUCCESS(res))
+    return res;
+
+  if (dst)
+    *dst = node_ptr;
+
+  /* containers have no value, their storage is occupied by children refs */
+  if (binson_node_is_leaf_type( node_ptr ))
+    res = binson_node_copy_val( obj, node_ptr, tmp_val );
+
+  if (!SUCCESS(res))
+  {
+    /* node without payload is not valid, so it goes too */
+    binson_node_remove( obj, node_ptr );
+    if (dst)
+      *dst = NULL;
+    return res;
+  }
+
+  return BINSON_RES_OK;
 }
 
-/** \brief Creates empty ARRAY node and connects it to specified parent
+/* \brief Store STRING/BYTES payload of the node. Short payloads are kept inside node itself,
+ *         longer ones are copied to arena
  *
  * \param obj binson*
- * \param parent binson_node*
- * \param key const char*
- * \param dst binson_node**
+ * \param node binson_node*
+ * \param src const void*
+ * \param size size_t
  * \return binson_res
  */
-binson_res  binson_node_add_array_empty( binson *obj, binson_node *parent, const char* key, binson_node **dst )
+binson_res  binson_node_set_payload( binson *obj, binson_node *node, const void *src, size_t size )
 {
-  return  binson_node_add_empty( obj, parent, BINSON_TYPE_ARRAY, key, dst );
+  bool  terminate = (node->type == BINSON_TYPE_STRING)? true : false;
+
+  if (obj->limits.max_token && size > obj->limits.max_token)
+    return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+  if (size + (terminate? 1:0) <= sizeof(binson_value))
+  {
+    if (size)
+      memcpy( &node->u.val, src, size );
+    if (terminate)
+      ((uint8_t *)&node->u.val)[size] = '\0';
+
+    node->val_len = (uint8_t)size;
+    node->flags |= BINSON_NODE_FLAG_VAL_INLINE;
+    return BINSON_RES_OK;
+  }
+
+  node->flags &= (uint8_t)~BINSON_NODE_FLAG_VAL_INLINE;
+  node->u.val.bbuf_val.bptr  = (uint8_t*) binson_arena_memdup( obj->arena, src, size, terminate );
+  node->u.val.bbuf_val.bsize = (binson_raw_size)size;
+
+  return node->u.val.bbuf_val.bptr? BINSON_RES_OK : binson_no_memory( obj );
 }
 
-/** \brief Remove subtree with specified node as root
+/* \brief Copy 'binson_value' structure to the node, storing STRING and BYTES payloads
  *
  * \param obj binson*
  * \param node binson_node*
+ * \param src_val binson_value*
  * \return binson_res
  */
-binson_res  binson_node_remove( binson *obj, binson_node *node )
+binson_res  binson_node_copy_val( binson *obj, binson_node *node, binson_value *src_val )
 {
-  binson_res   res = BINSON_RES_OK;
-  binson_node *parent, *prev, *next;
+  if (node->type == BINSON_TYPE_STRING)
+    return binson_node_set_payload( obj, node, src_val->str_val, strlen(src_val->str_val) );
+  else
+  if (node->type == BINSON_TYPE_BYTES)
+    return binson_node_set_payload( obj, node, src_val->bbuf_val.bptr, src_val->bbuf_val.bsize );
 
-  if (!obj || !node)
-    return BINSON_RES_ERROR_ARG_WRONG;
+  memcpy( &node->u.val, src_val, sizeof(binson_value) );
 
-  /* save ptrs  because tree traversal will break subtree */
-  parent = node->parent;
-  prev   = node->prev;
-  next   = node->next;
+  return BINSON_RES_OK;
+}
 
-  res = binson_traverse( obj, node, BINSON_TRAVERSE_POSTORDER, BINSON_DEPTH_LIMIT, binson_cb_remove, NULL );  /* free all subtree mallocs */
+/* \brief Translate 'binson_raw_value' structure to node's value, converting raw strings
+ *          to zero-terminated C-strings
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \param src_val binson_raw_value*
+ * \return binson_res
+ */
+binson_res  binson_node_copy_val_from_raw( binson *obj, binson_node *node, binson_raw_value *src_val )
+{
+  binson_res res = BINSON_RES_OK;
 
-  if (!parent)
-  {
-    obj->root = NULL;
-  }
-  else
+  switch (node->type)
   {
-    if (prev && next)
-      prev->next = next;
-      next->prev = prev;
+    case BINSON_TYPE_BOOLEAN:
+      node->u.val.bool_val = src_val->bool_val;  break;
+
+    case BINSON_TYPE_INTEGER:
+      node->u.val.int_val = src_val->int_val;  break;
+
+    case BINSON_TYPE_DOUBLE:
+      node->u.val.double_val = src_val->double_val;  break;
 
-    if (!prev)
-      parent->first_child = next;
+    case BINSON_TYPE_STRING:  /* dst string will contain zero terminator */
+    case BINSON_TYPE_BYTES:
+      res = binson_node_set_payload( obj, node, src_val->bbuf_val.bptr, src_val->bbuf_val.bsize );
+    break;
 
-    if (!next)
-      parent->last_child = prev;
+    default:  /* skipping value copy for another node types are is not error case */
+    break;
   }
 
   return res;
 }
 
-/** \brief
+/* \brief Private helper. FNV-1a hash of the key
  *
- * \param obj binson*
- * \param pwriter binson_writer*
- * \param psize binson_raw_size* Return number of bytes written. Specify NULL to ignore.
- * \return binson_res
+ * \param key const char*
+ * \param len binson_raw_size
+ * \return uint32_t
+ */
+uint32_t  binson_node_index_hash( const char *key, binson_raw_size len )
+{
+  uint32_t  h = 2166136261U;
+
+  while (len--)
+  {
+    h ^= (uint8_t)*key++;
+    h *= 16777619U;
+  }
+
+  return h;
+}
+
+/* \brief Private helper. Find key's slot in container's hash index
  *
+ * \param ext binson_node_ext*
+ * \param key const char*
+ * \param len binson_raw_size
+ * \return binson_size          Slot holding node with the key or empty slot where key must go
  */
-binson_res  binson_serialize( binson *obj, binson_writer *pwriter, binson_raw_size *psize )
+binson_size  binson_node_index_slot( binson_node_ext *ext, const char *key, binson_raw_size len )
 {
-  binson_res res, res2;
-  binson_traverse_cb_param tparam;
-  
-  if (!obj || !pwriter)
-    return BINSON_RES_ERROR_ARG_WRONG;  
-  
-  if (psize)
-    res2 = binson_io_reset_counters( binson_writer_get_io( pwriter ) );
-    
-  tparam.in_param.writer = pwriter;
-  res = binson_traverse( obj, binson_get_root(obj), BINSON_TRAVERSE_BOTHORDER, BINSON_DEPTH_LIMIT, binson_cb_dump, &tparam );
-  
-  if (psize)
-    res2 = binson_io_get_write_counter( binson_writer_get_io( pwriter ), psize );
-  
-  UNUSED(res2);	
-  
-  return res;
+  binson_size  mask = ext->hsize - 1;
+  binson_size  i = binson_node_index_hash( key, len ) & mask;
+
+  while (ext->htab[i] && binson_node_key_cmp( ext->htab[i], key, len ))
+    i = (i + 1) & mask;
+
+  return i;
 }
 
-/**
- *  Called by parser for each token group, used to build binson model
+/* \brief Private helper. Add node to container's hash index. First of equal keys stays indexed
+ *
+ * \param ext binson_node_ext*
+ * \param node binson_node*
+ * \return void
  */
-binson_res binson_cb_build( binson_parser *parser, uint8_t token_cnt, binson_token_buf *tbuf, void* param )
+void  binson_node_index_put( binson_node_ext *ext, binson_node *node )
 {
-  binson_cb_build_param_  *p = (binson_cb_build_param_ *)param;
-  binson_node             *new_node = NULL;
-  binson_raw_value         raw_key, raw_val;
-  binson_res               res = BINSON_RES_OK;
-  binson_node_type         node_type;
-  bool                     is_closing_token;  /* true, if current token is final part of OBJECT/ARRAY */
+  const char       *key;
+  binson_raw_size   len;
+  binson_size       i;
 
-  UNUSED(parser);
-  
-  memset(&raw_key, 0, sizeof(binson_raw_value));
-  memset(&raw_val, 0, sizeof(binson_raw_value));
+  binson_node_key_ref( node, &key, &len );
+  i = binson_node_index_slot( ext, key, len );
 
-  if (token_cnt > 1)
+  if (!ext->htab[i])
   {
-    res = binson_token_buf_get_node_type( tbuf, 1, &node_type, &is_closing_token );
-    res = binson_token_buf_get_token_payload( tbuf, 0, &raw_key );
-    res = binson_token_buf_get_token_payload( tbuf, 1, &raw_val );
+    ext->htab[i] = node;
+    ext->hused++;
   }
-  else
+}
+
+/* \brief Private helper. Remove node from container's hash index using backward shift deletion
+ *
+ * \param ext binson_node_ext*
+ * \param node binson_node*
+ * \return void
+ */
+void  binson_node_index_del( binson_node_ext *ext, binson_node *node )
+{
+  binson_size       mask = ext->hsize - 1;
+  binson_size       i, j, home;
+  const char       *key;
+  binson_raw_size   len;
+
+  binson_node_key_ref( node, &key, &len );
+  i = binson_node_index_slot( ext, key, len );
+
+  if (ext->htab[i] != node)   /* not indexed, equal key sibling is */
+    return;
+
+  /* equal keys are neighbours, so next one takes the place */
+  if (node->next && BINSON_NODE_HAS_KEY(node->next) && !binson_node_key_cmp( node->next, key, len ))
   {
-   res = binson_token_buf_get_node_type( tbuf, 0, &node_type, &is_closing_token );
-   if (node_type != BINSON_TYPE_OBJECT && node_type != BINSON_TYPE_ARRAY)
-   {
-      res = binson_token_buf_get_token_payload( tbuf, 0, &raw_val );
-      raw_key.bbuf_val.bsize = 0;  /* make sure raw_key is empty */
-   }
+    ext->htab[i] = node->next;
+    return;
   }
 
-  if (!is_closing_token)
+  ext->htab[i] = NULL;
+  ext->hused--;
+
+  for (j = (i + 1) & mask; ext->htab[j]; j = (j + 1) & mask)
   {
-    /* allocating new node structure */
-    new_node = (binson_node *)calloc(1, sizeof(binson_node));
-    new_node->type = node_type;
-
-     /* allocating and cloning key */
-     if ( !p->parent_last || p->parent_last->type == BINSON_TYPE_ARRAY)  /* no key, no parent or ARRAY */
-     {
-       new_node->key = NULL;
-     }
-     else if (!raw_key.bbuf_val.bsize && p->top_key)  /* parent is OBJECT but we have no parsed key, so key from argument  */
-     {
-       new_node->key = (char*)malloc( strlen(p->top_key)+1 );
-       strcpy(new_node->key, p->top_key);
-     }
-     else /* use key from parser */
-     {
-       new_node->key = (char*)malloc( raw_key.bbuf_val.bsize+1 );
-       memcpy(new_node->key, raw_key.bbuf_val.bptr, raw_key.bbuf_val.bsize );
-       new_node->key[ raw_key.bbuf_val.bsize ] = '\0';
-     }
+    binson_node_key_ref( ext->htab[j], &key, &len );
+    home = binson_node_index_hash( key, len ) & mask;
 
-    if (p->parent_last)
+    /* move entry back if its home slot is not in cyclic range (i, j] */
+    if ( (j > i && (home <= i || home > j)) || (j < i && (home <= i && home > j)) )
     {
-      res = binson_node_copy_val_from_raw( node_type, &(new_node->val), &raw_val );
-      res = binson_node_attach( p->obj, p->parent_last, new_node );
+      ext->htab[i] = ext->htab[j];
+      ext->htab[j] = NULL;
+      i = j;
     }
-    else  /* deserialization which replace whole DOM tree */
-    {
-      if ( p->obj->root)
-          res = binson_node_remove( p->obj, p->obj->root );
+  }
+}
 
-      p->obj->root = new_node;
+/* \brief Private helper. Get container's extension data, allocating it on first use
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \return binson_node_ext*      NULL if out of memory
+ */
+binson_node_ext*  binson_node_ext_get( binson *obj, binson_node *node )
+{
+  if (!node->u.c.ext)
+  {
+    node->u.c.ext = (binson_node_ext *) binson_arena_alloc( obj->arena, sizeof(binson_node_ext) );
+    if (node->u.c.ext)
+      memset( node->u.c.ext, 0, sizeof(binson_node_ext) );
+  }
 
-    }
-  } /* if (!is_closing_token) ... */
+  return node->u.c.ext;
+}
 
-  if (node_type == BINSON_TYPE_ARRAY || node_type == BINSON_TYPE_OBJECT)
-    p->parent_last = is_closing_token? p->parent_last->parent : new_node;
+/* \brief Private helper. (Re)build container's children vector. Old vector storage stays in arena till reset
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param cap binson_child_num   Minimal capacity required
+ * \return binson_res
+ */
+binson_res  binson_node_cvec_build( binson *obj, binson_node *parent, binson_child_num cap )
+{
+  binson_node_ext  *ext = binson_node_ext_get( obj, parent );
+  binson_node      *node;
+  binson_child_num  i = 0;
 
-  return res;
+  if (!ext)
+    return binson_no_memory( obj );
+
+  if (ext->cvec_cap < cap)
+  {
+    if (cap < BINSON_CHILD_VECTOR_THRESHOLD)
+      cap = BINSON_CHILD_VECTOR_THRESHOLD;
+
+    ext->cvec_valid = false;
+    ext->cvec = (binson_node **) binson_arena_alloc( obj->arena, cap * sizeof(binson_node *) );
+    ext->cvec_cap = ext->cvec? cap : 0;
+    if (!ext->cvec)
+      return binson_no_memory( obj );
+  }
+
+  for (node = parent->u.c.first_child; node; node = node->next)
+    ext->cvec[i++] = node;
+
+  ext->cvec_valid = true;
+
+  return BINSON_RES_OK;
 }
 
-/** \brief
+/* \brief Private helper. (Re)build container's hash index with room for all children.
+ *         Old table storage stays in arena till reset
  *
  * \param obj binson*
- * \param pparser binson_parser*
- * \param parent binson_node*   If NULL, replaces whole DOM tree
- * \param key const char*       Used if parent is OBJECT, otherwise ignored
- * \param validate_only bool
+ * \param parent binson_node*
  * \return binson_res
  */
-binson_res  binson_deserialize( binson *obj, binson_parser *pparser, binson_node *parent, const char* key, bool validate_only )
+binson_res  binson_node_index_build( binson *obj, binson_node *parent )
 {
-  binson_cb_build_param_  param;
-  binson_res              res;
+  binson_node_ext  *ext = binson_node_ext_get( obj, parent );
+  binson_node      *node;
+  binson_size       hsize = 2 * BINSON_HASH_INDEX_THRESHOLD;
 
-  if (!obj || !pparser)
-    return BINSON_RES_ERROR_ARG_WRONG;
+  if (!ext)
+    return binson_no_memory( obj );
 
-  UNUSED(validate_only);
+  while (hsize < 2 * (binson_size)parent->child_cnt)  /* keep load factor under 1/2 */
+    hsize <<= 1;
 
-  param.obj          = obj;
-  param.root_node    = parent;
-  param.parent_last  = parent; /*obj->root;*/
-  param.top_key      = key;
+  ext->htab = (binson_node **) binson_arena_alloc( obj->arena, hsize * sizeof(binson_node *) );
+  if (!ext->htab)
+    return binson_no_memory( obj );
 
-  res = binson_parser_parse( pparser, binson_cb_build,  &param );
+  memset( ext->htab, 0, hsize * sizeof(binson_node *) );
+  ext->hsize = hsize;
+  ext->hused = 0;
 
-  return res;
+  for (node = parent->u.c.first_child; node; node = node->next)
+    binson_node_index_put( ext, node );
+
+  return BINSON_RES_OK;
 }
 
-/** \brief Begin tree traversal and process first available node
+/* \brief Private helper. Account new child in parent's counter and hash index
  *
- * \param
- * \param
- * \return
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param new_node binson_node*
+ * \return binson_res
  */
-binson_res  binson_traverse_first( binson *obj, binson_node *root_node, binson_traverse_method t_method, int max_depth, \
-                                     binson_traverse_callback cb, binson_traverse_cb_status *status, void* param )
+binson_res  binson_node_index_add( binson *obj, binson_node *parent, binson_node *new_node )
 {
-    binson_res res = BINSON_RES_OK;
+  parent->child_cnt++;
 
-    if (status && obj && root_node)  /* first iteration */
+  if (parent->type != BINSON_TYPE_OBJECT || !BINSON_NODE_HAS_KEY(new_node) || (parent->flags & BINSON_NODE_FLAG_BULK))
+    return BINSON_RES_OK;
+
+  if (parent->u.c.ext && parent->u.c.ext->htab)
+  {
+    if (2 * (parent->u.c.ext->hused + 1) <= parent->u.c.ext->hsize)
     {
-      /* store parameters to status structure */
-      status->obj         = obj;
-      status->root_node   = root_node;
-      status->t_method    = t_method;
-      status->max_depth   = max_depth;
-      status->cb          = cb;
-      status->param       = param;
+      binson_node_index_put( parent->u.c.ext, new_node );
+      return BINSON_RES_OK;
+    }
+  }
+  else if (parent->child_cnt <= BINSON_HASH_INDEX_THRESHOLD)
+    return BINSON_RES_OK;
 
-      /* initialize state variables */
-      status->current_node = root_node;
+  return binson_node_index_build( obj, parent );
+}
 
-      status->dir         = BINSON_TRAVERSE_DIR_UNKNOWN;
-      status->child_num   = 0;
-      status->depth       = 0;
-      status->done        = false;
+/* \brief Connect node as last child of parent without any key ordering checks
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param new_node binson_node*
+ * \return binson_res
+ */
+binson_res  binson_node_attach_last( binson *obj, binson_node *parent, binson_node *new_node )
+{
+  binson_res  res;
 
-      /* required for tree deletion to prevent sawing one's bough */
-      memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+  new_node->parent = parent;
+  new_node->next   = NULL;
+  new_node->prev   = parent->u.c.last_child;
 
-      /* check if we need to process root node at first iteration */
-      if (status->t_method != BINSON_TRAVERSE_POSTORDER)
-        return status->cb( status->obj, status->current_node, status, status->param );
-    }
+  if (parent->u.c.last_child)
+    parent->u.c.last_child->next = new_node;
+  else
+    parent->u.c.first_child = new_node;
 
-    if (status && status->done)
-      return BINSON_RES_TRAVERSAL_DONE;
+  parent->u.c.last_child = new_node;
 
-    /* non-first iteration. */
-    if (status->dir == BINSON_TRAVERSE_DIR_UP ||
-        status->depth >= status->max_depth ||
-        status->current_node_copy.first_child == NULL)  /* there is no way down */
-    {
-      bool empty_container = false;
+  res = binson_node_index_add( obj, parent, new_node );
+  if (FAILED(res)) return res;
 
-      if ((status->current_node_copy.type == BINSON_TYPE_OBJECT || status->current_node_copy.type == BINSON_TYPE_ARRAY) &&
-           status->current_node_copy.first_child == NULL && status->t_method != BINSON_TRAVERSE_PREORDER )
-          empty_container = true;  
-      
-      if (status->current_node && status->current_node_copy.next) /* we can move right */
-      {
-          /* process closing part of empty OBJECT/ARRAY */	  
-          if (status->depth > 0 && empty_container && status->t_method == BINSON_TRAVERSE_BOTHORDER)
-	  {
-	    status->dir  = BINSON_TRAVERSE_DIR_UP;	    
-            res = status->cb( status->obj, status->current_node, status, status->param );  
-	  }
-	
-          status->current_node = status->current_node_copy.next;  /* update current node to it */
-          status->dir = BINSON_TRAVERSE_DIR_RIGHT;
-          status->child_num++;  /* keep track of index */
+  /* keep children vector valid, growing it twice when full */
+  if (parent->u.c.ext && parent->u.c.ext->cvec_valid)
+  {
+    if (parent->child_cnt <= parent->u.c.ext->cvec_cap)
+      parent->u.c.ext->cvec[ parent->child_cnt - 1 ] = new_node;
+    else
+      res = binson_node_cvec_build( obj, parent, 2 * parent->u.c.ext->cvec_cap );
+  }
 
-          /* required for tree deletion to prevent sawing one's bough */
-          memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+  return res;
+}
 
-          if (status->t_method != BINSON_TRAVERSE_POSTORDER)
-            return status->cb( status->obj, status->current_node, status, status->param );
-      }
-      else /* no more neighbors from the right, moving up */
-      {
-        status->dir          = BINSON_TRAVERSE_DIR_UP;
+/* \brief Connect node to parent's children list, keeping OBJECT keys sorted
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param new_node binson_node*
+ * \return binson_res
+ */
+binson_res  binson_node_attach( binson *obj, binson_node *parent, binson_node *new_node )
+{
+  binson_node      *pnode;
+  const char       *key;
+  binson_raw_size   len;
 
-        /* process closing part of empty OBJECT/ARRAY */
-        if (status->depth > 0 && empty_container && status->t_method == BINSON_TRAVERSE_BOTHORDER)
-          res = status->cb( status->obj, status->current_node, status, status->param );
+  new_node->parent = parent;
+  new_node->next = NULL;
+  new_node->prev = NULL;
 
-        if (status->current_node_copy.parent)  /* root node case - prevent NULL assignment */
-          status->current_node = status->current_node_copy.parent;
+  if (!parent)
+    return BINSON_RES_OK;
 
-        if (!empty_container)  /* empty containers process on same depth level */
-        {
-           status->depth--;
-           if (status->depth < 0)
-           {
-             status->done = true;
-             return res;
-           }
-        }
+  binson_node_key_ref( new_node, &key, &len );
 
-        /* required for tree deletion to prevent sawing one's bough */
-        memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+  /* fast path: empty parent, bulk build, ARRAY items and keys not less than last one are appended */
+  if (!parent->u.c.last_child || (parent->flags & BINSON_NODE_FLAG_BULK) || !key || !BINSON_NODE_HAS_KEY(parent->u.c.last_child) ||
+      binson_node_key_cmp( parent->u.c.last_child, key, len ) <= 0)
+    return binson_node_attach_last( obj, parent, new_node );
 
-        if (status->t_method != BINSON_TRAVERSE_PREORDER)
-          res = status->cb( status->obj, status->current_node, status, status->param );
+  pnode = parent->u.c.first_child;
 
-        if (empty_container)   /* change depth after empty container processed */
-        {
-           status->depth--;
-           if (status->depth < 0)
-           {
-             status->done = true;
-             return res;
-           }
-        }
-      }
-    }
-    else  /* last processed has some children */
-    {
-       status->current_node = status->current_node_copy.first_child;   /* select leftmost child */
-       status->dir          = BINSON_TRAVERSE_DIR_DOWN;
-       status->child_num    = 0;
-       status->depth++;
+  while (pnode)
+  {
+    if ( BINSON_NODE_HAS_KEY(pnode) && binson_node_key_cmp( pnode, key, len ) > 0 )
+      break;
+    pnode = pnode->next;
+  };
+
+  /* insert before pnode. It's never NULL here since new key is less than last one */
+  new_node->prev    = pnode->prev;
+  new_node->next    = pnode;
+  if (pnode->prev)  /* insert non first - in-between */
+  {
+    pnode->prev->next = new_node;
+  }
+  else
+  {
+    parent->u.c.first_child = new_node;  /* insert as first item */
+  }
 
-       /* required for tree deletion to prevent sawing one's bough */
-       memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+  pnode->prev       = new_node;
 
-      if (status->t_method != BINSON_TRAVERSE_POSTORDER || status->current_node_copy.first_child == NULL)
-        res = status->cb( status->obj, status->current_node, status, status->param );         
-    }
+  if (parent->u.c.ext)
+    parent->u.c.ext->cvec_valid = false;
 
-    return res;
+  return binson_node_index_add( obj, parent, new_node );
 }
 
-/** \brief Continue tree traversal and process next available
+/* \brief Disconnect node from parent's children list
  *
- * \param status binson_traverse_cb_status*
+ * \param obj binson*
+ * \param node binson_node*
  * \return binson_res
  */
-binson_res  binson_traverse_next( binson_traverse_cb_status *status )
+binson_res  binson_node_detach( binson *obj, binson_node *node )
 {
-    /* to have code logic located in one place let's reuse 'binson_traverse_begin' function.
-    / calling it with NULL pointers will make it work like 'binson_traverse_next'. */
-    return binson_traverse_first( NULL, NULL, status->t_method, status->max_depth, status->cb, status, status->param);
-}
+  binson_node  *parent;
 
-/** \brief No more nodes to process?
- *
- * \param status binson_traverse_cb_status*
- * \return bool
- */
-bool  binson_traverse_is_done( binson_traverse_cb_status *status )
-{
-  return status->done;
-}
+  if (!obj || !node)
+    return BINSON_RES_ERROR_ARG_WRONG;
 
-/** \brief Which is current node being traversed?
- *
- * \param status binson_traverse_cb_status*
- * \return binson_node*
- */
-binson_node*    binson_traverse_get_current_node( binson_traverse_cb_status *status )
-{
-  return status->current_node;
-}
+  parent = node->parent;
 
-/** \brief Traverse all subtree with 'root_node' as subtree root
- *
- * \param
- * \param
- * \return
- */
-binson_res  binson_traverse( binson *obj, binson_node *root_node, binson_traverse_method t_method, int max_depth, \
-                               binson_traverse_callback cb, void* param )
-{
-  binson_traverse_cb_status  status;
-  binson_res res = binson_traverse_first( obj, root_node, t_method, max_depth, cb, &status, param );
+  if (parent)
+  {
+    if (parent->u.c.ext && parent->u.c.ext->htab && BINSON_NODE_HAS_KEY(node))
+      binson_node_index_del( parent->u.c.ext, node );
 
-  while (!binson_traverse_is_done( &status ))
-    res = binson_traverse_next( &status );
+    /* children vector stays valid only when the last child goes */
+    if (parent->u.c.ext && parent->u.c.last_child != node)
+      parent->u.c.ext->cvec_valid = false;
 
-  return res;
-}
+    parent->child_cnt--;
 
-/** \brief  Get root node pointer
- *
- * \param obj binson*
- * \return binson_node*
- */
-binson_node* binson_get_root( binson *obj )
-{
-  if (!obj)
-    return NULL;
+    if (parent->u.c.last_child == node)
+      parent->u.c.last_child = node->prev;
 
-  return obj->root;
-}
+    if (parent->u.c.first_child == node)
+      parent->u.c.first_child = node->next;
+  }
 
-/** \brief Get node type
- *
- * \param node binson_node*
- * \return binson_node_type
- */
-binson_node_type  binson_node_get_type( binson_node *node )
-{
-  return node->type;
-}
+  if (node->prev)
+    node->prev->next = node->next;
 
-/** \brief Get node key
- *
- * \param node binson_node*
- * \return const char*
- */
-const char*    binson_node_get_key( binson_node *node )
-{
-  return node->key;
-}
+  if (node->next)
+    node->next->prev = node->prev;
 
-/* \brief Get node value struct pointer
- *
- * \param node binson_node*
- * \return binson_value*
- */
-binson_value*    binson_node_get_val( binson_node *node )
-{
-  return &node->val;
+  node->parent = NULL;
+  node->prev = NULL;
+  node->next = NULL;
+
+  return BINSON_RES_OK;
 }
 
-/** \brief Get value of specified node as boolean
+/* \brief Key lookup iterator (callback) to use with binson_traverse_*() functions
  *
+ * \param obj binson*
  * \param node binson_node*
- * \param pbool bool*
+ * \param status binson_traverse_cb_status*
+ * \param param void*
  * \return binson_res
  */
-binson_res  binson_node_get_boolean( binson_node *node, bool *pbool )
+binson_res _binson_cb_lookup_key( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
 {
-  if (!node || !pbool)
+   binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
+   binson_child_num  requested_idx = p->in_param.idx;
+
+   if (!obj || !node || !status || !param)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *pbool = node->val.bool_val;
+   if (status->child_num == requested_idx)
+   {
+     p->out_param.node = node;
+     status->done = true;  /* this force calling function to stop iterating; */
+   }
+   else
+     p->out_param.node = NULL;
 
-  return BINSON_RES_OK;
+   return BINSON_RES_OK;
 }
 
-/** \brief Get value of specified node as integer
+/* \brief Index lookup iterator (callback) to use with binson_traverse_*() functions
  *
+ * \param obj binson*
  * \param node binson_node*
- * \param pinteger int64_t*
+ * \param status binson_traverse_cb_status*
+ * \param param void*
  * \return binson_res
  */
-binson_res  binson_node_get_integer( binson_node *node, int64_t *pinteger )
+binson_res binson_cb_lookup_idx( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
 {
-  if (!node || !pinteger)
+   binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
+   const char *requested_key = p->in_param.key;
+
+   if (!obj || !node || !status || !param)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *pinteger = node->val.int_val;
 
-  return BINSON_RES_OK;
+   if (!binson_node_key_cmp( node, requested_key, (binson_raw_size)strlen(requested_key) ))
+   {
+     p->out_param.node = node;
+     status->done = true;  /* this force calling function to stop iterating; */
+   }
+   else
+     p->out_param.node = NULL;
+
+   return BINSON_RES_OK;
 }
 
-/** \brief Get value of specified node as double
+/* \brief Node count iterator (callback) to use with binson_traverse_*() functions
  *
+ * \param obj binson*
  * \param node binson_node*
- * \param pdouble double*
+ * \param status binson_traverse_cb_status*
+ * \param param void*
  * \return binson_res
  */
-binson_res  binson_node_get_double( binson_node *node, double *pdouble )
+binson_res binson_cb_count( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
 {
-  if (!node || !pdouble)
+  binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
+
+   if (!obj || !node || !status || !param)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *pdouble = node->val.double_val;
+  if (!status->done && status->current_node == status->root_node)  /* initialize counter in case of 1st iteration */
+    p->out_param.node_num = 0;
+
+  p->out_param.node_num++;
 
   return BINSON_RES_OK;
 }
 
-/** \brief Get value of specified node as string
+/* \brief Callback used to convert in-memory node to raw binson data or to it's JSON string representation
  *
+ * \param obj binson*
  * \param node binson_node*
- * \param pstr char**
+ * \param status binson_traverse_cb_status*
+ * \param param void*
  * \return binson_res
  */
-binson_res  binson_node_get_string( binson_node *node, char **ppstr )
+binson_res binson_cb_dump( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
 {
-  if (!node || !ppstr)
-    return BINSON_RES_ERROR_ARG_WRONG;
+  binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
 
-  *ppstr = node->val.str_val;
+  if (!status || !status->current_node )
+    return BINSON_RES_ERROR_ARG_WRONG;
 
-  return BINSON_RES_OK;
+  return binson_node_write( obj, p->in_param.writer, node, status->dir == BINSON_TRAVERSE_DIR_UP );
 }
 
-/** \brief Get value of specified node as byte array
+/* \brief Private helper. Write single node. Containers are written in two parts: opening
+ *         one with key and closing one
  *
+ * \param obj binson*
+ * \param writer binson_writer*
  * \param node binson_node*
- * \param ppbytes uint8_t**
- * \param psize binson_raw_size*
+ * \param closing bool           Write closing part of OBJECT/ARRAY
  * \return binson_res
  */
-binson_res  binson_node_get_bytes( binson_node *node, uint8_t **ppbytes, binson_raw_size *psize )
+binson_res  binson_node_write( binson *obj, binson_writer *writer, binson_node *node, bool closing )
 {
-  if (!node || !ppbytes || !psize)
+  binson_res            res = BINSON_RES_OK;
+  binson_writer_format  format;
+  const char           *key;
+  const uint8_t        *tok;
+
+  if (!obj || !writer || !node)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *ppbytes = node->val.bbuf_val.bptr;
-  *psize   = node->val.bbuf_val.bsize;
+  /* RAW mode references are binson tokens already, so binson output takes them as is. Other formats need copies */
+  if (node->flags & (BINSON_NODE_FLAG_KEY_RAW | BINSON_NODE_FLAG_VAL_RAW))
+  {
+    format = binson_writer_get_format( writer );
 
-  return BINSON_RES_OK;
+    if (format == BINSON_WRITER_FORMAT_RAW || format == BINSON_WRITER_FORMAT_HEX)
+    {
+      if ((node->flags & BINSON_NODE_FLAG_KEY_RAW) && !closing)
+      {
+        tok = (const uint8_t *)node->key.ptr;
+        res = binson_writer_write_raw( writer, tok, binson_common_decode_token( tok, NULL ) );
+        if (FAILED(res)) return res;
+      }
+
+      if (node->flags & BINSON_NODE_FLAG_VAL_RAW)
+      {
+        tok = node->u.val.bbuf_val.bptr;
+        return binson_writer_write_raw( writer, tok, binson_common_decode_token( tok, NULL ) );
+      }
+    }
+    else
+    {
+      res = binson_node_materialize( obj, node, BINSON_NODE_FLAG_KEY_RAW | BINSON_NODE_FLAG_VAL_RAW );
+      if (FAILED(res)) return res;
+    }
+  }
+
+  key = (node->flags & BINSON_NODE_FLAG_KEY_RAW)? NULL : BINSON_NODE_KEY(node);  /* raw key is written already */
+
+  return binson_node_write_value( writer, node, key, closing );
 }
 
-/** \brief Check is specidied node is leaf node type (not ARRAY, not OBJECT)
+/* \brief Private helper. Write node under another key. Opening part of containers and leaves only
  *
+ * \param obj binson*
+ * \param writer binson_writer*
  * \param node binson_node*
- * \return bool
+ * \param key const char*
+ * \return binson_res
  */
-bool binson_node_is_leaf_type( binson_node *node )
+binson_res  binson_node_write_as( binson *obj, binson_writer *writer, binson_node *node, const char *key )
 {
-  return (node->type == BINSON_TYPE_OBJECT || node->type == BINSON_TYPE_ARRAY)? false:true;
+  binson_res  res;
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)  /* raw token can't be attached to other key */
+  {
+    res = binson_node_materialize( obj, node, BINSON_NODE_FLAG_VAL_RAW );
+    if (FAILED(res)) return res;
+  }
+
+  return binson_node_write_value( writer, node, key, false );
 }
 
-/** \brief Get node's parent node
+/* \brief Private helper. Write node's key and decoded value with binson_writer primitives
  *
+ * \param writer binson_writer*
  * \param node binson_node*
- * \return binson_node*
+ * \param key const char*
+ * \param closing bool            Write closing part of OBJECT/ARRAY
+ * \return binson_res
  */
-binson_node*   binson_node_get_parent( binson_node *node )
+binson_res  binson_node_write_value( binson_writer *writer, binson_node *node, const char *key, bool closing )
 {
-  return node->parent;
+  binson_res  res;
+
+  switch (node->type)
+  {
+    case BINSON_TYPE_OBJECT:
+      if (closing)
+        res = binson_writer_write_object_end( writer );
+      else
+        res = binson_writer_write_object_begin( writer, key );
+    break;
+
+    case BINSON_TYPE_ARRAY:
+      if (closing)
+        res = binson_writer_write_array_end( writer );
+      else
+        res = binson_writer_write_array_begin( writer, key );
+    break;
+
+    case BINSON_TYPE_BOOLEAN:
+      res = binson_writer_write_boolean( writer, key, node->u.val.bool_val );
+    break;
+
+    case BINSON_TYPE_INTEGER:
+      res = binson_writer_write_integer( writer, key, node->u.val.int_val );
+    break;
+
+    case BINSON_TYPE_DOUBLE:
+      res = binson_writer_write_double( writer, key, node->u.val.double_val );
+    break;
+
+    case BINSON_TYPE_STRING:
+      res = binson_writer_write_str( writer, key, (const char*)BINSON_NODE_VAL_PTR(node) );
+    break;
+
+    case BINSON_TYPE_BYTES:
+      res = binson_writer_write_bytes( writer, key, BINSON_NODE_VAL_PTR(node), BINSON_NODE_VAL_SIZE(node) );
+    break;
+
+    case BINSON_TYPE_UNKNOWN:
+    default:
+      res = BINSON_RES_ERROR_TYPE_UNKNOWN;
+    break;
+  }
+
+  return res;
 }
 
-/** \brief Get depth level of the node. Depth of root is 0.
+/* \brief Callback useful for debugging DOM tree traversal functionality
  *
- * \param node binson_node*
- * \return int
+ * \param
+ * \param
+ * \return
  */
-int  binson_node_get_depth(  binson_node *node )
+#ifdef DEBUG
+binson_res  binson_node_dump_debug( binson *obj, binson_node *node )
 {
-   int depth = 0;
+  const char* fmt = "[node=%p, type=%d, key=\"%s\", val=%x] : \n parent=%p, prev=%p, next=%p, fch=%p, lch=%p\n\n";
+  binson_io   *io;
 
-   while (node && node->parent)
-   {
-     node = node->parent;
-     depth++;
-   }
+  if (obj)
+  {
+    io = obj->error_io; /*binson_writer_get_io( obj->writer );*/
+    return binson_io_printf( io, fmt, node, node->type, BINSON_NODE_KEY(node), node->u.val.int_val,
+                                      node->parent, node->prev, node->next, binson_node_get_first_child(node), binson_node_get_last_child(node) );
+  }
+  else
+    printf(fmt, node, node->type, BINSON_NODE_KEY(node), node->u.val.int_val,
+                                      node->parent, node->prev, node->next, binson_node_get_first_child(node), binson_node_get_last_child(node) );
+    
+  return BINSON_RES_OK;
+}
 
-   return depth;
+binson_res  binson_cb_dump_debug( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+{
+  binson_traverse_cb_param *p = (binson_traverse_cb_param *)param;
+  binson_res  res = BINSON_RES_OK;
+  binson_io   *io = obj->error_io; 
+
+  UNUSED(p);
+  UNUSED(res);
+  UNUSED(node);  
+
+  res = binson_io_printf( io, "-> #%02d, depth=%02d, dir=%02d : ", status->child_num, status->depth, status->dir );
+  return binson_node_dump_debug( obj, status->current_node );
 }
+#endif
 
-/** \brief Get previous (left) sibling of the node
+/* \brief Callback used to node key against str key passed via param
  *
+ * \param obj binson*
  * \param node binson_node*
- * \return binson_node*
+ * \param status binson_traverse_cb_status*
+ * \param param void*
+ * \return binson_res
  */
-binson_node*    binson_node_get_prev( binson_node *node )
+binson_res binson_cb_key_compare( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
 {
-  return node->prev;
+  binson_traverse_cb_param   *p = (binson_traverse_cb_param *)param;
+
+  if (!obj || !node || !status || !param)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  p->out_param.cmp_res = binson_node_key_cmp( node, p->in_param.key, (binson_raw_size)strlen(p->in_param.key) );  /* is ok for UTF-8 strings since byte order preserves lexicographic order */
+
+  return BINSON_RES_OK;
 }
 
-/** \brief Get next (right) sibling of the node
+/* \brief Callback used to release single node. Key and value memory belongs to arena
+ *         and is reclaimed on binson_reset()/binson_free(), node itself is kept for reuse.
  *
+ * \param obj binson*
  * \param node binson_node*
- * \return binson_node*
+ * \param status binson_traverse_cb_status*
+ * \param param void*
+ * \return binson_res
  */
-binson_node*    binson_node_get_next( binson_node *node )
+binson_res binson_cb_remove( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
 {
-  return node->next;
+  binson_traverse_cb_param   *p = (binson_traverse_cb_param *)param;
+  UNUSED(p);
+  UNUSED(status);
+
+/*binson_cb_dump_debug( obj, node, status, param);*/
+
+  if (!obj || !node)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_OWNED)
+  {
+    binson_common_free( &obj->allocator, node->u.val.bbuf_val.bptr );
+    obj->owned--;
+    obj->owned_size -= node->u.val.bbuf_val.bsize;
+    binson_limits_apply( obj, obj->arena );
+  }
+
+  node->key.ptr = NULL;
+  node->flags   = 0;
+  node->type = BINSON_TYPE_UNKNOWN;
+
+  node->next = obj->free_nodes;
+  obj->free_nodes = node;
+  obj->nodes--;
+
+  return BINSON_RES_OK;
 }
 
-/** \brief Get most left sibling of the node
+/** \brief Creates empty OBJECT node and connects it to specified parent
  *
- * \param node binson_node*
- * \return binson_node*
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \return binson_res
  */
-binson_node*  binson_node_get_first_sibling( binson_node *node )
+binson_res  binson_node_add_object_empty( binson *obj, binson_node *parent, const char* key, binson_node **dst )
 {
-   if (!node || !node->parent || (node == node->parent->first_child))
-     return NULL;
+  return  binson_node_add_empty( obj, parent, BINSON_TYPE_OBJECT, key, dst );
+}
+
+/** \brief Creates BOOLEAN node and connects it to specified parent
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \param val bool
+ * \return binson_res
+ */
+binson_res  binson_node_add_boolean( binson *obj, binson_node *parent, const char* key, binson_node **dst, bool val )
+{
+  binson_value  tmp_val;
 
-   return node->parent->first_child;
+  tmp_val.bool_val = val;
+  return binson_node_add( obj, parent, BINSON_TYPE_BOOLEAN, key, dst, &tmp_val );
 }
 
-/** \brief Get most right sibling of the node
+/** \brief Creates INTEGER node and connects it to specified parent
  *
- * \param node binson_node*
- * \return binson_node*
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \param val int64_t
+ * \return binson_res
  */
-binson_node*  binson_node_get_last_sibling( binson_node *node )
+binson_res  binson_node_add_integer( binson *obj, binson_node *parent,  const char* key, binson_node **dst, int64_t val )
 {
-  if (!node || !node->parent || (node == node->parent->last_child))
-     return NULL;
+  binson_value  tmp_val;
 
-   return node->parent->last_child;
+  tmp_val.int_val = val;
+  return binson_node_add( obj, parent, BINSON_TYPE_INTEGER, key, dst, &tmp_val );
 }
 
-/** \brief Get first child of the node
+/** \brief Creates DOUBLE node and connects it to specified parent
  *
- * \param node binson_node*
- * \return binson_node*
+ * \param obj binson*
+ * \param key binson_node *parentconst char*
+ * \param dst binson_node**
+ * \param val double
+ * \return binson_res
  */
-binson_node*  binson_node_get_first_child( binson_node *node )
+binson_res  binson_node_add_double( binson *obj, binson_node *parent, const char* key, binson_node **dst, double val )
 {
-  if (!node || binson_node_is_leaf_type(node))
-    return NULL;
+  binson_value  tmp_val;
 
-  return node->first_child;
+  tmp_val.double_val = val;
+  return binson_node_add( obj, parent, BINSON_TYPE_DOUBLE, key, dst, &tmp_val );
 }
 
-/** \brief Get last child of the node
+/** \brief Creates STRING node and connects it to specified parent
  *
- * \param node binson_node*
- * \return binson_node*
+ * \param
+ * \param
+ * \return
  */
-binson_node*  binson_node_get_last_child( binson_node *node )
+binson_res  binson_node_add_str( binson *obj, binson_node *parent, const char* key, binson_node **dst, const char* val )
 {
-  if (!node || binson_node_is_leaf_type(node))
-    return NULL;
+  binson_value  tmp_val;
 
-  return node->last_child;
+  tmp_val.str_val = (char *)val;
+  return binson_node_add( obj, parent, BINSON_TYPE_STRING, key, dst, &tmp_val );
 }
 
+/** \brief Creates BYTES node and connects it to specified parent
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \param src_ptr uint8_t
+ * \param src_size size_t
+ * \return binson_res
+ */
+binson_res  binson_node_add_bytes( binson *obj, binson_node *parent, const char* key, binson_node **dst, uint8_t *src_ptr,  size_t src_size )
+{
+  binson_value  tmp_val;
+
+  tmp_val.bbuf_val.bptr   = src_ptr;
+  tmp_val.bbuf_val.bsize  = src_size;
+  return binson_node_add( obj, parent, BINSON_TYPE_BYTES, key, dst, &tmp_val );
+}
 
-/** \brief Search node by key among siblings
+/** \brief Creates STRING node which adopts caller's buffer instead of copying it
  *
  * \param obj binson*
  * \param parent binson_node*
  * \param key const char*
- * \param pnode binson_node**
+ * \param dst binson_node**
+ * \param str char*               Zero-terminated string allocated by context's allocator, see
+ *                                binson_get_allocator(), malloc() by default. On success it belongs
+ *                                to the tree and is freed with the node, short one is freed at once
  * \return binson_res
  */
-binson_res  binson_node_get_child_by_key( binson *obj, binson_node *parent, const char *key, binson_node **pnode )
+binson_res  binson_node_add_str_take( binson *obj, binson_node *parent, const char* key, binson_node **dst, char* str )
 {
-  binson_node *node;
+  binson_node  *me;
+  binson_res    res;
 
-  if (!parent)
-    parent = obj->root;
+  if (!str)
+    return BINSON_RES_ERROR_ARG_WRONG;
 
-  node = parent->first_child;
-  *pnode = NULL;
+  res = binson_limits_check( obj, strlen( str ), true );
+  if (FAILED(res)) return res;
 
-  while (node)
-  {
-    if ( !strcmp(key, node->key) )
-    {
-      *pnode = node;
-       break;
-    }
-    node = node->next;
-  }
+  res = binson_node_add_empty( obj, parent, BINSON_TYPE_STRING, key, &me );
+  if (FAILED(res)) return res;
+
+  if (dst)
+    *dst = me;
+
+  binson_node_adopt_payload( obj, me, str, strlen( str ) );
 
   return BINSON_RES_OK;
+}
+
+/** \brief Creates BYTES node which adopts caller's buffer instead of copying it
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \param src_ptr uint8_t*        Buffer allocated by context's allocator, see binson_get_allocator(),
+ *                                malloc() by default. On success it belongs to the tree
+ *                                and is freed with the node, short one is freed at once
+ * \param src_size size_t
+ * \return binson_res
+ */
+binson_res  binson_node_add_bytes_take( binson *obj, binson_node *parent, const char* key, binson_node **dst, uint8_t *src_ptr, size_t src_size )
+{
+  binson_node  *me;
+  binson_res    res;
+
+  if (!src_ptr)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_limits_check( obj, src_size, true );
+  if (FAILED(res)) return res;
+
+  res = binson_node_add_empty( obj, parent, BINSON_TYPE_BYTES, key, &me );
+  if (FAILED(res)) return res;
+
+  if (dst)
+    *dst = me;
+
+  binson_node_adopt_payload( obj, me, src_ptr, src_size );
+
+  return BINSON_RES_OK;
+}
+
+/* \brief Private helper. Make allocated buffer node's payload. Short payloads go inline as usual
+ *
+ * \param obj binson*
+ * \param node binson_node*       New STRING/BYTES node
+ * \param src void*               STRING buffer holds terminator after 'size' bytes
+ * \param size size_t
+ * \return void
+ */
+void  binson_node_adopt_payload( binson *obj, binson_node *node, void *src, size_t size )
+{
+  if (size + (node->type == BINSON_TYPE_STRING? 1:0) <= sizeof(binson_value))
+  {
+    binson_node_set_payload( obj, node, src, size );  /* never fails for inline payload */
+    binson_common_free( &obj->allocator, src );
+    return;
+  }
+
+  node->u.val.bbuf_val.bptr  = (uint8_t *)src;
+  node->u.val.bbuf_val.bsize = (binson_raw_size)size;
+  node->flags |= BINSON_NODE_FLAG_VAL_OWNED;
+  obj->owned++;
+  obj->owned_size += size;
+  binson_limits_apply( obj, obj->arena );
+}
+
+/** \brief Creates STRING node which refers to caller's string instead of copying it
+ *
+ * String must stay valid and unchanged till node is removed or tree is reset, freed or
+ * replaced by deserialization. Library never writes to it and never frees it. Short string
+ * is copied into the node, so it's not referenced
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \param str const char*         Zero-terminated string
+ * \return binson_res
+ */
+binson_res  binson_node_add_str_ref( binson *obj, binson_node *parent, const char* key, binson_node **dst, const char* str )
+{
+  binson_node  *me;
+  binson_res    res;
+
+  if (!str)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_limits_check( obj, strlen( str ), false );
+  if (FAILED(res)) return res;
+
+  res = binson_node_add_empty( obj, parent, BINSON_TYPE_STRING, key, &me );
+  if (FAILED(res)) return res;
+
+  if (dst)
+    *dst = me;
+
+  return binson_node_borrow_payload( obj, me, str, strlen( str ) );
+}
+
+/** \brief Creates BYTES node which refers to caller's buffer instead of copying it
+ *
+ * Buffer must stay valid and unchanged till node is removed or tree is reset, freed or
+ * replaced by deserialization. Library never writes to it and never frees it. Short buffer
+ * is copied into the node, so it's not referenced
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \param src_ptr const uint8_t*
+ * \param src_size size_t
+ * \return binson_res
+ */
+binson_res  binson_node_add_bytes_ref( binson *obj, binson_node *parent, const char* key, binson_node **dst, const uint8_t *src_ptr, size_t src_size )
+{
+  binson_node  *me;
+  binson_res    res;
+
+  if (!src_ptr && src_size)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_limits_check( obj, src_size, false );
+  if (FAILED(res)) return res;
+
+  res = binson_node_add_empty( obj, parent, BINSON_TYPE_BYTES, key, &me );
+  if (FAILED(res)) return res;
+
+  if (dst)
+    *dst = me;
+
+  return binson_node_borrow_payload( obj, me, src_ptr, src_size );
+}
+
+/* \brief Private helper. Make caller's memory node's payload. Nodes don't free their non-inline
+ *         payloads, so no mark is needed. Short payloads go inline as usual
+ *
+ * \param obj binson*
+ * \param node binson_node*       New STRING/BYTES node
+ * \param src const void*         STRING buffer holds terminator after 'size' bytes
+ * \param size size_t
+ * \return binson_res
+ */
+binson_res  binson_node_borrow_payload( binson *obj, binson_node *node, const void *src, size_t size )
+{
+  if (size + (node->type == BINSON_TYPE_STRING? 1:0) <= sizeof(binson_value))
+    return binson_node_set_payload( obj, node, src, size );
+
+  node->u.val.bbuf_val.bptr  = (uint8_t *)src;
+  node->u.val.bbuf_val.bsize = (binson_raw_size)size;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Detach payload of STRING node. Adopted string, see binson_node_add_str_take(),
+ *         is handed over without copying, other ones are copied. Node's value becomes empty string
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \param pstr char**              Zero-terminated string to be freed by caller with context's allocator
+ * \return binson_res
+ */
+binson_res  binson_node_take_string( binson *obj, binson_node *node, char **pstr )
+{
+  size_t  size;
+
+  return binson_node_take_payload( obj, node, BINSON_TYPE_STRING, (uint8_t **)pstr, &size );
+}
+
+/** \brief Detach payload of BYTES node. Adopted buffer, see binson_node_add_bytes_take(),
+ *         is handed over without copying, other ones are copied. Node's value becomes empty
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \param ppbytes uint8_t**        Buffer to be freed by caller with context's allocator
+ * \param psize size_t*
+ * \return binson_res
+ */
+binson_res  binson_node_take_bytes( binson *obj, binson_node *node, uint8_t **ppbytes, size_t *psize )
+{
+  return binson_node_take_payload( obj, node, BINSON_TYPE_BYTES, ppbytes, psize );
+}
+
+/* \brief Private helper. Detach STRING/BYTES payload, copying it if it's not adopted buffer
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \param type binson_node_type
+ * \param pptr uint8_t**
+ * \param psize size_t*
+ * \return binson_res
+ */
+binson_res  binson_node_take_payload( binson *obj, binson_node *node, binson_node_type type, uint8_t **pptr, size_t *psize )
+{
+  uint8_t          *src;
+  binson_raw_size   size;
+  size_t            extra = (type == BINSON_TYPE_STRING)? 1:0;
+  binson_res        res;
+
+  if (!obj || !node || !pptr || !psize || node->type != type)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  /* clones still sharing the node must keep the value */
+  if (node->parent)
+  {
+    res = binson_node_unshare_path( obj, node->parent );
+    if (FAILED(res)) return res;
+
+    binson_node_cache_drop( obj, node->parent );
+  }
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_OWNED)
+  {
+    *pptr  = node->u.val.bbuf_val.bptr;
+    *psize = node->u.val.bbuf_val.bsize;
+
+    node->flags &= (uint8_t)~BINSON_NODE_FLAG_VAL_OWNED;
+    obj->owned--;
+    obj->owned_size -= node->u.val.bbuf_val.bsize;
+    binson_limits_apply( obj, obj->arena );
+  }
+  else
+  {
+    res = binson_node_get_bytes( node, &src, &size );
+    if (FAILED(res)) return res;
+
+    *pptr = (uint8_t *)binson_common_alloc( &obj->allocator, size + extra + (size? 0:1) );  /* malloc(0) may give NULL */
+    if (!*pptr)
+      return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+    if (size)
+      memcpy( *pptr, src, size );
+    if (extra)
+      (*pptr)[size] = '\0';
+
+    *psize = size;
+    node->flags &= (uint8_t)~BINSON_NODE_FLAG_VAL_RAW;
+  }
+
+  return binson_node_set_payload( obj, node, NULL, 0 );
+}
+
+/* \brief Private helper. Free payloads adopted by tree nodes. Lazy and shared containers have
+ *         no own leaves, so they are not descended
+ *
+ * \param obj binson*
+ * \return void
+ */
+void  binson_free_owned( binson *obj )
+{
+  binson_node  *node = obj->root;
+
+  while (obj->owned && node)
+  {
+    if (node->flags & BINSON_NODE_FLAG_VAL_OWNED)
+    {
+      binson_common_free( &obj->allocator, node->u.val.bbuf_val.bptr );
+      node->flags &= (uint8_t)~BINSON_NODE_FLAG_VAL_OWNED;
+      obj->owned--;
+    }
+
+    if (!binson_node_is_leaf_type( node ) && !(node->flags & (BINSON_NODE_FLAG_LAZY | BINSON_NODE_FLAG_SHARED)) &&
+        node->u.c.first_child)
+    {
+      node = node->u.c.first_child;
+      continue;
+    }
+
+    while (node != obj->root && !node->next)
+      node = node->parent;
+
+    node = (node == obj->root)? NULL : node->next;
+  }
+
+  obj->owned      = 0;
+  obj->owned_size = 0;
+  binson_limits_apply( obj, obj->arena );
+}
+
+/* \brief Private helper. Give arena what is left of context's memory limit after adopted payloads
+ *
+ * \param obj binson*
+ * \param arena binson_arena*     Context's DOM storage, current or one to replace it
+ * \return void
+ */
+void  binson_limits_apply( binson *obj, binson_arena *arena )
+{
+  size_t  max = obj->limits.max_bytes;
+
+  if (max)
+    max = (max > obj->owned_size)? max - obj->owned_size : 1;  /* 0 would mean no limit */
+
+  binson_arena_set_limit( arena, max );
+}
+
+/* \brief Private helper. Check new STRING/BYTES payload against context's limits before
+ *         any node is created for it
+ *
+ * \param obj binson*
+ * \param size size_t
+ * \param owned bool             Payload is going to be adopted, see binson_node_adopt_payload()
+ * \return binson_res
+ */
+binson_res  binson_limits_check( binson *obj, size_t size, bool owned )
+{
+  if (!obj)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (obj->limits.max_token && size > obj->limits.max_token)
+    return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+  if (owned && obj->limits.max_bytes &&
+      binson_arena_get_size( obj->arena ) + obj->owned_size + size > obj->limits.max_bytes)
+    return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+  return BINSON_RES_OK;
+}
+
+/* \brief Private helper. Error code for failed DOM storage allocation
+ *
+ * \param obj binson*
+ * \return binson_res            BINSON_RES_ERROR_LIMIT_EXCEEDED if storage hit binson_limits.max_bytes
+ */
+binson_res  binson_no_memory( binson *obj )
+{
+  return binson_arena_limit_hit( obj->arena )? BINSON_RES_ERROR_LIMIT_EXCEEDED : BINSON_RES_ERROR_OUT_OF_MEMORY;
+}
+
+/** \brief Add new node which is a copy of specified node
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param dst binson_node**
+ * \param node binson_node*
+ * \param new_key const char*
+ * \return binson_res
+ */
+binson_res  binson_node_clone( binson *obj, binson_node *parent, binson_node **dst, binson_node *node, const char* new_key )
+{
+  binson_value      tmp_val;
+  binson_raw_value  raw;
+  binson_node      *me;
+  binson_res        res;
+
+  /* RAW mode value is decoded from source token, STRING may be not zero-terminated there */
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)
+  {
+    binson_common_decode_token( node->u.val.bbuf_val.bptr, &raw );
+
+    res = binson_node_add_empty( obj, parent, node->type, new_key, &me );
+    if (FAILED(res)) return res;
+
+    if (dst)
+      *dst = me;
+
+    return binson_node_copy_val_from_raw( obj, me, &raw );
+  }
+
+  memcpy( &tmp_val, &node->u.val, sizeof(binson_value) );
+
+  /* payload may be inline, so pass it by pointer */
+  if (node->type == BINSON_TYPE_STRING || node->type == BINSON_TYPE_BYTES)
+  {
+    tmp_val.bbuf_val.bptr  = BINSON_NODE_VAL_PTR(node);
+    tmp_val.bbuf_val.bsize = BINSON_NODE_VAL_SIZE(node);
+  }
+
+  return  binson_node_add( obj, parent, node->type, new_key, dst, &tmp_val );
+}
+
+/** \brief Add new node which is a copy of whole subtree with specified node as root.
+ *         Copy shares children with original until one of them is accessed or changed,
+ *         so untouched parts of subtree are never duplicated. Keys and payloads are shared always.
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param dst binson_node**
+ * \param node binson_node*       Must belong to the same DOM tree and must not be ancestor of \c parent
+ * \param new_key const char*
+ * \return binson_res
+ */
+binson_res  binson_node_clone_tree( binson *obj, binson_node *parent, binson_node **dst, binson_node *node, const char* new_key )
+{
+  binson_node  *me, *cur;
+  binson_res    res;
+
+  if (!obj || !parent || !node)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (binson_node_is_leaf_type( node ))
+    return binson_node_clone( obj, parent, dst, node, new_key );
+
+  /* sharing is possible inside single tree only. Copy of ancestor can't be its own descendant */
+  for (cur = parent; cur->parent; cur = cur->parent)
+    if (cur == node)
+      return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
+  if (cur == node || cur != obj->root)
+    return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
+  for (cur = node; cur->parent; cur = cur->parent) ;
+  if (cur != obj->root)
+    return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
+  res = binson_node_add_empty( obj, parent, node->type, new_key, &me );
+  if (FAILED(res)) return res;
+
+  if (dst)
+    *dst = me;
+
+  return binson_node_share_body( obj, me, node );
+}
+
+/** \brief Merge children of \c src OBJECT into \c dst OBJECT. Both children lists are sorted,
+ *         so they are merged in single pass instead of ordered insert of each child. OBJECTs
+ *         present in both are merged recursively, other children with the same key are
+ *         resolved according to \c policy
+ *
+ * \param obj binson*
+ * \param dst binson_node*         Tree root if NULL
+ * \param src_obj binson*         Context owning \c src, may be \c obj itself
+ * \param src binson_node*         Must not overlap with \c dst subtree
+ * \param policy binson_merge_policy
+ * \return binson_res             \c BINSON_RES_ERROR_TREE_KEY_CONFLICT if \c BINSON_MERGE_ERROR policy
+ *                                meets conflict, \c BINSON_RES_ERROR_LIMIT_EXCEEDED if OBJECTs merged
+ *                                recursively are nested deeper than binson_set_max_depth() allows.
+ *                                Children merged before it are kept
+ */
+binson_res  binson_node_merge( binson *obj, binson_node *dst, binson *src_obj, binson_node *src, binson_merge_policy policy )
+{
+  binson_node  *cur;
+
+  if (!obj || !src_obj || !src)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (!dst)
+    dst = obj->root;
+
+  if (!dst || dst->type != BINSON_TYPE_OBJECT || src->type != BINSON_TYPE_OBJECT || dst == src)
+    return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
+  /* subtrees would be changed while being walked */
+  if (obj == src_obj)
+  {
+    for (cur = dst->parent; cur; cur = cur->parent)
+      if (cur == src)
+        return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
+    for (cur = src->parent; cur; cur = cur->parent)
+      if (cur == dst)
+        return BINSON_RES_ERROR_ARG_WRONG_COMB;
+  }
+
+  if (policy != BINSON_MERGE_OVERWRITE && policy != BINSON_MERGE_KEEP && policy != BINSON_MERGE_ERROR)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  return binson_node_merge_object( obj, dst, src_obj, src, policy, 0 );
+}
+
+/* \brief Private helper. Single merge pass over sorted children lists of two OBJECTs.
+ *         Missing children are linked right at their place, so no key scan is done
+ *
+ * \param obj binson*
+ * \param dst binson_node*
+ * \param src_obj binson*
+ * \param src binson_node*
+ * \param policy binson_merge_policy
+ * \param depth binson_depth       Nesting level of 'src' below merged one
+ * \return binson_res
+ */
+binson_res  binson_node_merge_object( binson *obj, binson_node *dst, binson *src_obj, binson_node *src, binson_merge_policy policy, binson_depth depth )
+{
+  binson_node      *d, *s, *copy, *next;
+  const char       *key;
+  binson_raw_size   len;
+  binson_res        res;
+  int               cmp = 1;
+
+  if ((dst->flags | src->flags) & BINSON_NODE_FLAG_BULK)  /* unsorted children */
+    return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
+  if (depth >= obj->max_depth)
+    return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+  res = binson_node_unshare_path( obj, dst );
+  if (FAILED(res)) return res;
+
+  res = binson_node_expand( obj, dst );
+  if (FAILED(res)) return res;
+
+  res = binson_node_expand( src_obj, src );
+  if (FAILED(res)) return res;
+
+  binson_node_cache_drop( obj, dst );
+
+  d = dst->u.c.first_child;
+
+  for (s = src->u.c.first_child; s; s = s->next)
+  {
+    binson_node_key_ref( s, &key, &len );
+
+    while (d && (cmp = binson_node_key_cmp( d, key, len )) < 0)
+      d = d->next;
+
+    if (d && !cmp)
+    {
+      if (d->type == BINSON_TYPE_OBJECT && s->type == BINSON_TYPE_OBJECT)
+      {
+        res = binson_node_merge_object( obj, d, src_obj, s, policy, (binson_depth)(depth + 1) );
+        if (FAILED(res)) return res;
+
+        d = d->next;
+        continue;
+      }
+
+      if (policy == BINSON_MERGE_KEEP)
+      {
+        d = d->next;
+        continue;
+      }
+
+      if (policy == BINSON_MERGE_ERROR)
+        return BINSON_RES_ERROR_TREE_KEY_CONFLICT;
+    }
+
+    /* detached copy is made first, so failure leaves overwritten child in place */
+    copy = NULL;
+    res = binson_node_copy_tree( obj, NULL, NULL, src_obj, s, &copy );
+    if (SUCCESS(res))
+      res = binson_node_set_key( obj, copy, key, len );
+
+    if (FAILED(res))
+    {
+      if (copy)
+        binson_node_remove( obj, copy );
+      return res;
+    }
+
+    /* overwritten child goes before copy is linked, so index never holds the key twice */
+    if (d && !cmp)
+    {
+      next = d->next;
+      res = binson_node_remove( obj, d );
+      if (FAILED(res)) return res;
+      d = next;
+    }
+
+    res = d? binson_node_move_before( obj, copy, d ) : binson_node_attach_last( obj, dst, copy );
+    if (FAILED(res)) return res;
+  }
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Start bulk build of OBJECT. New children are appended as is, without ordered insert
+ *         and hash index update, until binson_node_bulk_commit() sorts them at once. Key lookups
+ *         work meanwhile, while serialization, diff, merge and hashing fail with
+ *         \c BINSON_RES_ERROR_ARG_WRONG_COMB until commit
+ *
+ * \param obj binson*
+ * \param node binson_node*        Tree root if NULL
+ * \return binson_res
+ */
+binson_res  binson_node_bulk_begin( binson *obj, binson_node *node )
+{
+  binson_res  res;
+
+  if (!obj)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (!node)
+    node = obj->root;
+
+  if (!node || node->type != BINSON_TYPE_OBJECT)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_node_unshare_path( obj, node );
+  if (FAILED(res)) return res;
+
+  res = binson_node_expand( obj, node );
+  if (FAILED(res)) return res;
+
+  /* index is rebuilt on commit. Old table storage stays in arena till reset */
+  if (node->u.c.ext)
+  {
+    node->u.c.ext->htab  = NULL;
+    node->u.c.ext->hsize = 0;
+    node->u.c.ext->hused = 0;
+  }
+
+  node->flags |= BINSON_NODE_FLAG_BULK;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Finish bulk build of OBJECT, see binson_node_bulk_begin(). Children are sorted with
+ *         stable merge sort in O(n log n), then duplicate keys are resolved according to \c policy:
+ *         \c BINSON_MERGE_OVERWRITE keeps last added child, \c BINSON_MERGE_KEEP keeps first one
+ *
+ * \param obj binson*
+ * \param node binson_node*        Tree root if NULL
+ * \param policy binson_merge_policy
+ * \return binson_res              \c BINSON_RES_ERROR_TREE_KEY_CONFLICT if \c BINSON_MERGE_ERROR policy
+ *                                 meets duplicates. Node stays in bulk mode then
+ */
+binson_res  binson_node_bulk_commit( binson *obj, binson_node *node, binson_merge_policy policy )
+{
+  binson_node      *child, *next;
+  const char       *key;
+  binson_raw_size   len;
+  binson_res        res;
+
+  if (!obj)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (!node)
+    node = obj->root;
+
+  if (!node || !(node->flags & BINSON_NODE_FLAG_BULK))
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (policy != BINSON_MERGE_OVERWRITE && policy != BINSON_MERGE_KEEP && policy != BINSON_MERGE_ERROR)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  /* clones keep order of addition, since they are committed on their own */
+  res = binson_node_unshare_path( obj, node );
+  if (FAILED(res)) return res;
+
+  res = binson_node_expand( obj, node );
+  if (FAILED(res)) return res;
+
+  binson_node_sort_children( node );
+  binson_node_cache_drop( obj, node );
+
+  if (node->u.c.ext)
+    node->u.c.ext->cvec_valid = false;
+
+  /* equal keys are neighbours now, in order of addition */
+  for (child = node->u.c.first_child; child && child->next; child = next)
+  {
+    next = child->next;
+    binson_node_key_ref( child, &key, &len );
+
+    if (!BINSON_NODE_HAS_KEY(next) || binson_node_key_cmp( next, key, len ))
+      continue;
+
+    if (policy == BINSON_MERGE_ERROR)
+      return BINSON_RES_ERROR_TREE_KEY_CONFLICT;
+
+    if (policy == BINSON_MERGE_KEEP)
+    {
+      res = binson_node_remove( obj, next );
+      next = child;
+    }
+    else
+      res = binson_node_remove( obj, child );
+
+    if (FAILED(res)) return res;
+  }
+
+  node->flags &= (uint8_t)~BINSON_NODE_FLAG_BULK;
+
+  return (node->child_cnt > BINSON_HASH_INDEX_THRESHOLD)? binson_node_index_build( obj, node ) : BINSON_RES_OK;
+}
+
+/* \brief Private helper. Merge two key-sorted lists linked via 'next'. Nodes of 'a' go first on equal keys
+ *
+ * \param a binson_node*
+ * \param b binson_node*
+ * \return binson_node*
+ */
+binson_node*  binson_node_sort_merge( binson_node *a, binson_node *b )
+{
+  binson_node      *head = NULL, **ptail = &head;
+  const char       *key;
+  binson_raw_size   len;
+
+  while (a && b)
+  {
+    binson_node_key_ref( a, &key, &len );
+
+    if (binson_node_key_cmp( b, key, len ) < 0)
+    {
+      *ptail = b;
+      b = b->next;
+    }
+    else
+    {
+      *ptail = a;
+      a = a->next;
+    }
+
+    ptail = &(*ptail)->next;
+  }
+
+  *ptail = a? a : b;
+
+  return head;
+}
+
+/* \brief Private helper. Stable bottom-up merge sort of container's children by key.
+ *         Bin 'k' holds sorted run of 2^k nodes, so there are no more bins than bits of child counter
+ *
+ * \param parent binson_node*
+ * \return void
+ */
+void  binson_node_sort_children( binson_node *parent )
+{
+  binson_node  *bins[ 8 * sizeof(binson_child_num) ];
+  binson_node  *list = parent->u.c.first_child, *run, *prev;
+  size_t        k, cnt = sizeof(bins) / sizeof(bins[0]);
+
+  memset( bins, 0, sizeof(bins) );
+
+  while (list)
+  {
+    run = list;
+    list = list->next;
+    run->next = NULL;
+
+    /* earlier runs are always first argument, which keeps sort stable */
+    for (k = 0; k < cnt - 1 && bins[k]; k++)
+    {
+      run = binson_node_sort_merge( bins[k], run );
+      bins[k] = NULL;
+    }
+
+    bins[k] = bins[k]? binson_node_sort_merge( bins[k], run ) : run;
+  }
+
+  for (run = NULL, k = 0; k < cnt; k++)
+    if (bins[k])
+      run = binson_node_sort_merge( bins[k], run );
+
+  /* restore back links */
+  parent->u.c.first_child = run;
+  for (prev = NULL; run; prev = run, run = run->next)
+    run->prev = prev;
+
+  parent->u.c.last_child = prev;
+}
+
+/** \brief Creates empty ARRAY node and connects it to specified parent
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param dst binson_node**
+ * \return binson_res
+ */
+binson_res  binson_node_add_array_empty( binson *obj, binson_node *parent, const char* key, binson_node **dst )
+{
+  return  binson_node_add_empty( obj, parent, BINSON_TYPE_ARRAY, key, dst );
+}
+
+/** \brief Remove subtree with specified node as root
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \return binson_res
+ */
+binson_res  binson_node_remove( binson *obj, binson_node *node )
+{
+  binson_res   res = BINSON_RES_OK;
+  binson_node *cur, *up;
+
+  if (!obj || !node)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (node == obj->root)
+    obj->root = NULL;
+
+  if (node->parent)
+  {
+    res = binson_node_unshare_path( obj, node->parent );
+    if (FAILED(res)) return res;
+
+    binson_node_cache_drop( obj, node->parent );
+  }
+
+  res = binson_node_detach( obj, node );
+  if (FAILED(res)) return res;
+
+  /* postorder walk over detached subtree. Children links are cut on the way down,
+     so each visited container looks like a leaf on the way back up */
+  cur = node;
+  while (cur)
+  {
+    if (!binson_node_is_leaf_type(cur) && !(cur->flags & (BINSON_NODE_FLAG_LAZY | BINSON_NODE_FLAG_SHARED)) && cur->u.c.first_child)
+    {
+      /* clones still sharing removed children get own copies */
+      res = binson_node_unshare( obj, cur );
+      if (FAILED(res)) return res;
+
+      up = cur->u.c.first_child;
+      cur->u.c.first_child = cur->u.c.last_child = NULL;
+      cur = up;
+      continue;
+    }
+
+    up = (cur == node)? NULL : (cur->next? cur->next : cur->parent);
+
+    res = binson_cb_remove( obj, cur, NULL, NULL );
+    if (FAILED(res)) return res;
+
+    cur = up;
+  }
+
+  return res;
+}
+
+/** \brief
+ *
+ * \param obj binson*
+ * \param pwriter binson_writer*
+ * \param psize binson_raw_size* Return number of bytes written. Specify NULL to ignore.
+ * \return binson_res
+ *
+ */
+binson_res  binson_serialize( binson *obj, binson_writer *pwriter, binson_raw_size *psize )
+{
+  binson_io    *io;
+  bool          use_cache;
+  binson_res    res, res2;
+
+  if (!obj || !pwriter)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  io = binson_writer_get_io( pwriter );
+
+  if (psize)
+    res2 = binson_io_reset_counters( io );
+
+  /* encoded containers are cached only if output can be read back, see binson_set_serialize_cache() */
+  use_cache = obj->serialize_cache && binson_writer_get_format( pwriter ) == BINSON_WRITER_FORMAT_RAW;
+
+  res = binson_serialize_tree( obj, pwriter, obj->root, NULL, use_cache );
+
+  if (psize)
+    res2 = binson_io_get_write_counter( io, psize );
+
+  UNUSED(res2);
+
+  return res;
+}
+
+/* \brief Private helper. Write subtree with preorder walk. Containers are closed on the way up,
+ *         'begin' is stack of open ones
+ *
+ * \param obj binson*
+ * \param writer binson_writer*
+ * \param root binson_node*
+ * \param root_key const char**     NULL to write root with own key, otherwise key to write root with
+ * \param use_cache bool
+ * \return binson_res
+ */
+binson_res  binson_serialize_tree( binson *obj, binson_writer *writer, binson_node *root, const char **root_key, bool use_cache )
+{
+  binson_node  *node = root;
+  binson_io    *io = binson_writer_get_io( writer );
+  uint8_t      *local[BINSON_DEPTH_STACK_SIZE];
+  uint8_t     **begin = local, **tmp;             /* output positions of open containers, NULL if not cached */
+  size_t        cap = BINSON_DEPTH_STACK_SIZE;
+  int           top = 0;
+  bool          opened, rekey;
+  binson_res    res = BINSON_RES_OK;
+
+  while (node && SUCCESS(res))
+  {
+    res = binson_node_expand( obj, node );
+    if (FAILED(res)) break;
+
+    opened = false;
+    rekey  = root_key && node == root;   /* cached encoding includes own key, so it's useless then */
+
+    if (binson_node_is_leaf_type( node ))
+      res = rekey? binson_node_write_as( obj, writer, node, *root_key ) : binson_node_write( obj, writer, node, false );
+    else if (node->flags & BINSON_NODE_FLAG_BULK)
+      res = BINSON_RES_ERROR_ARG_WRONG_COMB;   /* unsorted keys are not valid Binson */
+    else if (use_cache && !rekey && node->u.c.ext && node->u.c.ext->cache_size)  /* whole subtree at once */
+      res = binson_writer_write_raw( writer, node->u.c.ext->cache, node->u.c.ext->cache_size );
+    else if (top >= obj->max_depth)
+      res = BINSON_RES_ERROR_LIMIT_EXCEEDED;   /* deeper than parser is allowed to read back */
+    else
+    {
+      tmp = (uint8_t **)binson_common_stack_grow( &obj->allocator, begin, &cap, (size_t)top, sizeof(uint8_t *), local );
+      if (!tmp)
+      {
+        res = BINSON_RES_ERROR_OUT_OF_MEMORY;
+        break;
+      }
+      begin = tmp;
+
+      if (!use_cache || rekey || binson_io_get_buf_ptr( io, &begin[top], NULL ) != BINSON_RES_OK)
+        begin[top] = NULL;
+
+      top++;
+      opened = true;
+
+      res = rekey? binson_node_write_as( obj, writer, node, *root_key ) : binson_node_write( obj, writer, node, false );
+      if (SUCCESS(res) && node->u.c.first_child)
+      {
+        node = node->u.c.first_child;
+        continue;
+      }
+    }
+
+    if (opened && SUCCESS(res))  /* empty container */
+      res = binson_serialize_close( obj, writer, node, begin[--top] );
+
+    while (SUCCESS(res) && node != root && !node->next)
+    {
+      node = node->parent;
+      res = binson_serialize_close( obj, writer, node, begin[--top] );
+    }
+
+    node = (node == root)? NULL : node->next;
+  }
+
+  binson_common_stack_free( &obj->allocator, begin, local );
+
+  return res;
+}
+
+/* \brief Private helper. Write closing part of container and cache its encoding if it's
+ *         big enough, see binson_set_serialize_cache()
+ *
+ * \param obj binson*
+ * \param writer binson_writer*
+ * \param node binson_node*
+ * \param begin const uint8_t*     Output position of container's opening part. NULL to skip caching
+ * \return binson_res
+ */
+binson_res  binson_serialize_close( binson *obj, binson_writer *writer, binson_node *node, const uint8_t *begin )
+{
+  uint8_t     *end;
+  binson_res   res = binson_node_write( obj, writer, node, true );
+
+  if (FAILED(res) || !begin || binson_io_get_buf_ptr( binson_writer_get_io( writer ), &end, NULL ) != BINSON_RES_OK)
+    return res;
+
+  /* output is complete anyway, so no room for optional copy is not an error */
+  if (end - begin >= BINSON_SERIALIZE_CACHE_THRESHOLD)
+    binson_node_cache_store( obj, node, begin, (binson_raw_size)(end - begin) );
+
+  return BINSON_RES_OK;
+}
+
+/**
+ *  Called by parser for each token group, used to build binson model
+ */
+binson_res binson_cb_build( binson_parser *parser, uint8_t token_cnt, binson_token_buf *tbuf, void* param )
+{
+  binson_cb_build_param_  *p = (binson_cb_build_param_ *)param;
+  binson_node             *new_node = NULL;
+  binson_raw_value         raw_key, raw_val;
+  binson_res               res = BINSON_RES_OK;
+  binson_node_type         node_type;
+  bool                     is_closing_token;  /* true, if current token is final part of OBJECT/ARRAY */
+  uint8_t                 *src_key = NULL;    /* RAW mode: key and value tokens inside parser's source buffer */
+  uint8_t                 *src_val = NULL;
+  uint8_t                 *tok0, *tok;
+  binson_raw_size          tok_size, grp_size = 0;
+  uint8_t                  i;
+
+  memset(&raw_key, 0, sizeof(binson_raw_value));
+  memset(&raw_val, 0, sizeof(binson_raw_value));
+
+  /* RAW mode needs source buffer in memory. Token group ends right at source's current position */
+  if (binson_parser_get_mode( parser ) == BINSON_PARSER_MODE_RAW &&
+      binson_io_get_buf_ptr( binson_parser_get_io( parser ), &src_val, NULL ) == BINSON_RES_OK)
+  {
+    for (i = 0; i < token_cnt; i++)
+    {
+      binson_token_buf_get_token_size( tbuf, i, &tok_size );
+      grp_size += tok_size;
+    }
+
+    binson_token_buf_get_token_ptr( tbuf, 0, &tok0 );
+    binson_token_buf_get_token_ptr( tbuf, (uint8_t)(token_cnt - 1), &tok );
+
+    src_key = src_val - grp_size;
+    src_val = src_key + (tok - tok0);
+  }
+
+  if (token_cnt > 1)
+  {
+    res = binson_token_buf_get_node_type( tbuf, 1, &node_type, &is_closing_token );
+    res = binson_token_buf_get_token_payload( tbuf, 0, &raw_key );
+    res = binson_token_buf_get_token_payload( tbuf, 1, &raw_val );
+  }
+  else
+  {
+   res = binson_token_buf_get_node_type( tbuf, 0, &node_type, &is_closing_token );
+   if (node_type != BINSON_TYPE_OBJECT && node_type != BINSON_TYPE_ARRAY)
+   {
+      res = binson_token_buf_get_token_payload( tbuf, 0, &raw_val );
+      raw_key.bbuf_val.bsize = 0;  /* make sure raw_key is empty */
+   }
+  }
+
+  if (!is_closing_token)
+  {
+    const char  *key = NULL;
+    size_t       key_len = 0;
+
+    if ( !p->parent_last || p->parent_last->type == BINSON_TYPE_ARRAY)  /* no key, no parent or ARRAY */
+    {
+      key = NULL;
+    }
+    else if (!raw_key.bbuf_val.bsize && p->top_key)  /* parent is OBJECT but we have no parsed key, so key from argument  */
+    {
+      key     = p->top_key;
+      key_len = strlen(p->top_key);
+    }
+    else /* use key from parser */
+    {
+      key     = (const char*)raw_key.bbuf_val.bptr;
+      key_len = raw_key.bbuf_val.bsize;
+    }
+
+    /* deserialization which replace whole DOM tree. Old tree storage is released at once */
+    if (!p->parent_last && p->obj->root)
+    {
+      binson_free_owned( p->obj );
+      res = binson_arena_reset( p->obj->arena );
+      p->obj->root       = NULL;
+      p->obj->free_nodes = NULL;
+      p->obj->nodes      = 0;
+      p->obj->shared     = 0;
+      p->obj->cache_used = false;
+    }
+
+    /* allocating new node structure. RAW mode node refers to parsed key in place */
+    if (src_key && key && key == (const char*)raw_key.bbuf_val.bptr)
+    {
+      res = binson_node_create( p->obj, node_type, NULL, 0, &new_node );
+      if (FAILED(res)) return res;
+
+      new_node->key.ptr = (char*)src_key;
+      new_node->flags |= BINSON_NODE_FLAG_KEY_RAW;
+    }
+    else
+    {
+      res = binson_node_create( p->obj, node_type, key, key_len, &new_node );
+      if (FAILED(res)) return res;
+    }
+
+    if (p->parent_last)
+    {
+      /* RAW mode node refers to value token, numbers are decoded on request */
+      if (src_val && node_type != BINSON_TYPE_BOOLEAN && binson_node_is_leaf_type( new_node ))
+      {
+        new_node->u.val.bbuf_val.bptr = src_val;
+        new_node->flags |= BINSON_NODE_FLAG_VAL_RAW;
+      }
+      else
+        res = binson_node_copy_val_from_raw( p->obj, new_node, &raw_val );
+
+      if (FAILED(res)) return res;
+
+      /* nodes created during this parsing need no ordering in trusted mode */
+      if (p->obj->sorted_input && p->parent_last != p->root_node)
+        res = binson_node_attach_last( p->obj, p->parent_last, new_node );
+      else
+        res = binson_node_attach( p->obj, p->parent_last, new_node );
+    }
+    else
+    {
+      p->obj->root = new_node;
+    }
+  } /* if (!is_closing_token) ... */
+
+  if (node_type == BINSON_TYPE_ARRAY || node_type == BINSON_TYPE_OBJECT)
+    p->parent_last = is_closing_token? p->parent_last->parent : new_node;
+
+  return res;
+}
+
+/** \brief
+ *
+ * \param obj binson*
+ * \param pparser binson_parser*
+ * \param parent binson_node*   If NULL, replaces whole DOM tree
+ * \param key const char*       Used if parent is OBJECT, otherwise ignored
+ * \param validate_only bool
+ * \return binson_res
+ */
+binson_res  binson_deserialize( binson *obj, binson_parser *pparser, binson_node *parent, const char* key, bool validate_only )
+{
+  binson_cb_build_param_  param;
+  binson_res              res;
+
+  if (!obj || !pparser)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  UNUSED(validate_only);
+
+  param.obj          = obj;
+  param.root_node    = parent;
+  param.parent_last  = parent; /*obj->root;*/
+  param.top_key      = key;
+
+  if (parent)
+  {
+    res = binson_node_unshare_path( obj, parent );
+    if (FAILED(res)) return res;
+
+    res = binson_node_expand( obj, parent );
+    if (FAILED(res)) return res;
+
+    binson_node_cache_drop( obj, parent );
+  }
+
+  if (binson_parser_get_mode( pparser ) == BINSON_PARSER_MODE_SMART)
+    res = binson_deserialize_lazy( obj, binson_parser_get_io( pparser ), parent, key );
+  else
+    res = BINSON_RES_ERROR_NOT_SUPPORTED;
+
+  if (res == BINSON_RES_ERROR_NOT_SUPPORTED)  /* not a memory buffer, parse as usual */
+    res = binson_parser_parse( pparser, binson_cb_build,  &param );
+
+  /* let getters without context argument copy out RAW mode references and expand lazy containers */
+  if (binson_parser_get_mode( pparser ) != BINSON_PARSER_MODE_DOM && obj->root && !binson_node_is_leaf_type( obj->root ))
+  {
+    if (!binson_node_ext_get( obj, obj->root ))
+      return binson_no_memory( obj );
+
+    obj->root->u.c.ext->owner = obj;
+  }
+
+  return res;
+}
+
+/* \brief Lazy deserialization used in BINSON_PARSER_MODE_SMART. Whole input is validated, but only
+ *         top level container's children are created. Nested containers are parsed on first access
+ *
+ * \param obj binson*
+ * \param io binson_io*
+ * \param parent binson_node*   If NULL, replaces whole DOM tree
+ * \param key const char*       Used if parent is OBJECT, otherwise ignored
+ * \return binson_res           BINSON_RES_ERROR_NOT_SUPPORTED if source is not memory buffer
+ */
+binson_res  binson_deserialize_lazy( binson *obj, binson_io *io, binson_node *parent, const char* key )
+{
+  binson_node      *node;
+  binson_raw_size   size;
+  uint8_t          *ptr;
+  size_t            avail;
+  binson_res        res;
+  bool              closing;
+
+  res = binson_io_get_buf_ptr( io, &ptr, &avail );
+  if (res != BINSON_RES_OK)
+    return res;
+
+  res = binson_node_raw_scan( obj, ptr, (binson_raw_size)avail, &size );
+  if (FAILED(res)) return res;
+
+  if (!parent || parent->type == BINSON_TYPE_ARRAY)
+    key = NULL;
+
+  if (parent)
+  {
+    res = binson_node_expand( obj, parent );
+    if (FAILED(res)) return res;
+  }
+  else  /* whole tree is replaced, so old tree storage is released at once */
+  {
+    binson_free_owned( obj );
+    res = binson_arena_reset( obj->arena );
+    obj->root       = NULL;
+    obj->free_nodes = NULL;
+    obj->nodes      = 0;
+    obj->shared     = 0;
+    obj->cache_used = false;
+  }
+
+  res = binson_node_create( obj, binson_common_map_sig_to_node_type( *ptr, &closing ), key, key? strlen(key) : 0, &node );
+  if (FAILED(res)) return res;
+
+  node->u.lazy.begin = ptr;
+  node->u.lazy.size  = size;
+  node->lazy_sorted  = obj->sorted_input;
+  node->flags |= BINSON_NODE_FLAG_LAZY;
+
+  if (parent)
+    res = binson_node_attach( obj, parent, node );
+  else
+    obj->root = node;
+
+  if (FAILED(res)) return res;
+
+  /* top level children are created at once */
+  res = binson_node_expand( obj, node );
+  if (FAILED(res)) return res;
+
+  return binson_io_skip( io, size );
+}
+
+/** \brief Begin tree traversal and process first available node
+ *
+ * \param
+ * \param
+ * \return
+ */
+binson_res  binson_traverse_first( binson *obj, binson_node *root_node, binson_traverse_method t_method, int max_depth, \
+                                     binson_traverse_callback cb, binson_traverse_cb_status *status, void* param )
+{
+    binson_res res = BINSON_RES_OK;
+
+    if (status && obj && root_node)  /* first iteration */
+    {
+      /* store parameters to status structure */
+      status->obj         = obj;
+      status->root_node   = root_node;
+      status->t_method    = t_method;
+      status->max_depth   = max_depth;
+      status->cb          = cb;
+      status->param       = param;
+
+      /* initialize state variables */
+      status->current_node = root_node;
+
+      status->dir         = BINSON_TRAVERSE_DIR_UNKNOWN;
+      status->child_num   = 0;
+      status->depth       = 0;
+      status->done        = false;
+
+      /* required for tree deletion to prevent sawing one's bough */
+      res = binson_node_expand( status->obj, status->current_node );
+      if (FAILED(res)) return res;
+      memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+
+      /* check if we need to process root node at first iteration */
+      if (status->t_method != BINSON_TRAVERSE_POSTORDER)
+        return status->cb( status->obj, status->current_node, status, status->param );
+    }
+
+    if (status && status->done)
+      return BINSON_RES_TRAVERSAL_DONE;
+
+    /* non-first iteration. */
+    if (status->dir == BINSON_TRAVERSE_DIR_UP ||
+        status->depth >= status->max_depth ||
+        binson_node_get_first_child( &status->current_node_copy ) == NULL)  /* there is no way down */
+    {
+      bool empty_container = false;
+
+      if ((status->current_node_copy.type == BINSON_TYPE_OBJECT || status->current_node_copy.type == BINSON_TYPE_ARRAY) &&
+           binson_node_get_first_child( &status->current_node_copy ) == NULL && status->t_method != BINSON_TRAVERSE_PREORDER )
+          empty_container = true;  
+      
+      if (status->current_node && status->current_node_copy.next) /* we can move right */
+      {
+          /* process closing part of empty OBJECT/ARRAY */	  
+          if (status->depth > 0 && empty_container && status->t_method == BINSON_TRAVERSE_BOTHORDER)
+	  {
+	    status->dir  = BINSON_TRAVERSE_DIR_UP;	    
+            res = status->cb( status->obj, status->current_node, status, status->param );  
+	  }
+	
+          status->current_node = status->current_node_copy.next;  /* update current node to it */
+          status->dir = BINSON_TRAVERSE_DIR_RIGHT;
+          status->child_num++;  /* keep track of index */
+
+          /* required for tree deletion to prevent sawing one's bough */
+          res = binson_node_expand( status->obj, status->current_node );
+          if (FAILED(res)) return res;
+          memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+
+          if (status->t_method != BINSON_TRAVERSE_POSTORDER)
+            return status->cb( status->obj, status->current_node, status, status->param );
+      }
+      else /* no more neighbors from the right, moving up */
+      {
+        status->dir          = BINSON_TRAVERSE_DIR_UP;
+
+        /* process closing part of empty OBJECT/ARRAY */
+        if (status->depth > 0 && empty_container && status->t_method == BINSON_TRAVERSE_BOTHORDER)
+          res = status->cb( status->obj, status->current_node, status, status->param );
+
+        if (status->current_node_copy.parent)  /* root node case - prevent NULL assignment */
+          status->current_node = status->current_node_copy.parent;
+
+        if (!empty_container)  /* empty containers process on same depth level */
+        {
+           status->depth--;
+           if (status->depth < 0)
+           {
+             status->done = true;
+             return res;
+           }
+        }
+
+        /* required for tree deletion to prevent sawing one's bough */
+        memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+
+        if (status->t_method != BINSON_TRAVERSE_PREORDER)
+          res = status->cb( status->obj, status->current_node, status, status->param );
+
+        if (empty_container)   /* change depth after empty container processed */
+        {
+           status->depth--;
+           if (status->depth < 0)
+           {
+             status->done = true;
+             return res;
+           }
+        }
+      }
+    }
+    else  /* last processed has some children */
+    {
+       status->current_node = status->current_node_copy.u.c.first_child;   /* select leftmost child */
+       status->dir          = BINSON_TRAVERSE_DIR_DOWN;
+       status->child_num    = 0;
+       status->depth++;
+
+       /* required for tree deletion to prevent sawing one's bough */
+       res = binson_node_expand( status->obj, status->current_node );
+       if (FAILED(res)) return res;
+       memcpy( &status->current_node_copy, status->current_node, sizeof(binson_node) );
+
+      if (status->t_method != BINSON_TRAVERSE_POSTORDER || binson_node_get_first_child( &status->current_node_copy ) == NULL)
+        res = status->cb( status->obj, status->current_node, status, status->param );         
+    }
+
+    return res;
+}
+
+/** \brief Continue tree traversal and process next available
+ *
+ * \param status binson_traverse_cb_status*
+ * \return binson_res
+ */
+binson_res  binson_traverse_next( binson_traverse_cb_status *status )
+{
+    /* to have code logic located in one place let's reuse 'binson_traverse_begin' function.
+    / calling it with NULL pointers will make it work like 'binson_traverse_next'. */
+    return binson_traverse_first( NULL, NULL, status->t_method, status->max_depth, status->cb, status, status->param);
+}
+
+/** \brief No more nodes to process?
+ *
+ * \param status binson_traverse_cb_status*
+ * \return bool
+ */
+bool  binson_traverse_is_done( binson_traverse_cb_status *status )
+{
+  return status->done;
+}
+
+/** \brief Which is current node being traversed?
+ *
+ * \param status binson_traverse_cb_status*
+ * \return binson_node*
+ */
+binson_node*    binson_traverse_get_current_node( binson_traverse_cb_status *status )
+{
+  return status->current_node;
+}
+
+/** \brief How traversal came to current node? \c BINSON_TRAVERSE_DIR_UP means
+ *         closing part of OBJECT/ARRAY when \c BINSON_TRAVERSE_BOTHORDER is used
+ *
+ * \param status binson_traverse_cb_status*
+ * \return binson_traverse_dir
+ */
+binson_traverse_dir  binson_traverse_get_dir( binson_traverse_cb_status *status )
+{
+  return status->dir;
+}
+
+/** \brief Traverse all subtree with 'root_node' as subtree root
+ *
+ * \param
+ * \param
+ * \return
+ */
+binson_res  binson_traverse( binson *obj, binson_node *root_node, binson_traverse_method t_method, int max_depth, \
+                               binson_traverse_callback cb, void* param )
+{
+  binson_traverse_cb_status  status;
+  binson_res res = binson_traverse_first( obj, root_node, t_method, max_depth, cb, &status, param );
+
+  while (!binson_traverse_is_done( &status ))
+    res = binson_traverse_next( &status );
+
+  return res;
+}
+
+/*
+ *  binson_iter states. Kind of last reported event for 'it->node'
+ */
+#define BINSON_ITER_STATE_INIT    0     /* nothing reported yet */
+#define BINSON_ITER_STATE_OPEN    1     /* container entered, its children are next */
+#define BINSON_ITER_STATE_LEAF    2     /* leaf or container not descended due to depth limit */
+#define BINSON_ITER_STATE_SKIP    3     /* container entered, its children are skipped */
+#define BINSON_ITER_STATE_CLOSE   4     /* container left */
+#define BINSON_ITER_STATE_DONE    5
+
+/** \brief Initialize iterator over subtree with 'root_node' as subtree root.
+ *         Unlike binson_traverse() no callbacks are called and no node copies are made
+ *
+ * Node reported as leaf or as closing part of container may be removed before next
+ * binson_iter_next() call. Removing node reported as opening part of container is not allowed.
+ *
+ * \param it binson_iter*           Iterator storage provided by caller
+ * \param obj binson*
+ * \param root_node binson_node*
+ * \param t_method binson_traverse_method
+ * \param max_depth int             Containers at this depth are reported as leaves
+ * \return binson_res
+ */
+binson_res  binson_iter_init( binson_iter *it, binson *obj, binson_node *root_node, binson_traverse_method t_method, int max_depth )
+{
+  if (!it || !obj || !root_node)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  it->obj        = obj;
+  it->root_node  = root_node;
+  it->node       = NULL;
+  it->next       = NULL;
+  it->parent     = NULL;
+  it->depth      = 0;
+  it->max_depth  = max_depth;
+  it->t_method   = t_method;
+  it->state      = BINSON_ITER_STATE_INIT;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Move to next node in selected order
+ *
+ * \param it binson_iter*
+ * \param pnode binson_node**       Next node, NULL when done
+ * \return binson_res               \c BINSON_RES_TRAVERSAL_DONE when no more nodes
+ */
+binson_res  binson_iter_next( binson_iter *it, binson_node **pnode )
+{
+  binson_node  *node;
+  binson_res    res;
+
+  if (!it || !pnode)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pnode = NULL;
+
+  do
+  {
+    switch (it->state)
+    {
+      case BINSON_ITER_STATE_INIT:
+        node = it->root_node;
+        break;
+
+      case BINSON_ITER_STATE_OPEN:
+        if (it->node->u.c.first_child)
+        {
+          node = it->node->u.c.first_child;
+          it->depth++;
+          break;
+        }
+        it->next   = it->node->next;  /* empty container is left at once */
+        it->parent = it->node->parent;
+        it->state  = BINSON_ITER_STATE_CLOSE;
+        continue;
+
+      case BINSON_ITER_STATE_SKIP:
+        it->next   = it->node->next;
+        it->parent = it->node->parent;
+        it->state  = BINSON_ITER_STATE_CLOSE;
+        continue;
+
+      case BINSON_ITER_STATE_LEAF:
+      case BINSON_ITER_STATE_CLOSE:
+        if (it->node == it->root_node)
+        {
+          it->state = BINSON_ITER_STATE_DONE;
+          return BINSON_RES_TRAVERSAL_DONE;
+        }
+        if (it->next)
+        {
+          node = it->next;
+          break;
+        }
+        it->node   = it->parent;      /* no more siblings, leaving parent */
+        it->next   = it->node->next;
+        it->parent = it->node->parent;
+        it->state  = BINSON_ITER_STATE_CLOSE;
+        it->depth--;
+        continue;
+
+      default:
+        return BINSON_RES_TRAVERSAL_DONE;
+    }
+
+    /* entering 'node' */
+    it->node = node;
+
+    if ((node->type == BINSON_TYPE_OBJECT || node->type == BINSON_TYPE_ARRAY) && it->depth < it->max_depth)
+    {
+      res = binson_node_expand( it->obj, node );
+      if (FAILED(res)) return res;
+
+      it->state = BINSON_ITER_STATE_OPEN;
+    }
+    else
+    {
+      it->next   = node->next;
+      it->parent = node->parent;
+      it->state  = BINSON_ITER_STATE_LEAF;
+    }
+
+  } while ((it->state == BINSON_ITER_STATE_OPEN && it->t_method == BINSON_TRAVERSE_POSTORDER) ||
+           (it->state == BINSON_ITER_STATE_CLOSE && it->t_method == BINSON_TRAVERSE_PREORDER));
+
+  *pnode = it->node;
+  return BINSON_RES_OK;
+}
+
+/** \brief Don't descend into container just reported as opened. With \c BINSON_TRAVERSE_BOTHORDER
+ *         next reported node is closing part of same container
+ *
+ * \param it binson_iter*
+ * \return binson_res
+ */
+binson_res  binson_iter_skip_children( binson_iter *it )
+{
+  if (!it || it->state != BINSON_ITER_STATE_OPEN)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  it->state = BINSON_ITER_STATE_SKIP;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Is last reported node closing part of container?
+ *
+ * \param it binson_iter*
+ * \return bool
+ */
+bool  binson_iter_is_closing( binson_iter *it )
+{
+  return it && it->state == BINSON_ITER_STATE_CLOSE;
+}
+
+/** \brief Depth of last reported node relative to iteration root
+ *
+ * \param it binson_iter*
+ * \return int
+ */
+int  binson_iter_get_depth( binson_iter *it )
+{
+  return it? it->depth : -1;
+}
+
+/** \brief  Trust OBJECT keys in deserialized input are already sorted, so
+ *          binson_deserialize() appends nodes without any key comparison.
+ *          Unsorted input gives unsorted DOM tree in this mode, and key lookups
+ *          relying on sorted sibling order may miss nodes. Containers left unparsed by
+ *          \c BINSON_PARSER_MODE_SMART keep mode which was set when they were deserialized
+ *
+ * \param obj binson*
+ * \param sorted bool
+ * \return binson_res
+ */
+binson_res  binson_set_sorted_input( binson *obj, bool sorted )
+{
+  if (!obj)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  obj->sorted_input = sorted;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief  Keep encoded copy of each OBJECT/ARRAY bigger than \c BINSON_SERIALIZE_CACHE_THRESHOLD
+ *          bytes, so binson_serialize() to RAW format memory buffer re-encodes only changed
+ *          containers. Any change of the subtree drops copies on the way up to root.
+ *          Costs extra memory up to encoded size per nesting level.
+ *
+ * \param obj binson*
+ * \param enable bool
+ * \return binson_res
+ */
+binson_res  binson_set_serialize_cache( binson *obj, bool enable )
+{
+  if (!obj)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  obj->serialize_cache = enable;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief  Keep structural hash of each OBJECT/ARRAY with more than \c BINSON_HASH_CACHE_THRESHOLD
+ *          children, so repeated binson_node_hash() calls and binson_node_equal() on unchanged
+ *          subtrees are cheap. Any change of the subtree drops hashes on the way up to root.
+ *
+ * \param obj binson*
+ * \param enable bool
+ * \return binson_res
+ */
+binson_res  binson_set_hash_cache( binson *obj, bool enable )
+{
+  if (!obj)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  obj->hash_cache = enable;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief  Set resource ceilings. Nodes, keys, payloads, adopted buffers, caches and indexes
+ *          are all accounted. Operation which would exceed a limit fails with
+ *          \c BINSON_RES_ERROR_LIMIT_EXCEEDED. Usage already above new limits is not released
+ *
+ * \param obj binson*
+ * \param limits const binson_limits*   NULL to remove all limits
+ * \return binson_res
+ */
+binson_res  binson_set_limits( binson *obj, const binson_limits *limits )
+{
+  if (!obj)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (limits)
+    obj->limits = *limits;
+  else
+    memset( &obj->limits, 0, sizeof(binson_limits) );
+
+  binson_limits_apply( obj, obj->arena );
+
+  return BINSON_RES_OK;
+}
+
+/** \brief  Set max nesting depth of trees serialized by binson_serialize(), read by
+ *          binson_deserialize() in \c BINSON_PARSER_MODE_SMART and walked by binson_diff().
+ *          Deeper ones fail with \c BINSON_RES_ERROR_LIMIT_EXCEEDED. Default is \c BINSON_DEPTH_LIMIT
+ *
+ * \param obj binson*
+ * \param max_depth binson_depth   Number of nested OBJECTs/ARRAYs, including root
+ * \return binson_res
+ */
+binson_res  binson_set_max_depth( binson *obj, binson_depth max_depth )
+{
+  if (!obj || !max_depth)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  obj->max_depth = max_depth;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief  Get current resource usage, as accounted by binson_set_limits()
+ *
+ * \param obj binson*
+ * \param stats binson_stats*
+ * \return binson_res
+ */
+binson_res  binson_get_stats( binson *obj, binson_stats *stats )
+{
+  if (!obj || !stats)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  stats->bytes = binson_arena_get_size( obj->arena ) + obj->owned_size;
+  stats->nodes = obj->nodes;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief  Get root node pointer
+ *
+ * \param obj binson*
+ * \return binson_node*
+ */
+binson_node* binson_get_root( binson *obj )
+{
+  if (!obj)
+    return NULL;
+
+  return obj->root;
+}
+
+/** \brief Get allocator used by context. Adopted payloads, see binson_node_add_bytes_take(),
+ *         must come from it and payloads detached by binson_node_take_bytes() must go back to it
+ *
+ * \param obj binson*
+ * \return const binson_allocator*   Never NULL for valid context. Empty one means malloc() and free()
+ */
+const binson_allocator*  binson_get_allocator( binson *obj )
+{
+  if (!obj)
+    return NULL;
+
+  return &obj->allocator;
+}
+
+/** \brief Get node type
+ *
+ * \param node binson_node*
+ * \return binson_node_type
+ */
+binson_node_type  binson_node_get_type( binson_node *node )
+{
+  return node->type;
+}
+
+/** \brief Get node key
+ *
+ * \param node binson_node*
+ * \return const char*
+ */
+const char*    binson_node_get_key( binson_node *node )
+{
+  binson  *owner;
+
+  /* RAW mode key is not zero-terminated, so it's copied out on first request */
+  if (node->flags & BINSON_NODE_FLAG_KEY_RAW)
+  {
+    owner = binson_node_get_owner( node );
+    if (!owner || FAILED(binson_node_materialize( owner, node, BINSON_NODE_FLAG_KEY_RAW )))
+      return NULL;
+  }
+
+  return BINSON_NODE_KEY(node);
+}
+
+/** \brief Get node key without copying it. Key is not zero-terminated for trees built in RAW parser mode
+ *
+ * \param node binson_node*
+ * \param pkey const char**      Set to NULL if node has no key
+ * \param plen binson_raw_size*
+ * \return binson_res
+ */
+binson_res  binson_node_get_key_ref( binson_node *node, const char **pkey, binson_raw_size *plen )
+{
+  if (!node || !pkey || !plen)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  binson_node_key_ref( node, pkey, plen );
+
+  return BINSON_RES_OK;
+}
+
+/* \brief Get node value struct pointer
+ *
+ * \param node binson_node*
+ * \return binson_value*
+ */
+binson_value*    binson_node_get_val( binson_node *node )
+{
+  binson  *owner;
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)
+  {
+    owner = binson_node_get_owner( node );
+    if (!owner || FAILED(binson_node_materialize( owner, node, BINSON_NODE_FLAG_VAL_RAW )))
+      return NULL;
+  }
+
+  return &node->u.val;
+}
+
+/** \brief Get value of specified node as boolean
+ *
+ * \param node binson_node*
+ * \param pbool bool*
+ * \return binson_res
+ */
+binson_res  binson_node_get_boolean( binson_node *node, bool *pbool )
+{
+  binson_raw_value  raw;
+
+  if (!node || !pbool)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)  /* decoded on each request, node stays unchanged */
+  {
+    binson_common_decode_token( node->u.val.bbuf_val.bptr, &raw );
+    *pbool = raw.bool_val;
+  }
+  else
+    *pbool = node->u.val.bool_val;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as integer
+ *
+ * \param node binson_node*
+ * \param pinteger int64_t*
+ * \return binson_res
+ */
+binson_res  binson_node_get_integer( binson_node *node, int64_t *pinteger )
+{
+  binson_raw_value  raw;
+
+  if (!node || !pinteger)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)  /* decoded on each request, node stays unchanged */
+  {
+    binson_common_decode_token( node->u.val.bbuf_val.bptr, &raw );
+    *pinteger = raw.int_val;
+  }
+  else
+    *pinteger = node->u.val.int_val;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as double
+ *
+ * \param node binson_node*
+ * \param pdouble double*
+ * \return binson_res
+ */
+binson_res  binson_node_get_double( binson_node *node, double *pdouble )
+{
+  binson_raw_value  raw;
+
+  if (!node || !pdouble)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)  /* decoded on each request, node stays unchanged */
+  {
+    binson_common_decode_token( node->u.val.bbuf_val.bptr, &raw );
+    *pdouble = raw.double_val;
+  }
+  else
+    *pdouble = node->u.val.double_val;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as string
+ *
+ * \param node binson_node*
+ * \param pstr char**
+ * \return binson_res
+ */
+binson_res  binson_node_get_string( binson_node *node, char **ppstr )
+{
+  binson      *owner;
+  binson_res   res;
+
+  if (!node || !ppstr)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  /* RAW mode string is not zero-terminated, so it's copied out on first request */
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)
+  {
+    owner = binson_node_get_owner( node );
+    if (!owner)
+      return BINSON_RES_ERROR_BROKEN_INT_STRUCT;
+
+    res = binson_node_materialize( owner, node, BINSON_NODE_FLAG_VAL_RAW );
+    if (FAILED(res)) return res;
+  }
+
+  *ppstr = (char *)BINSON_NODE_VAL_PTR(node);
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as string without copying it. String is not
+ *         zero-terminated for trees built in RAW parser mode
+ *
+ * \param node binson_node*
+ * \param ppstr const char**
+ * \param plen binson_raw_size*
+ * \return binson_res
+ */
+binson_res  binson_node_get_string_ref( binson_node *node, const char **ppstr, binson_raw_size *plen )
+{
+  uint8_t     *ptr = NULL;
+  binson_res   res;
+
+  if (!node || !ppstr || !plen)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_node_get_bytes( node, &ptr, plen );  /* STRING and BYTES payloads are stored the same way */
+  *ppstr = (const char *)ptr;
+
+  return res;
+}
+
+/** \brief Get value of specified node as byte array
+ *
+ * \param node binson_node*
+ * \param ppbytes uint8_t**
+ * \param psize binson_raw_size*
+ * \return binson_res
+ */
+binson_res  binson_node_get_bytes( binson_node *node, uint8_t **ppbytes, binson_raw_size *psize )
+{
+  binson_raw_value  raw;
+
+  if (!node || !ppbytes || !psize)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (node->flags & BINSON_NODE_FLAG_VAL_RAW)  /* refer to payload inside parser's source buffer */
+  {
+    binson_common_decode_token( node->u.val.bbuf_val.bptr, &raw );
+    *ppbytes = raw.bbuf_val.bptr;
+    *psize   = raw.bbuf_val.bsize;
+  }
+  else
+  {
+    *ppbytes = BINSON_NODE_VAL_PTR(node);
+    *psize   = BINSON_NODE_VAL_SIZE(node);
+  }
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Check is specidied node is leaf node type (not ARRAY, not OBJECT)
+ *
+ * \param node binson_node*
+ * \return bool
+ */
+bool binson_node_is_leaf_type( binson_node *node )
+{
+  return (node->type == BINSON_TYPE_OBJECT || node->type == BINSON_TYPE_ARRAY)? false:true;
+}
+
+/** \brief Get node's parent node
+ *
+ * \param node binson_node*
+ * \return binson_node*
+ */
+binson_node*   binson_node_get_parent( binson_node *node )
+{
+  return node->parent;
+}
+
+/** \brief Get depth level of the node. Depth of root is 0.
+ *
+ * \param node binson_node*
+ * \return int
+ */
+int  binson_node_get_depth(  binson_node *node )
+{
+   int depth = 0;
+
+   while (node && node->parent)
+   {
+     node = node->parent;
+     depth++;
+   }
+
+   return depth;
+}
+
+/** \brief Get previous (left) sibling of the node
+ *
+ * \param node binson_node*
+ * \return binson_node*
+ */
+binson_node*    binson_node_get_prev( binson_node *node )
+{
+  return node->prev;
+}
+
+/** \brief Get next (right) sibling of the node
+ *
+ * \param node binson_node*
+ * \return binson_node*
+ */
+binson_node*    binson_node_get_next( binson_node *node )
+{
+  return node->next;
+}
+
+/** \brief Get most left sibling of the node
+ *
+ * \param node binson_node*
+ * \return binson_node*
+ */
+binson_node*  binson_node_get_first_sibling( binson_node *node )
+{
+   if (!node || !node->parent || (node == node->parent->u.c.first_child))
+     return NULL;
+
+   return node->parent->u.c.first_child;
+}
+
+/** \brief Get most right sibling of the node
+ *
+ * \param node binson_node*
+ * \return binson_node*
+ */
+binson_node*  binson_node_get_last_sibling( binson_node *node )
+{
+  if (!node || !node->parent || (node == node->parent->u.c.last_child))
+     return NULL;
+
+   return node->parent->u.c.last_child;
+}
+
+/* \brief Private helper. Parse lazy container or copy shared clone on first access,
+ *         using context which owns the node
+ *
+ * \param node binson_node*
+ * \return binson_res
+ */
+binson_res  binson_node_expand_owned( binson_node *node )
+{
+  binson  *owner;
+
+  if (!(node->flags & (BINSON_NODE_FLAG_LAZY | BINSON_NODE_FLAG_SHARED)))
+    return BINSON_RES_OK;
+
+  owner = binson_node_get_owner( node );
+  if (!owner)
+    return BINSON_RES_ERROR_BROKEN_INT_STRUCT;
+
+  return binson_node_expand( owner, node );
+}
+
+/** \brief Get first child of the node. Returns NULL if lazy container can't be parsed,
+ *         see binson_node_get_first_child_ex() to get the reason
+ *
+ * \param node binson_node*
+ * \return binson_node*
+ */
+binson_node*  binson_node_get_first_child( binson_node *node )
+{
+  binson_node  *child;
+  binson_res    res;
+
+  res = binson_node_get_first_child_ex( node, &child );
+
+  return (res == BINSON_RES_OK)? child : NULL;
+}
+
+/** \brief Get last child of the node. Returns NULL if lazy container can't be parsed,
+ *         see binson_node_get_last_child_ex() to get the reason
+ *
+ * \param node binson_node*
+ * \return binson_node*
+ */
+binson_node*  binson_node_get_last_child( binson_node *node )
+{
+  binson_node  *child;
+  binson_res    res;
+
+  res = binson_node_get_last_child_ex( node, &child );
+
+  return (res == BINSON_RES_OK)? child : NULL;
+}
+
+/** \brief Get first child of the node, reporting errors of parsing lazy container
+ *
+ * \param node binson_node*
+ * \param pchild binson_node**    Set to NULL for leaves and empty containers
+ * \return binson_res
+ */
+binson_res  binson_node_get_first_child_ex( binson_node *node, binson_node **pchild )
+{
+  binson_res  res;
+
+  if (!node || !pchild)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pchild = NULL;
+
+  if (binson_node_is_leaf_type(node))
+    return BINSON_RES_OK;
+
+  res = binson_node_expand_owned( node );
+  if (FAILED(res)) return res;
+
+  *pchild = node->u.c.first_child;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get last child of the node, reporting errors of parsing lazy container
+ *
+ * \param node binson_node*
+ * \param pchild binson_node**    Set to NULL for leaves and empty containers
+ * \return binson_res
+ */
+binson_res  binson_node_get_last_child_ex( binson_node *node, binson_node **pchild )
+{
+  binson_res  res;
+
+  if (!node || !pchild)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pchild = NULL;
+
+  if (binson_node_is_leaf_type(node))
+    return BINSON_RES_OK;
+
+  res = binson_node_expand_owned( node );
+  if (FAILED(res)) return res;
+
+  *pchild = node->u.c.last_child;
+
+  return BINSON_RES_OK;
+}
+
+
+/** \brief Get number of children of the node
+ *
+ * \param node binson_node*
+ * \param pcnt binson_child_num*
+ * \return binson_res
+ */
+binson_res  binson_node_get_child_count( binson_node *node, binson_child_num *pcnt )
+{
+  binson_res   res;
+
+  if (!node || !pcnt)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_node_expand_owned( node );
+  if (FAILED(res)) return res;
+
+  *pcnt = binson_node_is_leaf_type(node)? 0 : node->child_cnt;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get number of children of node's parent, node itself included. Root has no siblings
+ *
+ * \param node binson_node*
+ * \param pcnt binson_child_num*
+ * \return binson_res
+ */
+binson_res  binson_node_get_sibling_count( binson_node *node, binson_child_num *pcnt )
+{
+  if (!node || !pcnt)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pcnt = node->parent? node->parent->child_cnt : 1;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get child node by its index. Wide containers get children vector on first call,
+ *         so following calls are O(1) until children are inserted or removed in the middle
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param idx binson_child_num
+ * \param pnode binson_node**    Set to NULL if index is out of range
+ * \return binson_res
+ */
+binson_res  binson_node_get_child_by_idx( binson *obj, binson_node *parent, binson_child_num idx, binson_node **pnode )
+{
+  binson_res        res;
+  binson_node      *node;
+  binson_child_num  i;
+
+  if (!obj || !pnode)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (!parent)
+    parent = obj->root;
+
+  *pnode = NULL;
+
+  res = binson_node_expand( obj, parent );
+  if (FAILED(res)) return res;
+
+  if (binson_node_is_leaf_type(parent) || idx >= parent->child_cnt)
+    return BINSON_RES_OK;
+
+  if (parent->child_cnt > BINSON_CHILD_VECTOR_THRESHOLD)
+  {
+    if (!parent->u.c.ext || !parent->u.c.ext->cvec_valid)
+    {
+      res = binson_node_cvec_build( obj, parent, parent->child_cnt );
+      if (FAILED(res)) return res;
+    }
+
+    *pnode = parent->u.c.ext->cvec[idx];
+    return BINSON_RES_OK;
+  }
+
+  /* short list, walk from the nearest end */
+  if (idx < parent->child_cnt / 2)
+    for (node = parent->u.c.first_child, i = 0; i < idx; i++)
+      node = node->next;
+  else
+    for (node = parent->u.c.last_child, i = parent->child_cnt - 1; i > idx; i--)
+      node = node->prev;
+
+  *pnode = node;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Search node by key among siblings
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param key const char*
+ * \param pnode binson_node**
+ * \return binson_res
+ */
+binson_res  binson_node_get_child_by_key( binson *obj, binson_node *parent, const char *key, binson_node **pnode )
+{
+  binson_node      *node;
+  binson_raw_size   len = (binson_raw_size)strlen( key );
+  binson_res        res;
+  int               cmp;
+
+  if (!parent)
+    parent = obj->root;
+
+  *pnode = NULL;
+
+  if (binson_node_is_leaf_type(parent))
+    return BINSON_RES_OK;
+
+  res = binson_node_expand( obj, parent );
+  if (FAILED(res)) return res;
+
+  if (parent->u.c.ext && parent->u.c.ext->htab)
+  {
+    *pnode = parent->u.c.ext->htab[ binson_node_index_slot( parent->u.c.ext, key, len ) ];
+    return BINSON_RES_OK;
+  }
+
+  node = parent->u.c.first_child;
+
+  while (node)
+  {
+    if (BINSON_NODE_HAS_KEY(node))
+    {
+      cmp = binson_node_key_cmp( node, key, len );
+      if (!cmp)
+        *pnode = node;
+      if (!cmp || (cmp > 0 && !(parent->flags & BINSON_NODE_FLAG_BULK)))  /* siblings are sorted, so no match further */
+        break;
+    }
+    node = node->next;
+  }
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Search nodes by several keys among siblings in single pass. OBJECT children
+ *         are sorted, so keys sorted the same way are merged with children list
+ *
+ * \param obj binson*
+ * \param parent binson_node*
+ * \param keys const char**        Keys in ascending \c strcmp() order
+ * \param key_cnt size_t
+ * \param pnodes binson_node**     Found nodes in order of keys, NULL for missing ones
+ * \return binson_res              \c BINSON_RES_ERROR_ARG_WRONG if keys are not sorted
+ */
+binson_res  binson_node_get_children_by_keys( binson *obj, binson_node *parent, const char **keys, size_t key_cnt, binson_node **pnodes )
+{
+  binson_node      *node;
+  binson_raw_size   len;
+  binson_res        res;
+  size_t            i;
+  int               cmp;
+
+  if (!obj || !keys || !pnodes)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (!parent)
+    parent = obj->root;
+
+  for (i = 0; i < key_cnt; i++)
+  {
+    pnodes[i] = NULL;
+    if (i && strcmp( keys[i-1], keys[i] ) > 0)
+      return BINSON_RES_ERROR_ARG_WRONG;
+  }
+
+  if (binson_node_is_leaf_type(parent))
+    return BINSON_RES_OK;
+
+  res = binson_node_expand( obj, parent );
+  if (FAILED(res)) return res;
+
+  if (parent->flags & BINSON_NODE_FLAG_BULK)  /* children are not sorted yet */
+  {
+    for (i = 0; i < key_cnt && SUCCESS(res); i++)
+      res = binson_node_get_child_by_key( obj, parent, keys[i], &pnodes[i] );
+
+    return res;
+  }
+
+  if (parent->u.c.ext && parent->u.c.ext->htab)
+  {
+    for (i = 0; i < key_cnt; i++)
+    {
+      len = (binson_raw_size)strlen( keys[i] );
+      pnodes[i] = parent->u.c.ext->htab[ binson_node_index_slot( parent->u.c.ext, keys[i], len ) ];
+    }
+    return BINSON_RES_OK;
+  }
+
+  node = parent->u.c.first_child;
+
+  for (i = 0; i < key_cnt && node; i++)
+  {
+    len = (binson_raw_size)strlen( keys[i] );
+
+    for (; node; node = node->next)
+    {
+      if (!BINSON_NODE_HAS_KEY(node))
+        continue;
+
+      cmp = binson_node_key_cmp( node, keys[i], len );
+      if (!cmp)
+        pnodes[i] = node;
+      if (cmp >= 0)  /* node stays current, next key may match it too */
+        break;
+    }
+  }
+
+  return BINSON_RES_OK;
+}
+
+/*
+ *  64-bit constants composed of 32-bit halves, C89 has no long long literals
+ */
+#define BINSON_HASH_U64(hi, lo)   (((uint64_t)(hi) << 32) | (uint64_t)(lo))
+#define BINSON_HASH_SEED          BINSON_HASH_U64( 0xcbf29ce4UL, 0x84222325UL )   /* FNV-1a offset basis */
+#define BINSON_HASH_PRIME         BINSON_HASH_U64( 0x00000100UL, 0x000001b3UL )   /* FNV-1a prime */
+#define BINSON_HASH_MIX1          BINSON_HASH_U64( 0xbf58476dUL, 0x1ce4e5b9UL )
+#define BINSON_HASH_MIX2          BINSON_HASH_U64( 0x94d049bbUL, 0x133111ebUL )
+
+/* \brief Private helper. Feed bytes to FNV-1a hash
+ *
+ * \param hash uint64_t
+ * \param src const uint8_t*
+ * \param size size_t
+ * \return uint64_t
+ */
+uint64_t  binson_hash_bytes( uint64_t hash, const uint8_t *src, size_t size )
+{
+  size_t  i;
+
+  for (i = 0; i < size; i++)
+  {
+    hash ^= src[i];
+    hash *= BINSON_HASH_PRIME;
+  }
+
+  return hash;
+}
+
+/* \brief Private helper. Avalanche hash bits (splitmix64 finalizer), so combining
+ *        child hashes depends on their order
+ *
+ * \param hash uint64_t
+ * \return uint64_t
+ */
+uint64_t  binson_hash_mix( uint64_t hash )
+{
+  hash ^= hash >> 30;
+  hash *= BINSON_HASH_MIX1;
+  hash ^= hash >> 27;
+  hash *= BINSON_HASH_MIX2;
+  hash ^= hash >> 31;
+
+  return hash;
+}
+
+/* \brief Private helper. Get leaf value in canonical form: fixed size values as 64-bit
+ *        pattern, STRING/BYTES as size and payload
+ *
+ * \param node binson_node*
+ * \param pval uint64_t*
+ * \param ppbytes uint8_t**        Set to NULL for fixed size values
+ * \return binson_res
+ */
+binson_res  binson_node_leaf_canon( binson_node *node, uint64_t *pval, uint8_t **ppbytes )
+{
+  int64_t          ival;
+  double           dval;
+  bool             bval;
+  binson_raw_size  size;
+  binson_res       res;
+
+  *ppbytes = NULL;
+
+  switch (node->type)
+  {
+    case BINSON_TYPE_BOOLEAN:
+      res = binson_node_get_boolean( node, &bval );
+      *pval = bval? 1 : 0;
+      return res;
+
+    case BINSON_TYPE_INTEGER:
+      res = binson_node_get_integer( node, &ival );
+      *pval = (uint64_t)ival;
+      return res;
+
+    case BINSON_TYPE_DOUBLE:
+      res = binson_node_get_double( node, &dval );
+      memcpy( pval, &dval, sizeof(*pval) );   /* bitwise, same as encoding */
+      return res;
+
+    case BINSON_TYPE_STRING:
+    case BINSON_TYPE_BYTES:
+      res = binson_node_get_bytes( node, ppbytes, &size );
+      *pval = size;
+      return res;
+
+    default:
+      return BINSON_RES_ERROR_TYPE_UNKNOWN;
+  }
+}
+
+/* \brief Private helper. Hash leaf value in platform independent way
+ *
+ * \param node binson_node*
+ * \param phash uint64_t*
+ * \return binson_res
+ */
+binson_res  binson_node_hash_leaf( binson_node *node, uint64_t *phash )
+{
+  uint8_t     buf[8], type = (uint8_t)node->type, *bytes;
+  uint64_t    val;
+  binson_res  res;
+  int         i;
+
+  res = binson_node_leaf_canon( node, &val, &bytes );
+  if (FAILED(res)) return res;
+
+  for (i = 0; i < 8; i++)
+    buf[i] = (uint8_t)(val >> (8 * i));
+
+  *phash = binson_hash_bytes( binson_hash_bytes( BINSON_HASH_SEED, &type, 1 ), buf, sizeof(buf) );
+
+  if (bytes)
+    *phash = binson_hash_bytes( *phash, bytes, (size_t)val );
+
+  *phash = binson_hash_mix( *phash );
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Calculate 64-bit structural hash of subtree. Node's own key is not hashed, while
+ *         keys of descendants are. Equal subtrees give equal hashes on any platform
+ *
+ * \param obj binson*
+ * \param node binson_node*         Tree root if NULL
+ * \param phash uint64_t*
+ * \return binson_res               \c BINSON_RES_ERROR_LIMIT_EXCEEDED if subtree is deeper than
+ *                                  binson_set_max_depth() allows
+ */
+binson_res  binson_node_hash( binson *obj, binson_node *node, uint64_t *phash )
+{
+  binson_node      *cur;
+  uint64_t          local[BINSON_DEPTH_STACK_SIZE];
+  uint64_t         *acc = local, *tmp;              /* partial hashes of open containers */
+  size_t            cap = BINSON_DEPTH_STACK_SIZE;
+  int               top = 0;
+  uint64_t          hash;
+  uint8_t           type;
+  binson_res        res = BINSON_RES_OK;
+
+  if (!obj || !phash)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (!node)
+    node = obj->root;
+
+  if (binson_node_is_leaf_type( node ))
+    return binson_node_hash_leaf( node, phash );
+
+  /* postorder walk, hash of each node is mixed into its parent's one on the way up */
+  cur = node;
+  while (SUCCESS(res))
+  {
+    res = binson_node_expand( obj, cur );
+    if (FAILED(res)) break;
+
+    if (binson_node_is_leaf_type( cur ))
+      res = binson_node_hash_leaf( cur, &hash );
+    else if (cur->flags & BINSON_NODE_FLAG_BULK)  /* unsorted children */
+      res = BINSON_RES_ERROR_ARG_WRONG_COMB;
+    else if (cur->u.c.ext && cur->u.c.ext->hash_valid)
+      hash = cur->u.c.ext->hash;
+    else if (top >= obj->max_depth)
+      res = BINSON_RES_ERROR_LIMIT_EXCEEDED;
+    else
+    {
+      tmp = (uint64_t *)binson_common_stack_grow( &obj->allocator, acc, &cap, (size_t)top, sizeof(uint64_t), local );
+      if (!tmp)
+      {
+        res = BINSON_RES_ERROR_OUT_OF_MEMORY;
+        break;
+      }
+      acc = tmp;
+
+      type = (uint8_t)cur->type;
+      acc[top++] = binson_hash_bytes( BINSON_HASH_SEED, &type, 1 );
+
+      if (cur->u.c.first_child)
+      {
+        cur = cur->u.c.first_child;
+        binson_node_hash_key( cur, &acc[top-1] );
+        continue;
+      }
+
+      binson_node_hash_close( obj, cur, acc[--top], &hash );
+    }
+
+    while (SUCCESS(res) && cur != node)
+    {
+      acc[top-1] = binson_hash_mix( acc[top-1] ^ hash );
+
+      if (cur->next)
+      {
+        cur = cur->next;
+        binson_node_hash_key( cur, &acc[top-1] );
+        break;
+      }
+
+      cur = cur->parent;
+      binson_node_hash_close( obj, cur, acc[--top], &hash );
+    }
+
+    if (SUCCESS(res) && cur == node)
+    {
+      *phash = hash;
+      break;
+    }
+  }
+
+  binson_common_stack_free( &obj->allocator, acc, local );
+
+  return res;
+}
+
+/* \brief Private helper. Mix key of OBJECT child into partial hash of its parent
+ *
+ * \param child binson_node*
+ * \param phash uint64_t*
+ * \return void
+ */
+void  binson_node_hash_key( binson_node *child, uint64_t *phash )
+{
+  const char       *key;
+  binson_raw_size   len;
+
+  if (child->parent->type != BINSON_TYPE_OBJECT)
+    return;
+
+  binson_node_key_ref( child, &key, &len );
+  *phash = binson_hash_mix( binson_hash_bytes( *phash, (const uint8_t *)key, len ) ^ len );
+}
+
+/* \brief Private helper. Finish hash of container when all its children are mixed in,
+ *         keeping it for wide containers, see binson_set_hash_cache(). Kept hash is optional,
+ *         so it's skipped if there is no room for it
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \param hash uint64_t          Partial hash
+ * \param phash uint64_t*
+ * \return void
+ */
+void  binson_node_hash_close( binson *obj, binson_node *node, uint64_t hash, uint64_t *phash )
+{
+  binson_node_ext  *ext;
+
+  *phash = binson_hash_mix( hash ^ node->child_cnt );
+
+  if (!obj->hash_cache || node->child_cnt <= BINSON_HASH_CACHE_THRESHOLD)
+    return;
+
+  ext = binson_node_ext_get( obj, node );
+  if (!ext)
+    return;
+
+  ext->hash       = *phash;
+  ext->hash_valid = true;
+  obj->cache_used = true;
+}
+
+/* \brief Private helper. Compare values of two leaves of same type
+ *
+ * \param a binson_node*
+ * \param b binson_node*
+ * \return bool
+ */
+bool  binson_node_equal_leaf( binson_node *a, binson_node *b )
+{
+  uint64_t  val_a, val_b;
+  uint8_t  *bytes_a, *bytes_b;
+
+  if (FAILED(binson_node_leaf_canon( a, &val_a, &bytes_a )) || FAILED(binson_node_leaf_canon( b, &val_b, &bytes_b )))
+    return false;
+
+  return val_a == val_b && (!bytes_a || !val_a || !memcmp( bytes_a, bytes_b, (size_t)val_a ));
+}
+
+/** \brief Compare two subtrees, possibly of different contexts. Node's own keys are not
+ *         compared, while keys of descendants are. Containers with cached hashes, see
+ *         binson_set_hash_cache(), are told apart without descending
+ *
+ * \param a binson_node*
+ * \param b binson_node*
+ * \param pequal bool*
+ * \return binson_res
+ */
+binson_res  binson_node_equal( binson_node *a, binson_node *b, bool *pequal )
+{
+  binson_node      *ca, *cb;
+  binson_child_num  cnt_a, cnt_b;
+  const char       *key_a, *key_b;
+  binson_raw_size   len_a, len_b;
+  binson_res        res;
+  bool              descend;
+
+  if (!a || !b || !pequal)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pequal = false;
+
+  /* both subtrees are walked in lockstep with parent links, so depth needs no stack */
+  ca = a;
+  cb = b;
+  while (ca)
+  {
+    if (ca->type != cb->type)
+      return BINSON_RES_OK;
+
+    descend = false;
+
+    if (binson_node_is_leaf_type( ca ))
+    {
+      if (!binson_node_equal_leaf( ca, cb ))
+        return BINSON_RES_OK;
+    }
+    /* same node or clones sharing same children */
+    else if (((ca->flags & BINSON_NODE_FLAG_SHARED)? ca->u.share.src : ca) != ((cb->flags & BINSON_NODE_FLAG_SHARED)? cb->u.share.src : cb))
+    {
+      /* lazy and shared containers are expanded here */
+      res = binson_node_get_child_count( ca, &cnt_a );
+      if (FAILED(res)) return res;
+      res = binson_node_get_child_count( cb, &cnt_b );
+      if (FAILED(res)) return res;
+
+      if (cnt_a != cnt_b)
+        return BINSON_RES_OK;
+
+      if (ca->u.c.ext && cb->u.c.ext && ca->u.c.ext->hash_valid && cb->u.c.ext->hash_valid &&
+          ca->u.c.ext->hash != cb->u.c.ext->hash)
+        return BINSON_RES_OK;
+
+      descend = ca->u.c.first_child != NULL;
+    }
+
+    if (descend)
+    {
+      ca = ca->u.c.first_child;
+      cb = cb->u.c.first_child;
+    }
+    else
+    {
+      while (ca != a && !ca->next)
+      {
+        ca = ca->parent;
+        cb = cb->parent;
+      }
+
+      if (ca == a)
+        break;
+
+      /* children counts are equal, so 'cb' has next sibling too */
+      ca = ca->next;
+      cb = cb->next;
+    }
+
+    if (ca->parent->type == BINSON_TYPE_OBJECT)
+    {
+      binson_node_key_ref( ca, &key_a, &len_a );
+      binson_node_key_ref( cb, &key_b, &len_b );
+
+      if (len_a != len_b || (len_a && memcmp( key_a, key_b, len_a )))
+        return BINSON_RES_OK;
+    }
+  }
+
+  *pequal = true;
+
+  return BINSON_RES_OK;
+}
+
+/* \brief Private helper. Write single patch operation for current path of diff context
+ *
+ * \param ctx binson_diff_ctx*
+ * \param op binson_patch_op
+ * \param node binson_node*         New value from 'to' tree, ignored for BINSON_PATCH_OP_REMOVE
+ * \return binson_res
+ */
+binson_res  binson_diff_emit( binson_diff_ctx *ctx, binson_patch_op op, binson_node *node )
+{
+  static const char  *val_key = "v";
+  binson_diff_step   *step;
+  binson_res          res;
+  int                 i;
+
+  res = binson_writer_write_object_begin( ctx->writer, NULL );
+  if (FAILED(res)) return res;
+
+  res = binson_writer_write_integer( ctx->writer, "o", (int64_t)op );
+  if (FAILED(res)) return res;
+
+  res = binson_writer_write_array_begin( ctx->writer, "p" );
+  if (FAILED(res)) return res;
+
+  for (i = 0; i < ctx->depth && SUCCESS(res); i++)
+  {
+    step = &ctx->path[i];
+
+    if (!step->node)
+    {
+      res = binson_writer_write_integer( ctx->writer, NULL, (int64_t)step->idx );
+      continue;
+    }
+
+    res = binson_node_materialize( step->obj, step->node, BINSON_NODE_FLAG_KEY_RAW );
+    if (SUCCESS(res))
+      res = binson_writer_write_str( ctx->writer, NULL, BINSON_NODE_KEY(step->node) );
+  }
+  if (FAILED(res)) return res;
+
+  res = binson_writer_write_array_end( ctx->writer );
+  if (FAILED(res)) return res;
+
+  if (op != BINSON_PATCH_OP_REMOVE)
+  {
+    res = binson_serialize_tree( ctx->to, ctx->writer, node, &val_key, false );
+    if (FAILED(res)) return res;
+  }
+
+  return binson_writer_write_object_end( ctx->writer );
+}
+
+/* \brief Private helper. Emit operations turning subtree 'a' of 'from' tree to subtree 'b' of 'to' tree.
+ *         OBJECT children are walked in sorted key lockstep, ARRAY items are compared by index
+ *
+ * \param ctx binson_diff_ctx*      Path to 'a' and 'b' is already pushed
+ * \param a binson_node*
+ * \param b binson_node*
+ * \return binson_res
+ */
+binson_res  binson_diff_node( binson_diff_ctx *ctx, binson_node *a, binson_node *b )
+{
+  binson_node      *ca, *cb;
+  binson_diff_step *step;
+  const char       *key;
+  binson_raw_size   len;
+  binson_child_num  idx;
+  binson_res        res;
+  int               cmp, d;
+  bool              equal;
+
+  if (a->type != b->type)
+    return binson_diff_emit( ctx, BINSON_PATCH_OP_REPLACE, b );
+
+  if (binson_node_is_leaf_type( a ))
+    return binson_node_equal_leaf( a, b )? BINSON_RES_OK : binson_diff_emit( ctx, BINSON_PATCH_OP_REPLACE, b );
+
+  res = binson_node_expand( ctx->from, a );
+  if (FAILED(res)) return res;
+  res = binson_node_expand( ctx->to, b );
+  if (FAILED(res)) return res;
+
+  /* different hashes prove subtrees differ, same ones must be confirmed as collisions are possible.
+     Hashes are calculated once by binson_diff(), so only cached ones are used here */
+  if (ctx->use_hash && a->u.c.ext && b->u.c.ext && a->u.c.ext->hash_valid && b->u.c.ext->hash_valid &&
+      a->u.c.ext->hash == b->u.c.ext->hash)
+  {
+    res = binson_node_equal( a, b, &equal );
+    if (FAILED(res) || equal)
+      return res;
+  }
+
+  if ((a->flags | b->flags) & BINSON_NODE_FLAG_BULK)  /* unsorted children */
+    return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
+  if (ctx->depth >= ctx->from->max_depth)
+    return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+  step = (binson_diff_step *)binson_common_stack_grow( &ctx->from->allocator, ctx->path, &ctx->path_cap, (size_t)ctx->depth,
+                                                       sizeof(binson_diff_step), ctx->path_local );
+  if (!step)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+  /* nested calls may move the stack, so step is addressed by index only */
+  ctx->path = step;
+  d = ctx->depth++;
+  ca = a->u.c.first_child;
+  cb = b->u.c.first_child;
+
+  if (a->type == BINSON_TYPE_OBJECT)
+  {
+    ctx->path[d].node = NULL;
+
+    while (ca || cb)
+    {
+      if (!ca)
+        cmp = 1;
+      else if (!cb)
+        cmp = -1;
+      else
+      {
+        binson_node_key_ref( ca, &key, &len );
+        cmp = -binson_node_key_cmp( cb, key, len );
+      }
+
+      ctx->path[d].obj  = (cmp < 0)? ctx->from : ctx->to;
+      ctx->path[d].node = (cmp < 0)? ca : cb;
+
+      if (cmp < 0)
+        res = binson_diff_emit( ctx, BINSON_PATCH_OP_REMOVE, NULL );
+      else if (cmp > 0)
+        res = binson_diff_emit( ctx, BINSON_PATCH_OP_ADD, cb );
+      else
+        res = binson_diff_node( ctx, ca, cb );
+
+      if (FAILED(res)) return res;
+
+      if (cmp <= 0) ca = ca->next;
+      if (cmp >= 0) cb = cb->next;
+    }
+  }
+  else  /* ARRAY: common part item by item, then tail is appended or removed from the end */
+  {
+    ctx->path[d].obj  = NULL;
+    ctx->path[d].node = NULL;
+
+    for (idx = 0; ca && cb; idx++, ca = ca->next, cb = cb->next)
+    {
+      ctx->path[d].idx = idx;
+      res = binson_diff_node( ctx, ca, cb );
+      if (FAILED(res)) return res;
+    }
+
+    for (; cb; idx++, cb = cb->next)
+    {
+      ctx->path[d].idx = idx;
+      res = binson_diff_emit( ctx, BINSON_PATCH_OP_ADD, cb );
+      if (FAILED(res)) return res;
+    }
+
+    for (idx = a->child_cnt; idx > b->child_cnt; idx--)
+    {
+      ctx->path[d].idx = idx - 1;
+      res = binson_diff_emit( ctx, BINSON_PATCH_OP_REMOVE, NULL );
+      if (FAILED(res)) return res;
+    }
+  }
+
+  ctx->depth--;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Write patch turning \c from tree to \c to tree. Patch is binson OBJECT:
+ *         {"ops":[{"o":op,"p":[path],"v":value}, ...]}, where 'op' is \c binson_patch_op,
+ *         'path' is list of keys (STRING) and ARRAY indexes (INTEGER) leading from root to
+ *         changed node and 'value' is new node value, missing for \c BINSON_PATCH_OP_REMOVE.
+ *         Operations are applied in order, so ARRAY indexes refer to array state left by
+ *         previous operations.
+ *
+ *         OBJECT children are compared in sorted key lockstep. ARRAY items are compared by
+ *         index, so item inserted in the middle gives replacement of all following items.
+ *         When both contexts keep hashes, see binson_set_hash_cache(), containers with
+ *         different hashes are descended without further checks and ones with the same hash
+ *         are compared by binson_node_equal() instead of being walked, so unchanged subtrees
+ *         produce no patch operations
+ *
+ * \param from binson*
+ * \param to binson*
+ * \param writer binson_writer*
+ * \return binson_res
+ */
+binson_res  binson_diff( binson *from, binson *to, binson_writer *writer )
+{
+  binson_diff_ctx  ctx;
+  uint64_t         hash;
+  binson_res       res;
+
+  if (!from || !to || !writer)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  ctx.from     = from;
+  ctx.to       = to;
+  ctx.writer   = writer;
+  ctx.use_hash = from->hash_cache && to->hash_cache && from->root && to->root;
+  ctx.path     = ctx.path_local;
+  ctx.path_cap = BINSON_DEPTH_STACK_SIZE;
+  ctx.depth    = 0;
+
+  /* single pass over each tree fills hash caches used by binson_diff_node() */
+  if (ctx.use_hash)
+  {
+    res = binson_node_hash( from, NULL, &hash );
+    if (FAILED(res)) return res;
+    res = binson_node_hash( to, NULL, &hash );
+    if (FAILED(res)) return res;
+  }
+
+  res = binson_writer_write_object_begin( writer, NULL );
+  if (FAILED(res)) return res;
+
+  res = binson_writer_write_array_begin( writer, "ops" );
+  if (FAILED(res)) return res;
+
+  if (from->root && to->root)
+    res = binson_diff_node( &ctx, from->root, to->root );
+  else if (from->root)
+    res = binson_diff_emit( &ctx, BINSON_PATCH_OP_REMOVE, NULL );
+  else if (to->root)
+    res = binson_diff_emit( &ctx, BINSON_PATCH_OP_ADD, to->root );
+
+  binson_common_stack_free( &from->allocator, ctx.path, ctx.path_local );
+  if (FAILED(res)) return res;
+
+  res = binson_writer_write_array_end( writer );
+  if (FAILED(res)) return res;
+
+  return binson_writer_write_object_end( writer );
+}
+
+/* \brief Private helper. Add copy of subtree which may belong to other context
+ *
+ * \param obj binson*
+ * \param parent binson_node*     NULL to create detached node
+ * \param key const char*         Key of the copy
+ * \param src_obj binson*         Context owning 'src'
+ * \param src binson_node*
+ * \param dst binson_node**
+ * \return binson_res
+ */
+binson_res  binson_node_copy_tree( binson *obj, binson_node *parent, const char *key, binson *src_obj, binson_node *src, binson_node **dst )
+{
+  binson_iter   it;
+  binson_node  *node, *me = NULL, *cur = parent;
+  const char   *k;
+  binson_res    res;
+
+  res = binson_iter_init( &it, src_obj, src, BINSON_TRAVERSE_BOTHORDER, obj->max_depth );
+
+  while (SUCCESS(res) && (res = binson_iter_next( &it, &node )) == BINSON_RES_OK)
+  {
+    if (binson_iter_is_closing( &it ))
+    {
+      cur = cur->parent;
+      continue;
+    }
+
+    k = key;
+    if (node != src && cur->type == BINSON_TYPE_OBJECT)
+    {
+      res = binson_node_materialize( src_obj, node, BINSON_NODE_FLAG_KEY_RAW );
+      if (FAILED(res)) return res;
+
+      k = BINSON_NODE_KEY(node);
+    }
+
+    if (binson_node_is_leaf_type( node ))
+      res = binson_node_clone( obj, cur, &me, node, k );
+    else if (binson_iter_get_depth( &it ) >= obj->max_depth)  /* reported as leaf */
+      res = BINSON_RES_ERROR_LIMIT_EXCEEDED;
+    else
+    {
+      res = binson_node_add_empty( obj, cur, node->type, k, &me );
+      cur = me;
+    }
+
+    if (node == src && dst)
+      *dst = me;
+  }
+
+  return (res == BINSON_RES_TRAVERSAL_DONE)? BINSON_RES_OK : res;
+}
+
+/* \brief Private helper. Move node, possibly detached one, to position before child of
+ *         some container. Caller keeps OBJECT keys sorted
+ *
+ * \param obj binson*
+ * \param node binson_node*
+ * \param before binson_node*
+ * \return binson_res
+ */
+binson_res  binson_node_move_before( binson *obj, binson_node *node, binson_node *before )
+{
+  binson_node  *parent = before->parent;
+  binson_res    res;
+
+  res = binson_node_detach( obj, node );
+  if (FAILED(res)) return res;
+
+  node->parent = parent;
+  node->next   = before;
+  node->prev   = before->prev;
+
+  if (before->prev)
+    before->prev->next = node;
+  else
+    parent->u.c.first_child = node;
+
+  before->prev = node;
+
+  if (parent->u.c.ext)
+    parent->u.c.ext->cvec_valid = false;
+
+  return binson_node_index_add( obj, parent, node );
+}
+
+/* \brief Private helper. Apply single operation of patch, see binson_diff()
+ *
+ * \param obj binson*
+ * \param patch binson*
+ * \param op binson_node*
+ * \return binson_res
+ */
+binson_res  binson_patch_apply_op( binson *obj, binson *patch, binson_node *op )
+{
+  static const char  *keys[] = { "o", "p", "v" };
+  binson_node        *fields[3], *step, *parent = NULL, *target = obj->root, *me;
+  binson_child_num    cnt;
+  int64_t             code, idx = 0;
+  char               *key = NULL;
+  binson_res          res;
+
+  if (op->type != BINSON_TYPE_OBJECT)
+    return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+  res = binson_node_get_children_by_keys( patch, op, keys, 3, fields );
+  if (FAILED(res)) return res;
+
+  if (!fields[0] || fields[0]->type != BINSON_TYPE_INTEGER || !fields[1] || fields[1]->type != BINSON_TYPE_ARRAY)
+    return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+  res = binson_node_get_integer( fields[0], &code );
+  if (FAILED(res)) return res;
+
+  if ((code != BINSON_PATCH_OP_REMOVE && (code != BINSON_PATCH_OP_ADD && code != BINSON_PATCH_OP_REPLACE)) ||
+      (code != BINSON_PATCH_OP_REMOVE && !fields[2]))
+    return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+  res = binson_node_expand( patch, fields[1] );
+  if (FAILED(res)) return res;
+
+  /* resolve path. Only last step may refer to missing node, which is the one to add */
+  for (step = fields[1]->u.c.first_child; step; step = step->next)
+  {
+    if (!target)
+      return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+    parent = target;
+
+    if (parent->type == BINSON_TYPE_OBJECT && step->type == BINSON_TYPE_STRING)
+    {
+      res = binson_node_get_string( step, &key );
+      if (FAILED(res)) return res;
+
+      res = binson_node_get_child_by_key( obj, parent, key, &target );
+    }
+    else if (parent->type == BINSON_TYPE_ARRAY && step->type == BINSON_TYPE_INTEGER)
+    {
+      res = binson_node_get_integer( step, &idx );
+      if (FAILED(res)) return res;
+
+      res = binson_node_get_child_count( parent, &cnt );
+      if (FAILED(res)) return res;
+
+      if (idx < 0 || idx > (int64_t)cnt)
+        return BINSON_RES_ERROR_TREE_OUT_OF_ARRAY;
+
+      target = NULL;
+      if (idx < (int64_t)cnt)
+        res = binson_node_get_child_by_idx( obj, parent, (binson_child_num)idx, &target );
+    }
+    else
+      return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+    if (FAILED(res)) return res;
+  }
+
+  if ((code == BINSON_PATCH_OP_ADD) != !target)
+    return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+  if (code == BINSON_PATCH_OP_REMOVE)
+    return binson_node_remove( obj, target );
+
+  /* ARRAY item is replaced in place: copy is appended, moved before old item and old item goes */
+  if (code == BINSON_PATCH_OP_REPLACE && parent && parent->type == BINSON_TYPE_ARRAY)
+  {
+    res = binson_node_copy_tree( obj, parent, NULL, patch, fields[2], &me );
+    if (FAILED(res)) return res;
+
+    res = binson_node_move_before( obj, me, target );
+    if (FAILED(res)) return res;
+
+    return binson_node_remove( obj, target );
+  }
+
+  if (code == BINSON_PATCH_OP_REPLACE)
+  {
+    res = binson_node_remove( obj, target );
+    if (FAILED(res)) return res;
+  }
+
+  res = binson_node_copy_tree( obj, parent, key, patch, fields[2], &me );
+  if (FAILED(res)) return res;
+
+  if (!parent)
+    obj->root = me;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Apply patch produced by binson_diff() to DOM tree in place. Only nodes on
+ *         patch paths are touched. Operations are applied one by one, so tree is left
+ *         partially patched if some operation fails
+ *
+ * \param obj binson*
+ * \param parser binson_parser*    Patch source
+ * \return binson_res              \c BINSON_RES_ERROR_PARSE_INVALID_INPUT if patch is malformed
+ *                                 or doesn't match the tree
+ */
+binson_res  binson_patch_apply( binson *obj, binson_parser *parser )
+{
+  binson       *patch;
+  binson_node  *ops, *op;
+  binson_res    res, res2;
+
+  if (!obj || !parser)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_new_with_allocator( &patch, &obj->allocator );
+  if (FAILED(res)) return res;
+
+  res = binson_init( patch, obj->error_io );
+
+  if (SUCCESS(res))
+    res = binson_deserialize( patch, parser, NULL, NULL, false );
+
+  ops = NULL;
+  if (SUCCESS(res) && patch->root && patch->root->type == BINSON_TYPE_OBJECT)
+    res = binson_node_get_child_by_key( patch, patch->root, "ops", &ops );
+
+  if (SUCCESS(res) && (!ops || ops->type != BINSON_TYPE_ARRAY))
+    res = BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+  if (SUCCESS(res))
+    res = binson_node_expand( patch, ops );
+
+  for (op = SUCCESS(res)? ops->u.c.first_child : NULL; op && SUCCESS(res); op = op->next)
+    res = binson_patch_apply_op( obj, patch, op );
+
+  res2 = binson_free( patch );
+
+  return SUCCESS(res)? res2 : res;
 }
\ No newline at end of file
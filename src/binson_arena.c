@@ -0,0 +1,364 @@
+/*
+ *  Copyright (c) 2015 ASSA ABLOY AB
+ *
+ *  This file is part of binson-c, BINSON serialization format library in C.
+ *
+ *  binson-c is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License (LGPL) as published
+ *  by the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  As a special exception, the Contributors give you permission to link
+ *  this library with independent modules to produce an executable,
+ *  regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the
+ *  terms and conditions of the license of that module. An independent
+ *  module is a module which is not derived from or based on this library.
+ *  If you modify this library, you must extend this exception to your
+ *  version of the library.
+ *
+ *  binson-c is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/********************************************//**
+ * \file binson_arena.c
+ * \brief Chunked bump allocator used as DOM tree storage
+ *
+ ***********************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "binson_arena.h"
+#include "binson_common_pvt.h"
+#include "binson_util.h"
+
+/*
+ *  Used to calculate strictest alignment required for any allocation
+ */
+typedef union binson_arena_align_
+{
+  void      *ptr;
+  int64_t    int_val;
+  double     double_val;
+
+} binson_arena_align;
+
+#define BINSON_ARENA_ALIGN            (sizeof(binson_arena_align))
+#define BINSON_ARENA_ROUND_UP(sz)     (((sz) + BINSON_ARENA_ALIGN - 1) & ~(BINSON_ARENA_ALIGN - 1))
+
+/*
+ *  Memory block header. Block payload follows header immediately
+ */
+typedef struct binson_arena_block_
+{
+  struct binson_arena_block_  *next;
+  size_t                       size;    /* payload capacity */
+  size_t                       used;    /* payload bytes already given away */
+
+} binson_arena_block;
+
+#define BINSON_ARENA_HDR_SIZE         BINSON_ARENA_ROUND_UP(sizeof(binson_arena_block))
+#define BINSON_ARENA_BLOCK_DATA(b)    ((uint8_t *)(b) + BINSON_ARENA_HDR_SIZE)
+
+/*
+ *  Arena context
+ */
+typedef struct binson_arena_
+{
+  binson_arena_block   *head;           /* current block. Allocations are served from it */
+  size_t                block_size;     /* regular block payload size */
+  size_t                total;          /* bytes reserved by all blocks, including headers */
+  binson_allocator      allocator;      /* used for context and blocks */
+  size_t                limit;          /* max 'total', 0 if not limited */
+  bool                  limit_hit;      /* last block was refused because of 'limit' */
+
+} binson_arena_;
+
+/* \brief Private helper. Allocate new block and link it to the arena
+ *
+ * \param arena binson_arena*
+ * \param size size_t             Payload capacity
+ * \param as_head bool            Make new block current one. Otherwise it's linked right after current block
+ * \return binson_arena_block*
+ */
+binson_arena_block*  binson_arena_block_add( binson_arena *arena, size_t size, bool as_head )
+{
+  binson_arena_block  *block;
+
+  arena->limit_hit = arena->limit && arena->total + BINSON_ARENA_HDR_SIZE + size > arena->limit;
+  if (arena->limit_hit)
+    return NULL;
+
+  block = (binson_arena_block *)binson_common_alloc( &arena->allocator, BINSON_ARENA_HDR_SIZE + size );
+  if (!block)
+    return NULL;
+
+  block->size = size;
+  block->used = 0;
+
+  if (as_head || !arena->head)
+  {
+    block->next = arena->head;
+    arena->head = block;
+  }
+  else
+  {
+    block->next = arena->head->next;
+    arena->head->next = block;
+  }
+
+  arena->total += BINSON_ARENA_HDR_SIZE + size;
+
+  return block;
+}
+
+/** \brief Allocate new arena context
+ *
+ * \param parena binson_arena**
+ * \return binson_res
+ */
+binson_res  binson_arena_new( binson_arena **parena )
+{
+  return binson_arena_new_with_allocator( parena, NULL );
+}
+
+/** \brief Allocate new arena context which gets all memory from specified allocator
+ *
+ * \param parena binson_arena**
+ * \param allocator const binson_allocator*  NULL for malloc() and free()
+ * \return binson_res
+ */
+binson_res  binson_arena_new_with_allocator( binson_arena **parena, const binson_allocator *allocator )
+{
+  binson_allocator  tmp;
+
+  if (!parena || !binson_common_allocator_set( &tmp, allocator ))
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *parena = (binson_arena *)binson_common_alloc( &tmp, sizeof(binson_arena_) );
+  if (!*parena)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+  (*parena)->head      = NULL;
+  (*parena)->total     = 0;
+  (*parena)->allocator = tmp;
+  (*parena)->limit     = 0;
+  (*parena)->limit_hit = false;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Initialize arena context. No memory blocks reserved till first allocation
+ *
+ * \param arena binson_arena*
+ * \param block_size size_t       Regular block size. Set to 0 to use preconfigured \c BINSON_ARENA_BLOCK_SIZE
+ * \return binson_res
+ */
+binson_res  binson_arena_init( binson_arena *arena, size_t block_size )
+{
+  if (!arena)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  arena->head        = NULL;
+  arena->block_size  = BINSON_ARENA_ROUND_UP( block_size? block_size : BINSON_ARENA_BLOCK_SIZE );
+  arena->total       = 0;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Release all allocations at once. Single regular block is kept for reuse
+ *
+ * \param arena binson_arena*
+ * \return binson_res
+ */
+binson_res  binson_arena_reset( binson_arena *arena )
+{
+  binson_arena_block  *block, *next, *keep = NULL;
+
+  if (!arena)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  for (block = arena->head; block; block = next)
+  {
+    next = block->next;
+
+    if (!keep && block->size == arena->block_size)
+    {
+      keep = block;
+      continue;
+    }
+
+    binson_common_free( &arena->allocator, block );
+  }
+
+  arena->head   = keep;
+  arena->total  = 0;
+
+  if (keep)
+  {
+    keep->next  = NULL;
+    keep->used  = 0;
+    arena->total = BINSON_ARENA_HDR_SIZE + keep->size;
+  }
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Free arena context and all memory blocks
+ *
+ * \param arena binson_arena*
+ * \return binson_res
+ */
+binson_res  binson_arena_free( binson_arena *arena )
+{
+  binson_arena_block  *block, *next;
+  binson_allocator     allocator;
+
+  if (!arena)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  allocator = arena->allocator;
+
+  for (block = arena->head; block; block = next)
+  {
+    next = block->next;
+    binson_common_free( &allocator, block );
+  }
+
+  binson_common_free( &allocator, arena );
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Allocate memory from arena. Returned memory is suitable aligned for any type
+ *
+ * Requests bigger than quarter of regular block which don't fit current block get
+ * dedicated block, so current block keeps serving small requests.
+ *
+ * \param arena binson_arena*
+ * \param size size_t
+ * \return void*                  NULL if out of memory
+ */
+void*  binson_arena_alloc( binson_arena *arena, size_t size )
+{
+  binson_arena_block  *block;
+  uint8_t             *ptr;
+
+  if (!arena)
+    return NULL;
+
+  size = BINSON_ARENA_ROUND_UP( size );
+
+  block = arena->head;
+
+  if (size > arena->block_size / 4 && (!block || block->size - block->used < size))  /* large allocation */
+  {
+    block = binson_arena_block_add( arena, size, false );
+    if (!block)
+      return NULL;
+
+    block->used = size;
+    return BINSON_ARENA_BLOCK_DATA( block );
+  }
+
+  if (!block || block->size - block->used < size)
+  {
+    block = binson_arena_block_add( arena, arena->block_size, true );
+    if (!block)
+      return NULL;
+  }
+
+  ptr = BINSON_ARENA_BLOCK_DATA( block ) + block->used;
+  block->used += size;
+
+  return ptr;
+}
+
+/** \brief Make sure next allocations are served from single contiguous block
+ *
+ * \param arena binson_arena*
+ * \param size size_t             Total size of allocations to come
+ * \param count size_t            Number of allocations to come, each may need alignment padding
+ * \return binson_res
+ */
+binson_res  binson_arena_reserve( binson_arena *arena, size_t size, size_t count )
+{
+  if (!arena)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  size += count * (BINSON_ARENA_ALIGN - 1);
+
+  if (arena->head && arena->head->size - arena->head->used >= size)
+    return BINSON_RES_OK;
+
+  return binson_arena_block_add( arena, BINSON_ARENA_ROUND_UP( size ), true )? BINSON_RES_OK : BINSON_RES_ERROR_OUT_OF_MEMORY;
+}
+
+/** \brief Allocate memory from arena and copy \c size bytes from \c src to it
+ *
+ * \param arena binson_arena*
+ * \param src const void*
+ * \param size size_t
+ * \param terminate bool          Append zero terminator, so result is valid C-string
+ * \return void*                  NULL if out of memory
+ */
+void*  binson_arena_memdup( binson_arena *arena, const void *src, size_t size, bool terminate )
+{
+  uint8_t  *ptr = (uint8_t *)binson_arena_alloc( arena, size + (terminate? 1:0) );
+
+  if (!ptr)
+    return NULL;
+
+  if (size)
+    memcpy( ptr, src, size );
+
+  if (terminate)
+    ptr[size] = '\0';
+
+  return ptr;
+}
+
+/** \brief Limit number of bytes reserved by arena. Allocations needing new block beyond the
+ *         limit fail, see binson_arena_limit_hit()
+ *
+ * \param arena binson_arena*
+ * \param limit size_t            0 for no limit
+ * \return binson_res
+ */
+binson_res  binson_arena_set_limit( binson_arena *arena, size_t limit )
+{
+  if (!arena)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  arena->limit = limit;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Check whether last failed allocation was refused because of limit, not lack of memory
+ *
+ * \param arena binson_arena*
+ * \return bool
+ */
+bool  binson_arena_limit_hit( binson_arena *arena )
+{
+  return arena? arena->limit_hit : false;
+}
+
+/** \brief Get number of bytes reserved by arena, including block headers
+ *
+ * \param arena binson_arena*
+ * \return size_t
+ */
+size_t  binson_arena_get_size( binson_arena *arena )
+{
+  return arena? arena->total : 0;
+}
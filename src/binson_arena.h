@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2015 ASSA ABLOY AB
+ *
+ *  This file is part of binson-c, BINSON serialization format library in C.
+ *
+ *  binson-c is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License (LGPL) as published
+ *  by the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  As a special exception, the Contributors give you permission to link
+ *  this library with independent modules to produce an executable,
+ *  regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the
+ *  terms and conditions of the license of that module. An independent
+ *  module is a module which is not derived from or based on this library.
+ *  If you modify this library, you must extend this exception to your
+ *  version of the library.
+ *
+ *  binson-c is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/********************************************//**
+ * \file binson_arena.h
+ * \brief Chunked bump allocator used as DOM tree storage
+ *
+ ***********************************************/
+#ifndef BINSON_ARENA_H_INCLUDED
+#define BINSON_ARENA_H_INCLUDED
+
+#include <stddef.h>
+
+#include "binson_config.h"
+#include "binson/binson_error.h"
+#include "binson/binson_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Forward declarations
+ */
+typedef struct binson_arena_  binson_arena;
+
+/*
+ *  Arena API calls
+ */
+binson_res  binson_arena_new( binson_arena **parena );
+binson_res  binson_arena_new_with_allocator( binson_arena **parena, const binson_allocator *allocator );
+binson_res  binson_arena_init( binson_arena *arena, size_t block_size );
+binson_res  binson_arena_reset( binson_arena *arena );
+binson_res  binson_arena_free( binson_arena *arena );
+binson_res  binson_arena_reserve( binson_arena *arena, size_t size, size_t count );
+
+void*       binson_arena_alloc( binson_arena *arena, size_t size );
+void*       binson_arena_memdup( binson_arena *arena, const void *src, size_t size, bool terminate );
+
+size_t      binson_arena_get_size( binson_arena *arena );
+binson_res  binson_arena_set_limit( binson_arena *arena, size_t limit );
+bool        binson_arena_limit_hit( binson_arena *arena );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BINSON_ARENA_H_INCLUDED */
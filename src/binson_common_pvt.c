@@ -36,7 +36,11 @@
  *
  ***********************************************/
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "binson_common_pvt.h"
+#include "binson_util.h"
 
 /* \brief
  *
@@ -90,4 +94,227 @@ binson_node_type   binson_common_map_sig_to_node_type( uint8_t sig, bool *pclosi
     default:
     return BINSON_TYPE_UNKNOWN;
   }
-}
\ No newline at end of file
+}
+
+/* \brief Decode complete well-formed token stored in memory
+ *
+ * \param ptr const uint8_t*       Token signature
+ * \param raw_val binson_raw_value* Decoded value. STRING/BYTES refer to payload inside token. Can be NULL
+ * \return binson_raw_size         Size of whole token including signature and length field
+ */
+binson_raw_size   binson_common_decode_token( const uint8_t *ptr, binson_raw_value *raw_val )
+{
+  binson_raw_value  tmp;
+  uint8_t           len_size = 0;
+
+  if (!raw_val)
+    raw_val = &tmp;
+
+  switch (*ptr)
+  {
+    case BINSON_SIG_TRUE:
+    case BINSON_SIG_FALSE:
+      raw_val->bool_val = (*ptr == BINSON_SIG_TRUE)? true : false;
+      return BINSON_RAW_SIG_SIZE;
+
+    case BINSON_SIG_DOUBLE:
+      raw_val->double_val = binson_util_unpack_double( ptr + BINSON_RAW_SIG_SIZE );
+      return (binson_raw_size)(BINSON_RAW_SIG_SIZE + 8);
+
+    case BINSON_SIG_INTEGER_8:
+    case BINSON_SIG_INTEGER_16:
+    case BINSON_SIG_INTEGER_32:
+    case BINSON_SIG_INTEGER_64:
+      len_size = (uint8_t)(1 << (*ptr - BINSON_SIG_INTEGER_8));
+      raw_val->int_val = binson_util_unpack_integer( ptr + BINSON_RAW_SIG_SIZE, len_size );
+      return (binson_raw_size)(BINSON_RAW_SIG_SIZE + len_size);
+
+    case BINSON_SIG_STRING_8:
+    case BINSON_SIG_STRING_16:
+    case BINSON_SIG_STRING_32:
+      len_size = (uint8_t)(1 << (*ptr - BINSON_SIG_STRING_8));
+    break;
+
+    case BINSON_SIG_BYTES_8:
+    case BINSON_SIG_BYTES_16:
+    case BINSON_SIG_BYTES_32:
+      len_size = (uint8_t)(1 << (*ptr - BINSON_SIG_BYTES_8));
+    break;
+
+    default:  /* OBJECT/ARRAY signatures */
+      return BINSON_RAW_SIG_SIZE;
+  }
+
+  raw_val->bbuf_val.bsize = (binson_size)binson_util_unpack_integer( ptr + BINSON_RAW_SIG_SIZE, len_size );
+  raw_val->bbuf_val.bptr  = (uint8_t *)ptr + BINSON_RAW_SIG_SIZE + len_size;
+
+  return (binson_raw_size)(BINSON_RAW_SIG_SIZE + len_size) + raw_val->bbuf_val.bsize;
+}
+
+/* \brief Check token signature and find token size without reading beyond available bytes
+ *
+ * \param ptr const uint8_t*       Token signature
+ * \param avail binson_raw_size    Number of bytes available starting from \c ptr
+ * \return binson_raw_size         Size of whole token, 0 if signature is unknown or token is truncated
+ */
+binson_raw_size   binson_common_token_size( const uint8_t *ptr, binson_raw_size avail )
+{
+  uint8_t  len_size;
+  int64_t  size;
+
+  if (!avail)
+    return 0;
+
+  switch (*ptr)
+  {
+    case BINSON_SIG_OBJ_BEGIN:
+    case BINSON_SIG_OBJ_END:
+    case BINSON_SIG_ARRAY_BEGIN:
+    case BINSON_SIG_ARRAY_END:
+    case BINSON_SIG_TRUE:
+    case BINSON_SIG_FALSE:
+      return BINSON_RAW_SIG_SIZE;
+
+    case BINSON_SIG_DOUBLE:
+      size = BINSON_RAW_SIG_SIZE + 8;
+    break;
+
+    case BINSON_SIG_INTEGER_8:
+    case BINSON_SIG_INTEGER_16:
+    case BINSON_SIG_INTEGER_32:
+    case BINSON_SIG_INTEGER_64:
+      size = BINSON_RAW_SIG_SIZE + (1 << (*ptr - BINSON_SIG_INTEGER_8));
+    break;
+
+    case BINSON_SIG_STRING_8:
+    case BINSON_SIG_STRING_16:
+    case BINSON_SIG_STRING_32:
+    case BINSON_SIG_BYTES_8:
+    case BINSON_SIG_BYTES_16:
+    case BINSON_SIG_BYTES_32:
+      len_size = (uint8_t)(1 << ((*ptr - BINSON_SIG_STRING_8) & 0x03));
+      if (avail < (binson_raw_size)(BINSON_RAW_SIG_SIZE + len_size))
+        return 0;
+
+      size = binson_util_unpack_integer( ptr + BINSON_RAW_SIG_SIZE, len_size );
+      if (size < 0)
+        return 0;
+
+      size += BINSON_RAW_SIG_SIZE + len_size;
+    break;
+
+    default:
+      return 0;
+  }
+
+  return (size <= (int64_t)avail)? (binson_raw_size)size : 0;
+}
+
+/* \brief Store copy of allocator in object being created
+ *
+ * \param dst binson_allocator*
+ * \param src const binson_allocator*  NULL or one with no callbacks for malloc(), realloc() and free()
+ * \return bool                        false if some of callbacks is missing
+ */
+bool  binson_common_allocator_set( binson_allocator *dst, const binson_allocator *src )
+{
+  if (!src || (!src->alloc_cb && !src->realloc_cb && !src->free_cb))
+  {
+    memset( dst, 0, sizeof(binson_allocator) );
+    return true;
+  }
+
+  if (!src->alloc_cb || !src->realloc_cb || !src->free_cb)
+    return false;
+
+  *dst = *src;
+
+  return true;
+}
+
+/* \brief Allocate memory with object's allocator
+ *
+ * \param allocator const binson_allocator*  NULL or empty one for malloc()
+ * \param size size_t
+ * \return void*
+ */
+void*  binson_common_alloc( const binson_allocator *allocator, size_t size )
+{
+  return (allocator && allocator->alloc_cb)? allocator->alloc_cb( allocator->param, size ) : malloc( size );
+}
+
+/* \brief Resize memory block with object's allocator
+ *
+ * \param allocator const binson_allocator*  NULL or empty one for realloc()
+ * \param ptr void*
+ * \param size size_t
+ * \return void*
+ */
+void*  binson_common_realloc( const binson_allocator *allocator, void *ptr, size_t size )
+{
+  return (allocator && allocator->realloc_cb)? allocator->realloc_cb( allocator->param, ptr, size ) : realloc( ptr, size );
+}
+
+/* \brief Free memory with object's allocator
+ *
+ * \param allocator const binson_allocator*  NULL or empty one for free()
+ * \param ptr void*
+ * \return void
+ */
+void  binson_common_free( const binson_allocator *allocator, void *ptr )
+{
+  if (allocator && allocator->free_cb)
+    allocator->free_cb( allocator->param, ptr );
+  else
+    free( ptr );
+}
+
+/* \brief Make nesting stack big enough to store item at \c idx. Stack may start in caller's
+ *         \c local storage, it's moved to allocated memory once outgrown
+ *
+ * \param allocator const binson_allocator*
+ * \param stack void*             Current storage, \c local or allocated one. NULL if none yet
+ * \param pcap size_t*            Current capacity in items, updated on growth
+ * \param idx size_t
+ * \param item_size size_t
+ * \param local const void*       Initial storage which is never freed. NULL if not used
+ * \return void*                  New storage, NULL if out of memory. Old storage is kept then
+ */
+void*  binson_common_stack_grow( const binson_allocator *allocator, void *stack, size_t *pcap, size_t idx, size_t item_size, const void *local )
+{
+  size_t  cap = *pcap;
+  void   *ptr;
+
+  if (stack && idx < cap)
+    return stack;
+
+  while (cap <= idx)
+    cap = cap? 2 * cap : BINSON_DEPTH_STACK_SIZE;
+
+  if (stack && stack != local)
+    ptr = binson_common_realloc( allocator, stack, cap * item_size );
+  else
+  {
+    ptr = binson_common_alloc( allocator, cap * item_size );
+    if (ptr && stack)
+      memcpy( ptr, stack, *pcap * item_size );
+  }
+
+  if (ptr)
+    *pcap = cap;
+
+  return ptr;
+}
+
+/* \brief Free nesting stack unless it's caller's initial storage
+ *
+ * \param allocator const binson_allocator*
+ * \param stack void*
+ * \param local const void*
+ * \return void
+ */
+void  binson_common_stack_free( const binson_allocator *allocator, void *stack, const void *local )
+{
+  if (stack && stack != local)
+    binson_common_free( allocator, stack );
+}
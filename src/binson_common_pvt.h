@@ -69,6 +69,15 @@ extern "C" {
 #define BINSON_SIG_BYTES_32       0x1a
 
 binson_node_type  binson_common_map_sig_to_node_type( uint8_t sig, bool *pclosing_tag );
+binson_raw_size   binson_common_decode_token( const uint8_t *ptr, binson_raw_value *raw_val );
+binson_raw_size   binson_common_token_size( const uint8_t *ptr, binson_raw_size avail );
+
+bool              binson_common_allocator_set( binson_allocator *dst, const binson_allocator *src );
+void*             binson_common_alloc( const binson_allocator *allocator, size_t size );
+void*             binson_common_realloc( const binson_allocator *allocator, void *ptr, size_t size );
+void              binson_common_free( const binson_allocator *allocator, void *ptr );
+void*             binson_common_stack_grow( const binson_allocator *allocator, void *stack, size_t *pcap, size_t idx, size_t item_size, const void *local );
+void              binson_common_stack_free( const binson_allocator *allocator, void *stack, const void *local );
 
 #ifdef __cplusplus
 }
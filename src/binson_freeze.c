@@ -0,0 +1,693 @@
+/*
+ *  Copyright (c) 2015 ASSA ABLOY AB
+ *
+ *  This file is part of binson-c, BINSON serialization format library in C.
+ *
+ *  binson-c is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License (LGPL) as published
+ *  by the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  As a special exception, the Contributors give you permission to link
+ *  this library with independent modules to produce an executable,
+ *  regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the
+ *  terms and conditions of the license of that module. An independent
+ *  module is a module which is not derived from or based on this library.
+ *  If you modify this library, you must extend this exception to your
+ *  version of the library.
+ *
+ *  binson-c is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/********************************************//**
+ * \file binson_freeze.c
+ * \brief Read-only flat DOM compiled from binson tree
+ *
+ * Whole frozen tree occupies single memory block: header, node array and
+ * string pool for keys and STRING/BYTES payloads. Children of each container
+ * occupy contiguous range of node array, ranges follow in document order.
+ * OBJECT children are sorted by key, so lookup is binary search.
+ *
+ ***********************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "binson/binson_freeze.h"
+#include "binson_common_pvt.h"
+
+/*
+ *  Used to calculate strictest alignment required for node array
+ */
+typedef union binson_frozen_align_
+{
+  void      *ptr;
+  int64_t    int_val;
+  double     double_val;
+
+} binson_frozen_align;
+
+#define BINSON_FROZEN_ALIGN            (sizeof(binson_frozen_align))
+#define BINSON_FROZEN_ROUND_UP(sz)     (((sz) + BINSON_FROZEN_ALIGN - 1) & ~(BINSON_FROZEN_ALIGN - 1))
+
+/*
+ *  Frozen node. Never changes after binson_freeze() returns
+ */
+struct binson_frozen_node_
+{
+  const char            *key;         /* zero terminated string pool entry, NULL if node has no key */
+  binson_frozen_node    *parent;
+
+  union
+  {
+    binson_frozen_node  *first_child;  /* containers. Children are 'first_child[0..child_cnt-1]' */
+    binson_value         val;          /* leaves. STRING/BYTES payload points to string pool */
+    binson_node         *src;          /* containers, during binson_freeze() only */
+
+  } u;
+
+  binson_raw_size        key_len;
+  binson_child_num       child_cnt;    /* always 0 for leaves */
+  binson_node_type       type;
+
+};
+
+/*
+ *  Frozen tree header. Node array and string pool follow it in the same block
+ */
+struct binson_frozen_
+{
+  size_t                 size;         /* whole block size, including header */
+  binson_frozen_node    *nodes;        /* root is the first one */
+  binson_allocator       allocator;    /* copy of source context's one, used to free the block */
+
+};
+
+#define BINSON_FROZEN_HDR_SIZE         BINSON_FROZEN_ROUND_UP(sizeof(binson_frozen))
+
+/*
+ *  Private helper functions
+ */
+binson_res  binson_frozen_measure( binson_node *node, binson_size *pnodes, binson_size *pcontainers, size_t *ppool );
+binson_res  binson_frozen_fill( binson_frozen_node *fnode, binson_node *node, binson_frozen_node *parent, uint8_t **ppool );
+int         binson_frozen_key_cmp( binson_frozen_node *fnode, const char *key, binson_raw_size len );
+void        binson_frozen_sort( binson_frozen_node *first, binson_child_num cnt );
+
+/* \brief Private helper. Count nodes, containers and string pool bytes of the subtree
+ *
+ * \param node binson_node*
+ * \param pnodes binson_size*
+ * \param pcontainers binson_size*
+ * \param ppool size_t*
+ * \return binson_res
+ */
+binson_res  binson_frozen_measure( binson_node *node, binson_size *pnodes, binson_size *pcontainers, size_t *ppool )
+{
+  binson_node      *cur = node, *next;
+  const char       *ptr;
+  binson_raw_size   len;
+  binson_res        res;
+
+  while (cur)
+  {
+    (*pnodes)++;
+
+    res = binson_node_get_key_ref( cur, &ptr, &len );
+    if (FAILED(res)) return res;
+
+    if (ptr)
+      *ppool += len + 1;
+
+    switch (binson_node_get_type( cur ))
+    {
+      case BINSON_TYPE_OBJECT:
+      case BINSON_TYPE_ARRAY:
+        (*pcontainers)++;
+        break;
+
+      case BINSON_TYPE_STRING:
+      case BINSON_TYPE_BYTES:
+        res = binson_node_get_string_ref( cur, &ptr, &len );
+        if (FAILED(res)) return res;
+        *ppool += len + 1;   /* BYTES are terminated too, it's cheaper than separate branch */
+        break;
+
+      default:
+        break;
+    }
+
+    /* preorder walk limited to the subtree. Lazy and shared containers are expanded by getter */
+    next = binson_node_get_first_child( cur );
+    if (next)
+    {
+      cur = next;
+      continue;
+    }
+
+    while (cur != node && !binson_node_get_next( cur ))
+      cur = binson_node_get_parent( cur );
+
+    cur = (cur == node)? NULL : binson_node_get_next( cur );
+  }
+
+  return BINSON_RES_OK;
+}
+
+/* \brief Private helper. Copy single node to frozen one. Container's children are not copied
+ *
+ * \param fnode binson_frozen_node*
+ * \param node binson_node*
+ * \param parent binson_frozen_node*
+ * \param ppool uint8_t**            Current string pool position, advanced by copied bytes
+ * \return binson_res
+ */
+binson_res  binson_frozen_fill( binson_frozen_node *fnode, binson_node *node, binson_frozen_node *parent, uint8_t **ppool )
+{
+  const char       *ptr;
+  binson_raw_size   len;
+  binson_res        res;
+
+  fnode->parent    = parent;
+  fnode->type      = binson_node_get_type( node );
+  fnode->child_cnt = 0;
+  fnode->key       = NULL;
+  fnode->key_len   = 0;
+
+  res = binson_node_get_key_ref( node, &ptr, &len );
+  if (FAILED(res)) return res;
+
+  if (ptr)
+  {
+    memcpy( *ppool, ptr, len );
+    (*ppool)[len] = '\0';
+    fnode->key     = (const char *)*ppool;
+    fnode->key_len = len;
+    *ppool += len + 1;
+  }
+
+  switch (fnode->type)
+  {
+    case BINSON_TYPE_OBJECT:
+    case BINSON_TYPE_ARRAY:
+      fnode->u.src = node;
+      return BINSON_RES_OK;
+
+    case BINSON_TYPE_BOOLEAN:
+      return binson_node_get_boolean( node, &fnode->u.val.bool_val );
+
+    case BINSON_TYPE_INTEGER:
+      return binson_node_get_integer( node, &fnode->u.val.int_val );
+
+    case BINSON_TYPE_DOUBLE:
+      return binson_node_get_double( node, &fnode->u.val.double_val );
+
+    case BINSON_TYPE_STRING:
+    case BINSON_TYPE_BYTES:
+      res = binson_node_get_string_ref( node, &ptr, &len );
+      if (FAILED(res)) return res;
+
+      if (len)
+        memcpy( *ppool, ptr, len );
+      (*ppool)[len] = '\0';
+      fnode->u.val.bbuf_val.bptr  = *ppool;
+      fnode->u.val.bbuf_val.bsize = len;
+      *ppool += len + 1;
+      return BINSON_RES_OK;
+
+    default:
+      return BINSON_RES_ERROR_TYPE_UNKNOWN;
+  }
+}
+
+/* \brief Private helper. Compare frozen node's key with specified one. Same order as DOM uses
+ *
+ * \param fnode binson_frozen_node*
+ * \param key const char*
+ * \param len binson_raw_size
+ * \return int
+ */
+int  binson_frozen_key_cmp( binson_frozen_node *fnode, const char *key, binson_raw_size len )
+{
+  int  cmp = memcmp( fnode->key, key, fnode->key_len < len? fnode->key_len : len );
+
+  if (cmp)
+    return cmp;
+
+  return fnode->key_len < len? -1 : (fnode->key_len > len? 1 : 0);
+}
+
+/* \brief Private helper. Sort OBJECT children by key. DOM keeps them sorted unless
+ *         \c binson_set_sorted_input() was used, so insertion sort is linear in common case
+ *
+ * \param first binson_frozen_node*
+ * \param cnt binson_child_num
+ * \return void
+ */
+void  binson_frozen_sort( binson_frozen_node *first, binson_child_num cnt )
+{
+  binson_frozen_node  tmp;
+  binson_child_num    i, j;
+
+  for (i = 1; i < cnt; i++)
+  {
+    if (binson_frozen_key_cmp( &first[i-1], first[i].key, first[i].key_len ) <= 0)
+      continue;
+
+    tmp = first[i];
+    for (j = i; j > 0 && binson_frozen_key_cmp( &first[j-1], tmp.key, tmp.key_len ) > 0; j--)
+      first[j] = first[j-1];
+
+    first[j] = tmp;
+  }
+}
+
+/** \brief Compile subtree into single read-only memory block
+ *
+ * Frozen tree doesn't refer to \c obj, so it stays valid after \c obj is changed or freed.
+ *
+ * \param obj binson*
+ * \param node binson_node*           Subtree root. NULL means whole tree
+ * \param pfrozen binson_frozen**     Result. Must be released with \c binson_frozen_free()
+ * \return binson_res
+ */
+binson_res  binson_freeze( binson *obj, binson_node *node, binson_frozen **pfrozen )
+{
+  binson_frozen        *frozen;
+  binson_frozen_node   *nodes, *cur, **stack;
+  const binson_allocator *allocator;
+  binson_node          *child;
+  binson_size           node_cnt = 0, cont_cnt = 0, sp = 0, next;
+  binson_child_num      cnt, i;
+  size_t                pool_size = 0;
+  uint8_t              *pool;
+  binson_res            res;
+
+  if (!obj || !pfrozen)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pfrozen = NULL;
+
+  if (!node)
+    node = binson_get_root( obj );
+  if (!node)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  res = binson_frozen_measure( node, &node_cnt, &cont_cnt, &pool_size );
+  if (FAILED(res)) return res;
+
+  allocator = binson_get_allocator( obj );
+  frozen = (binson_frozen *)binson_common_alloc( allocator, BINSON_FROZEN_HDR_SIZE + node_cnt * sizeof(binson_frozen_node) + pool_size );
+  stack  = (binson_frozen_node **)binson_common_alloc( allocator, (cont_cnt? cont_cnt : 1) * sizeof(binson_frozen_node *) );
+
+  if (!frozen || !stack)
+  {
+    if (frozen)
+      binson_common_free( allocator, frozen );
+    if (stack)
+      binson_common_free( allocator, stack );
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+  }
+
+  frozen->allocator = *allocator;
+  frozen->size  = BINSON_FROZEN_HDR_SIZE + node_cnt * sizeof(binson_frozen_node) + pool_size;
+  frozen->nodes = nodes = (binson_frozen_node *)((uint8_t *)frozen + BINSON_FROZEN_HDR_SIZE);
+  pool          = (uint8_t *)(nodes + node_cnt);
+
+  res = binson_frozen_fill( &nodes[0], node, NULL, &pool );
+  next = 1;
+
+  if (!FAILED(res) && !binson_frozen_node_is_leaf_type( &nodes[0] ))
+    stack[sp++] = &nodes[0];
+
+  /* containers are processed in document order, each gets contiguous range for children */
+  while (!FAILED(res) && sp)
+  {
+    cur   = stack[--sp];
+    child = binson_node_get_first_child( cur->u.src );
+    cnt   = 0;
+
+    for (; child && !FAILED(res); child = binson_node_get_next( child ), cnt++)
+    {
+      if (next + cnt >= node_cnt)   /* tree must not change since measured */
+        res = BINSON_RES_ERROR_BROKEN_INT_STRUCT;
+      else
+        res = binson_frozen_fill( &nodes[next + cnt], child, cur, &pool );
+    }
+
+    cur->u.first_child = &nodes[next];
+    cur->child_cnt     = cnt;
+    next += cnt;
+
+    if (FAILED(res))
+      break;
+
+    if (cur->type == BINSON_TYPE_OBJECT)
+      binson_frozen_sort( cur->u.first_child, cnt );
+
+    /* reverse order, so first child container is popped first */
+    for (i = cnt; i > 0; i--)
+      if (!binson_frozen_node_is_leaf_type( &cur->u.first_child[i-1] ))
+        stack[sp++] = &cur->u.first_child[i-1];
+  }
+
+  binson_common_free( allocator, stack );
+
+  if (FAILED(res))
+  {
+    binson_common_free( allocator, frozen );
+    return res;
+  }
+
+  *pfrozen = frozen;
+  return BINSON_RES_OK;
+}
+
+/** \brief Free frozen tree
+ *
+ * \param frozen binson_frozen*
+ * \return binson_res
+ */
+binson_res  binson_frozen_free( binson_frozen *frozen )
+{
+  binson_allocator  tmp;
+
+  if (!frozen)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  tmp = frozen->allocator;
+  binson_common_free( &tmp, frozen );
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get root node of frozen tree
+ *
+ * \param frozen binson_frozen*
+ * \return binson_frozen_node*
+ */
+binson_frozen_node*  binson_frozen_get_root( binson_frozen *frozen )
+{
+  return frozen? frozen->nodes : NULL;
+}
+
+/** \brief Get number of bytes occupied by frozen tree
+ *
+ * \param frozen binson_frozen*
+ * \return size_t
+ */
+size_t  binson_frozen_get_size( binson_frozen *frozen )
+{
+  return frozen? frozen->size : 0;
+}
+
+/** \brief Get node type
+ *
+ * \param node binson_frozen_node*
+ * \return binson_node_type
+ */
+binson_node_type  binson_frozen_node_get_type( binson_frozen_node *node )
+{
+  return node? node->type : BINSON_TYPE_UNKNOWN;
+}
+
+/** \brief Get node key
+ *
+ * \param node binson_frozen_node*
+ * \return const char*            NULL for ARRAY items and keyless root
+ */
+const char*  binson_frozen_node_get_key( binson_frozen_node *node )
+{
+  return node? node->key : NULL;
+}
+
+/** \brief Get node key and its length
+ *
+ * \param node binson_frozen_node*
+ * \param pkey const char**
+ * \param plen binson_raw_size*
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_key_ref( binson_frozen_node *node, const char **pkey, binson_raw_size *plen )
+{
+  if (!node || !pkey || !plen)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pkey = node->key;
+  *plen = node->key_len;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as boolean
+ *
+ * \param node binson_frozen_node*
+ * \param pbool bool*
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_boolean( binson_frozen_node *node, bool *pbool )
+{
+  if (!node || !pbool || node->type != BINSON_TYPE_BOOLEAN)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pbool = node->u.val.bool_val;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as integer
+ *
+ * \param node binson_frozen_node*
+ * \param pinteger int64_t*
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_integer( binson_frozen_node *node, int64_t *pinteger )
+{
+  if (!node || !pinteger || node->type != BINSON_TYPE_INTEGER)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pinteger = node->u.val.int_val;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as double
+ *
+ * \param node binson_frozen_node*
+ * \param pdouble double*
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_double( binson_frozen_node *node, double *pdouble )
+{
+  if (!node || !pdouble || node->type != BINSON_TYPE_DOUBLE)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pdouble = node->u.val.double_val;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as zero terminated string
+ *
+ * \param node binson_frozen_node*
+ * \param ppstr const char**
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_string( binson_frozen_node *node, const char **ppstr )
+{
+  binson_raw_size  len;
+
+  return binson_frozen_node_get_string_ref( node, ppstr, &len );
+}
+
+/** \brief Get value of specified node as string and its length
+ *
+ * \param node binson_frozen_node*
+ * \param ppstr const char**
+ * \param plen binson_raw_size*
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_string_ref( binson_frozen_node *node, const char **ppstr, binson_raw_size *plen )
+{
+  if (!node || !ppstr || !plen || node->type != BINSON_TYPE_STRING)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *ppstr = (const char *)node->u.val.bbuf_val.bptr;
+  *plen  = node->u.val.bbuf_val.bsize;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get value of specified node as byte array
+ *
+ * \param node binson_frozen_node*
+ * \param ppbytes const uint8_t**
+ * \param psize binson_raw_size*
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_bytes( binson_frozen_node *node, const uint8_t **ppbytes, binson_raw_size *psize )
+{
+  if (!node || !ppbytes || !psize || node->type != BINSON_TYPE_BYTES)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *ppbytes = node->u.val.bbuf_val.bptr;
+  *psize   = node->u.val.bbuf_val.bsize;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Check is specidied node is leaf node type (not ARRAY, not OBJECT)
+ *
+ * \param node binson_frozen_node*
+ * \return bool
+ */
+bool  binson_frozen_node_is_leaf_type( binson_frozen_node *node )
+{
+  return node->type != BINSON_TYPE_OBJECT && node->type != BINSON_TYPE_ARRAY;
+}
+
+/** \brief Get parent of the node
+ *
+ * \param node binson_frozen_node*
+ * \return binson_frozen_node*
+ */
+binson_frozen_node*  binson_frozen_node_get_parent( binson_frozen_node *node )
+{
+  return node? node->parent : NULL;
+}
+
+/** \brief Get left neighbor of the node
+ *
+ * \param node binson_frozen_node*
+ * \return binson_frozen_node*
+ */
+binson_frozen_node*  binson_frozen_node_get_prev( binson_frozen_node *node )
+{
+  if (!node || !node->parent || node == node->parent->u.first_child)
+    return NULL;
+
+  return node - 1;
+}
+
+/** \brief Get right neighbor of the node
+ *
+ * \param node binson_frozen_node*
+ * \return binson_frozen_node*
+ */
+binson_frozen_node*  binson_frozen_node_get_next( binson_frozen_node *node )
+{
+  if (!node || !node->parent || node == node->parent->u.first_child + node->parent->child_cnt - 1)
+    return NULL;
+
+  return node + 1;
+}
+
+/** \brief Get first child of the node
+ *
+ * \param node binson_frozen_node*
+ * \return binson_frozen_node*
+ */
+binson_frozen_node*  binson_frozen_node_get_first_child( binson_frozen_node *node )
+{
+  if (!node || !node->child_cnt)
+    return NULL;
+
+  return node->u.first_child;
+}
+
+/** \brief Get last child of the node
+ *
+ * \param node binson_frozen_node*
+ * \return binson_frozen_node*
+ */
+binson_frozen_node*  binson_frozen_node_get_last_child( binson_frozen_node *node )
+{
+  if (!node || !node->child_cnt)
+    return NULL;
+
+  return node->u.first_child + node->child_cnt - 1;
+}
+
+/** \brief Get child node by index. Constant time
+ *
+ * \param parent binson_frozen_node*
+ * \param idx binson_child_num
+ * \param pnode binson_frozen_node**   NULL if there is no such child
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_child_by_idx( binson_frozen_node *parent, binson_child_num idx, binson_frozen_node **pnode )
+{
+  if (!parent || !pnode)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pnode = idx < parent->child_cnt? parent->u.first_child + idx : NULL;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get OBJECT's child node by key. Binary search over sorted children
+ *
+ * \param parent binson_frozen_node*
+ * \param key const char*
+ * \param pnode binson_frozen_node**   NULL if there is no such child
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_child_by_key( binson_frozen_node *parent, const char *key, binson_frozen_node **pnode )
+{
+  binson_raw_size    len;
+  binson_child_num   lo = 0, hi, mid;
+  int                cmp;
+
+  if (!parent || !key || !pnode)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pnode = NULL;
+
+  if (parent->type != BINSON_TYPE_OBJECT)
+    return BINSON_RES_OK;
+
+  len = (binson_raw_size)strlen( key );
+  hi  = parent->child_cnt;
+
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    cmp = binson_frozen_key_cmp( &parent->u.first_child[mid], key, len );
+
+    if (!cmp)
+    {
+      *pnode = &parent->u.first_child[mid];
+      break;
+    }
+
+    if (cmp < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get number of children of the node
+ *
+ * \param node binson_frozen_node*
+ * \param pcnt binson_child_num*
+ * \return binson_res
+ */
+binson_res  binson_frozen_node_get_child_count( binson_frozen_node *node, binson_child_num *pcnt )
+{
+  if (!node || !pcnt)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pcnt = node->child_cnt;
+
+  return BINSON_RES_OK;
+}
@@ -43,6 +43,7 @@
 #include <stdlib.h>
 
 #include "binson/binson_io.h"
+#include "binson_common_pvt.h"
 #include "binson_util.h"
 
 /* String buffer access struct */
@@ -85,6 +86,8 @@ typedef struct binson_io_ {
   binson_res        status;        /* Last input/output operation result */
   int               errno_copy;    /* Last errno value for this object */
 
+  binson_allocator  allocator;     /* used to free context itself */
+
 } binson_io_;
 
 /** \brief Allocate new \c binson_io context object
@@ -95,7 +98,28 @@ typedef struct binson_io_ {
  */
 binson_res  binson_io_new( binson_io **pio )
 {
-  *pio = (binson_io *)malloc(sizeof(binson_io_));
+  return binson_io_new_with_allocator( pio, NULL );
+}
+
+/** \brief Allocate new \c binson_io context object with specified allocator
+ *
+ * \param pio binson_io**
+ * \param allocator const binson_allocator*  NULL for malloc() and free()
+ * \return binson_res
+ */
+binson_res  binson_io_new_with_allocator( binson_io **pio, const binson_allocator *allocator )
+{
+  binson_allocator  tmp;
+
+  if (!pio || !binson_common_allocator_set( &tmp, allocator ))
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pio = (binson_io *)binson_common_alloc( &tmp, sizeof(binson_io_) );
+  if (!*pio)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+  (*pio)->allocator = tmp;
+
   return BINSON_RES_OK;
 }
 
@@ -124,13 +148,15 @@ binson_res  binson_io_init( binson_io *io )
  */
 binson_res  binson_io_free( binson_io *io )
 {
-  binson_res  res;
+  binson_allocator  tmp;
+  binson_res        res;
 
   if (!io)
     return BINSON_RES_ERROR_ARG_WRONG;
 
   res = binson_io_close( io );
-  free( io );
+  tmp = io->allocator;
+  binson_common_free( &tmp, io );
 
   return res;
 }
@@ -215,6 +241,68 @@ binson_res  binson_io_seek( binson_io *io, binson_raw_size pos )
   return res;  
 }
 
+/** \brief Get pointer to current position of memory buffer. Lets callers refer to
+ *         buffer data in place instead of reading copies
+ *
+ * \param io binson_io*
+ * \param pptr uint8_t**
+ * \param pavail size_t*      Number of bytes left in buffer. Specify NULL to ignore.
+ * \return binson_res         BINSON_RES_ERROR_NOT_SUPPORTED for non-buffer io types
+ */
+binson_res  binson_io_get_buf_ptr( binson_io *io, uint8_t **pptr, size_t *pavail )
+{
+  if (!io || !pptr)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  if (io->type != BINSON_IO_TYPE_BUFFER)
+    return BINSON_RES_ERROR_NOT_SUPPORTED;
+
+  *pptr = io->handle.bytebuf.ptr + io->handle.bytebuf.cursor;
+
+  if (pavail)
+    *pavail = io->handle.bytebuf.buf_size - io->handle.bytebuf.cursor;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Move read position forward as if specified number of bytes was read
+ *
+ * \param io binson_io*
+ * \param size size_t
+ * \return binson_res
+ */
+binson_res  binson_io_skip( binson_io *io, size_t size )
+{
+  binson_res res = BINSON_RES_OK;
+
+  if (!io)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  switch (io->type)
+  {
+    case BINSON_IO_TYPE_STREAM:
+      if (fseek(io->handle.stream, (long)size, SEEK_CUR))
+        return BINSON_RES_ERROR_IO_SEEK;
+    break;
+
+    case BINSON_IO_TYPE_STR0:
+    case BINSON_IO_TYPE_BUFFER:
+      if (size > io->handle.bytebuf.buf_size - io->handle.bytebuf.cursor)
+        return BINSON_RES_ERROR_IO_OUT_OF_BUFFER;
+
+      io->handle.bytebuf.cursor += size;
+    break;
+
+    case BINSON_IO_TYPE_NULL:
+    default:
+    return BINSON_RES_ERROR_BROKEN_INT_STRUCT;
+  }
+
+  io->read_counter += (binson_raw_size)size;
+
+  return res;
+}
+
 /** \brief Open file with specified access mode and attach it to \c binson_io object
  *
  * \param obj binson_io*          Context
@@ -58,12 +58,17 @@ typedef struct binson_parser_
   binson_parser_cb      cb;
   void*                 param;
 
-  bool                  sig_stack[BINSON_DEPTH_LIMIT];  /* used to decide do we need to request key-val pair or just val */
+  uint8_t              *sig_stack;                 /* used to decide do we need to request key-val pair or just val */
+  uint8_t               sig_local[BINSON_DEPTH_STACK_SIZE];  /* initial 'sig_stack' storage */
+  size_t                sig_cap;
   binson_depth          depth;
+  binson_depth          max_depth;                 /* see binson_parser_set_max_depth() */
 
   bool                  done;                      /* Parsing finished */
   bool                  valid;                     /* false if something in raw input was violate binson specs */
 
+  binson_allocator      allocator;                 /* used for context and token buffer */
+
 
 } binson_parser_;
 
@@ -74,24 +79,42 @@ typedef struct binson_parser_
  */
 binson_res  binson_parser_new( binson_parser **pparser )
 {
-  binson_res  res;
+  return binson_parser_new_with_allocator( pparser, NULL );
+}
+
+/** \brief Create new parser object instance with specified allocator
+ *
+ * \param pparser binson_parser**
+ * \param allocator const binson_allocator*  NULL for malloc(), realloc() and free()
+ * \return binson_res
+ */
+binson_res  binson_parser_new_with_allocator( binson_parser **pparser, const binson_allocator *allocator )
+{
+  binson_allocator  tmp;
+  binson_res        res;
 
   /* Initial parameter validation */
-  if (!pparser )
+  if (!pparser || !binson_common_allocator_set( &tmp, allocator ))
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *pparser = (binson_parser *)malloc(sizeof(binson_parser_));
+  *pparser = (binson_parser *)binson_common_alloc( &tmp, sizeof(binson_parser_) );
   if (!*pparser)
     return BINSON_RES_ERROR_OUT_OF_MEMORY;
 
-  res =  binson_token_buf_new( &((*pparser)->token_buf) );
+  (*pparser)->allocator = tmp;
+  (*pparser)->token_buf = NULL;
+  (*pparser)->sig_stack = (*pparser)->sig_local;
+  (*pparser)->sig_cap   = BINSON_DEPTH_STACK_SIZE;
+  (*pparser)->max_depth = BINSON_DEPTH_LIMIT;
 
-  if (!(*pparser)->token_buf)
-    return BINSON_RES_ERROR_OUT_OF_MEMORY;
-  else
-    if (FAILED(res)) return res;     
+  res = binson_token_buf_new_with_allocator( &((*pparser)->token_buf), allocator );
+  if (FAILED(res))
+  {
+    binson_common_free( &tmp, *pparser );
+    *pparser = NULL;
+  }
 
-  return BINSON_RES_OK;
+  return res;
 }
 
 /** \brief Initialize new parser object instance
@@ -138,6 +161,8 @@ binson_res  binson_parser_reset( binson_parser *parser )
  */
 binson_res  binson_parser_free( binson_parser *parser )
 {
+  binson_allocator  tmp;
+
   /* Initial parameter validation */
   if (!parser)
     return BINSON_RES_ERROR_ARG_WRONG;
@@ -145,8 +170,9 @@ binson_res  binson_parser_free( binson_parser *parser )
   if (parser->token_buf)
     binson_token_buf_free( parser->token_buf );
 
-  if (parser)
-    free( parser );
+  tmp = parser->allocator;
+  binson_common_stack_free( &tmp, parser->sig_stack, parser->sig_local );
+  binson_common_free( &tmp, parser );
 
   return BINSON_RES_OK;
 }
@@ -179,7 +205,7 @@ binson_res  binson_parser_set_io( binson_parser *parser, binson_io *source )
   return BINSON_RES_OK;
 }
 
-/** \brief  Set parsing mode. Not implemented.
+/** \brief  Set parsing mode
  *
  * \param parser binson_parser*
  * \param mode binson_parser_mode
@@ -209,6 +235,62 @@ binson_res  binson_parser_set_mode( binson_parser *parser, binson_parser_mode mo
   return BINSON_RES_OK;
 }
 
+/** \brief  Get parsing mode
+ *
+ * \param parser binson_parser*
+ * \return binson_parser_mode
+ */
+binson_parser_mode  binson_parser_get_mode( binson_parser *parser )
+{
+  return parser? parser->mode : BINSON_PARSER_MODE_LAST;
+}
+
+/** \brief  Set max nesting depth of input. Deeper input fails with \c BINSON_RES_ERROR_LIMIT_EXCEEDED.
+ *          Default is \c BINSON_DEPTH_LIMIT
+ *
+ * \param parser binson_parser*
+ * \param max_depth binson_depth   Number of nested OBJECTs/ARRAYs, including top level one
+ * \return binson_res
+ */
+binson_res  binson_parser_set_max_depth( binson_parser *parser, binson_depth max_depth )
+{
+  if (!parser || !max_depth)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  parser->max_depth = max_depth;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief  Set resource ceilings of parser's token buffer. Token with bigger STRING/BYTES
+ *          payload is refused as soon as its length field is read
+ *
+ * \param parser binson_parser*
+ * \param limits const binson_limits*   NULL to remove limits. \c max_nodes is not used
+ * \return binson_res
+ */
+binson_res  binson_parser_set_limits( binson_parser *parser, const binson_limits *limits )
+{
+  if (!parser)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  return binson_token_buf_set_limits( parser->token_buf, limits );
+}
+
+/** \brief  Get current resource usage of parser's token buffer
+ *
+ * \param parser binson_parser*
+ * \param stats binson_stats*
+ * \return binson_res
+ */
+binson_res  binson_parser_get_stats( binson_parser *parser, binson_stats *stats )
+{
+  if (!parser)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  return binson_token_buf_get_stats( parser->token_buf, stats );
+}
+
 /** \brief Parse data from attached binson_io object
  *
  * \param parser binson_parser*
@@ -239,7 +321,7 @@ binson_res  binson_parser_parse( binson_parser *parser, binson_parser_cb cb, voi
 binson_res  binson_parser_parse_first( binson_parser *parser, binson_parser_cb cb, void* param )
 {
   binson_res  res;
-  uint8_t     tok_request, sig;
+  uint8_t     tok_request, sig, *stack;
   bool        valid, partial;
 
   if (!parser)
@@ -275,12 +357,27 @@ binson_res  binson_parser_parse_first( binson_parser *parser, binson_parser_cb c
   {
     case BINSON_SIG_OBJ_BEGIN:
     case BINSON_SIG_ARRAY_BEGIN:
+      if (parser->depth >= parser->max_depth)
+        return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+      stack = (uint8_t *)binson_common_stack_grow( &parser->allocator, parser->sig_stack, &parser->sig_cap,
+                                                   parser->depth, sizeof(uint8_t), parser->sig_local );
+      if (!stack)
+        return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+      parser->sig_stack = stack;
       parser->sig_stack[ parser->depth ] = sig;
       parser->depth++;
     break;
 
     case BINSON_SIG_OBJ_END:
     case BINSON_SIG_ARRAY_END:
+      if (!parser->depth)  /* unbalanced input */
+      {
+        parser->valid = false;
+        return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+      }
+
       parser->depth--;
       if (!parser->depth)
         parser->done = true;
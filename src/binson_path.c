@@ -0,0 +1,379 @@
+/*
+ *  Copyright (c) 2015 ASSA ABLOY AB
+ *
+ *  This file is part of binson-c, BINSON serialization format library in C.
+ *
+ *  binson-c is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License (LGPL) as published
+ *  by the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  As a special exception, the Contributors give you permission to link
+ *  this library with independent modules to produce an executable,
+ *  regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the
+ *  terms and conditions of the license of that module. An independent
+ *  module is a module which is not derived from or based on this library.
+ *  If you modify this library, you must extend this exception to your
+ *  version of the library.
+ *
+ *  binson-c is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/********************************************//**
+ * \file binson_path.c
+ * \brief Compiled path queries over binson DOM tree
+ *
+ * Expression is compiled once to single memory block: header, operation array
+ * and zero terminated keys. Evaluation needs no parsing and no allocations, so
+ * same compiled path may be applied to any number of trees. Key lookup relies
+ * on binson_node_get_child_by_key(), which uses hash index of big OBJECTs and
+ * stops scanning sorted siblings as soon as greater key is met.
+ *
+ ***********************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "binson/binson_path.h"
+#include "binson_common_pvt.h"
+
+/*
+ *  Path operation codes
+ */
+#define BINSON_PATH_OP_KEY        0   /* OBJECT child with 'key' */
+#define BINSON_PATH_OP_IDX        1   /* ARRAY item with 'idx' */
+#define BINSON_PATH_OP_ANY_KEY    2   /* each OBJECT child */
+#define BINSON_PATH_OP_ANY_IDX    3   /* each ARRAY item */
+
+/*
+ *  Used to calculate strictest alignment required for operation array
+ */
+typedef union binson_path_align_
+{
+  void      *ptr;
+  uint32_t   int_val;
+
+} binson_path_align;
+
+#define BINSON_PATH_ALIGN            (sizeof(binson_path_align))
+#define BINSON_PATH_ROUND_UP(sz)     (((sz) + BINSON_PATH_ALIGN - 1) & ~(BINSON_PATH_ALIGN - 1))
+
+/*
+ *  Single step of compiled path
+ */
+typedef struct binson_path_op_
+{
+  const char        *key;     /* BINSON_PATH_OP_KEY only. Points to key pool */
+  binson_child_num   idx;     /* BINSON_PATH_OP_IDX only */
+  uint8_t            code;
+
+} binson_path_op;
+
+/*
+ *  Compiled path. Operation array and key pool follow header in same memory block
+ */
+struct binson_path_
+{
+  binson_path_op    *op;
+  size_t             op_cnt;
+  size_t             size;      /* whole memory block size */
+  binson_allocator   allocator; /* used to free the block */
+};
+
+#define BINSON_PATH_HDR_SIZE         BINSON_PATH_ROUND_UP(sizeof(binson_path))
+
+/* \brief Private helper. Parse path expression. With NULL 'op' and 'pool' just measures it
+ *
+ * \param expr const char*
+ * \param op binson_path_op*        Operation array to fill or NULL
+ * \param pool char*                Key pool to fill or NULL
+ * \param pop_cnt size_t*           Number of operations
+ * \param ppool_size size_t*        Key pool size, including terminators
+ * \return binson_res
+ */
+binson_res  binson_path_parse( const char *expr, binson_path_op *op, char *pool, size_t *pop_cnt, size_t *ppool_size )
+{
+  const char        *p = expr;
+  size_t             op_cnt = 0, pool_size = 0, key_start;
+  binson_child_num   idx, digit;
+  uint8_t            code;
+  bool               key_expected = (*p && *p != '.' && *p != '[');   /* first key has no leading dot */
+
+  while (*p || key_expected)
+  {
+    if (!key_expected && *p == '.')
+    {
+      p++;
+      key_expected = true;
+    }
+
+    if (key_expected)
+    {
+      key_expected = false;
+
+      if (*p == '*' && (!p[1] || p[1] == '.' || p[1] == '['))
+      {
+        p++;
+        code = BINSON_PATH_OP_ANY_KEY;
+      }
+      else
+      {
+        if (op)
+          op[op_cnt].key = pool + pool_size;
+
+        key_start = pool_size;
+        for (; *p && *p != '.' && *p != '['; p++)
+        {
+          if (*p == '\\' && !*++p)
+            return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+          if (pool)
+            pool[pool_size] = *p;
+          pool_size++;
+        }
+
+        if (pool_size == key_start)   /* "a..b", "a." */
+          return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+        if (pool)
+          pool[pool_size] = '\0';
+        pool_size++;
+        code = BINSON_PATH_OP_KEY;
+      }
+    }
+    else if (*p == '[')
+    {
+      p++;
+      idx = 0;
+
+      if (*p == '*')
+      {
+        p++;
+        code = BINSON_PATH_OP_ANY_IDX;
+      }
+      else
+      {
+        if (*p < '0' || *p > '9')
+          return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+        for (; *p >= '0' && *p <= '9'; p++)
+        {
+          digit = (binson_child_num)(*p - '0');
+          if (idx > ((binson_child_num)~0 - digit) / 10)
+            return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+          idx = idx * 10 + digit;
+        }
+        code = BINSON_PATH_OP_IDX;
+      }
+
+      if (*p++ != ']')
+        return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+      if (op)
+        op[op_cnt].idx = idx;
+    }
+    else
+      return BINSON_RES_ERROR_PARSE_INVALID_INPUT;
+
+    if (op)
+      op[op_cnt].code = code;
+    op_cnt++;
+  }
+
+  *pop_cnt    = op_cnt;
+  *ppool_size = pool_size;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Compile path expression to reusable form
+ *
+ * \param expr const char*
+ * \param ppath binson_path**
+ * \return binson_res              \c BINSON_RES_ERROR_PARSE_INVALID_INPUT if syntax is wrong
+ */
+binson_res  binson_path_compile( const char *expr, binson_path **ppath )
+{
+  return binson_path_compile_with_allocator( expr, ppath, NULL );
+}
+
+/** \brief Compile path expression to reusable form, allocated with specified allocator
+ *
+ * \param expr const char*
+ * \param ppath binson_path**
+ * \param allocator const binson_allocator*  NULL for malloc() and free()
+ * \return binson_res              \c BINSON_RES_ERROR_PARSE_INVALID_INPUT if syntax is wrong
+ */
+binson_res  binson_path_compile_with_allocator( const char *expr, binson_path **ppath, const binson_allocator *allocator )
+{
+  binson_path      *path;
+  binson_allocator  tmp;
+  size_t            op_cnt, pool_size, size;
+  binson_res        res;
+
+  if (!expr || !ppath || !binson_common_allocator_set( &tmp, allocator ))
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *ppath = NULL;
+
+  res = binson_path_parse( expr, NULL, NULL, &op_cnt, &pool_size );
+  if (FAILED(res)) return res;
+
+  size = BINSON_PATH_HDR_SIZE + op_cnt * sizeof(binson_path_op) + pool_size;
+  path = (binson_path *)binson_common_alloc( &tmp, size );
+  if (!path)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+  path->op        = (binson_path_op *)((uint8_t *)path + BINSON_PATH_HDR_SIZE);
+  path->op_cnt    = op_cnt;
+  path->size      = size;
+  path->allocator = tmp;
+
+  res = binson_path_parse( expr, path->op, (char *)(path->op + op_cnt), &op_cnt, &pool_size );
+  if (FAILED(res))
+  {
+    binson_common_free( &tmp, path );
+    return res;
+  }
+
+  *ppath = path;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Free compiled path
+ *
+ * \param path binson_path*
+ * \return binson_res
+ */
+binson_res  binson_path_free( binson_path *path )
+{
+  binson_allocator  tmp;
+
+  if (!path)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  tmp = path->allocator;
+  binson_common_free( &tmp, path );
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get number of bytes occupied by compiled path
+ *
+ * \param path binson_path*
+ * \return size_t
+ */
+size_t  binson_path_get_size( binson_path *path )
+{
+  return path? path->size : 0;
+}
+
+/* \brief Private helper. Apply operations from 'op' up to 'end' to 'node'. Single child
+ *        steps are followed in place, only wildcards recurse
+ *
+ * \param obj binson*
+ * \param op binson_path_op*
+ * \param end binson_path_op*
+ * \param node binson_node*
+ * \param nodes binson_node**
+ * \param max_cnt size_t
+ * \param pcnt size_t*
+ * \return binson_res
+ */
+binson_res  binson_path_walk( binson *obj, binson_path_op *op, binson_path_op *end, binson_node *node,
+                              binson_node **nodes, size_t max_cnt, size_t *pcnt )
+{
+  binson_node  *child;
+  binson_res    res;
+
+  for (; op < end; op++)
+  {
+    switch (op->code)
+    {
+      case BINSON_PATH_OP_KEY:
+        if (binson_node_get_type( node ) != BINSON_TYPE_OBJECT)
+          return BINSON_RES_OK;
+        res = binson_node_get_child_by_key( obj, node, op->key, &child );
+        break;
+
+      case BINSON_PATH_OP_IDX:
+        if (binson_node_get_type( node ) != BINSON_TYPE_ARRAY)
+          return BINSON_RES_OK;
+        res = binson_node_get_child_by_idx( obj, node, op->idx, &child );
+        break;
+
+      default:
+        if (binson_node_get_type( node ) != (op->code == BINSON_PATH_OP_ANY_KEY? BINSON_TYPE_OBJECT : BINSON_TYPE_ARRAY))
+          return BINSON_RES_OK;
+
+        for (child = binson_node_get_first_child( node ); child && *pcnt < max_cnt; child = binson_node_get_next( child ))
+        {
+          res = binson_path_walk( obj, op + 1, end, child, nodes, max_cnt, pcnt );
+          if (FAILED(res)) return res;
+        }
+        return BINSON_RES_OK;
+    }
+
+    if (FAILED(res) || !child)
+      return res;
+
+    node = child;
+  }
+
+  if (*pcnt < max_cnt)
+    nodes[(*pcnt)++] = node;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Find first node matching compiled path
+ *
+ * \param obj binson*
+ * \param path binson_path*
+ * \param root binson_node*         Start node. Tree root if NULL
+ * \param pnode binson_node**       Set to NULL if nothing found
+ * \return binson_res
+ */
+binson_res  binson_path_eval( binson *obj, binson_path *path, binson_node *root, binson_node **pnode )
+{
+  size_t  cnt;
+
+  if (!pnode)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pnode = NULL;
+
+  return binson_path_eval_all( obj, path, root, pnode, 1, &cnt );
+}
+
+/** \brief Find all nodes matching compiled path, in document order
+ *
+ * \param obj binson*
+ * \param path binson_path*
+ * \param root binson_node*         Start node. Tree root if NULL
+ * \param nodes binson_node**       Array to store found nodes to
+ * \param max_cnt size_t            Search stops when array is full
+ * \param pcnt size_t*              Number of stored nodes
+ * \return binson_res
+ */
+binson_res  binson_path_eval_all( binson *obj, binson_path *path, binson_node *root, binson_node **nodes, size_t max_cnt, size_t *pcnt )
+{
+  if (!obj || !path || !nodes || !pcnt)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  *pcnt = 0;
+
+  if (!root)
+    root = binson_get_root( obj );
+
+  return binson_path_walk( obj, path->op, path->op + path->op_cnt, root, nodes, max_cnt, pcnt );
+}
@@ -81,11 +81,18 @@ typedef struct binson_token_buf_
 
   bool                   is_valid;
 
+  binson_allocator       allocator;    /* used for context and internal buffer */
+
+  /* limits, 0 if not limited */
+  binson_raw_size        max_token;    /* STRING/BYTES payload size */
+  size_t                 max_size;     /* internal buffer size */
+
 } binson_token_buf;
 
 /*
  *  Forward declarations
  */
+binson_res  binson_token_buf_new_with_allocator( binson_token_buf **ptbuf, const binson_allocator *allocator );
 binson_res  binson_token_buf_set_buf( binson_token_buf *tbuf, uint8_t *bptr, binson_raw_size bsize );
 
 
@@ -222,10 +229,28 @@ binson_res  last_token_rescan( binson_token_buf *tbuf, size_t *missing_bytes, bo
  */
 binson_res  binson_token_buf_new( binson_token_buf **ptbuf )
 {
-  if (!ptbuf)
+  return binson_token_buf_new_with_allocator( ptbuf, NULL );
+}
+
+/** \brief Create new token buffer instance with specified allocator
+ *
+ * \param ptbuf binson_token_buf**
+ * \param allocator const binson_allocator*  NULL for malloc(), realloc() and free()
+ * \return binson_res
+ */
+binson_res  binson_token_buf_new_with_allocator( binson_token_buf **ptbuf, const binson_allocator *allocator )
+{
+  binson_allocator  tmp;
+
+  if (!ptbuf || !binson_common_allocator_set( &tmp, allocator ))
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *ptbuf = (binson_token_buf *)calloc(sizeof(binson_token_buf), 1);
+  *ptbuf = (binson_token_buf *)binson_common_alloc( &tmp, sizeof(binson_token_buf) );
+  if (!*ptbuf)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+  memset( *ptbuf, 0, sizeof(binson_token_buf) );
+  (*ptbuf)->allocator = tmp;
 
   return BINSON_RES_OK;
 }
@@ -279,14 +304,17 @@ binson_res  binson_token_buf_init( binson_token_buf *tbuf, uint8_t *bptr, binson
  */
 binson_res  binson_token_buf_free( binson_token_buf *tbuf )
 {
+  binson_allocator  tmp;
+
   if (!tbuf)
     return BINSON_RES_ERROR_ARG_WRONG;
 
+  tmp = tbuf->allocator;
+
   if (tbuf->malloced && tbuf->ptr)
-    free( tbuf->ptr );
+    binson_common_free( &tmp, tbuf->ptr );
 
-  if (tbuf)
-    free( tbuf );
+  binson_common_free( &tmp, tbuf );
 
   return BINSON_RES_OK;
 }
@@ -350,7 +378,7 @@ binson_res  binson_token_buf_set_buf( binson_token_buf *tbuf, uint8_t *bptr, bin
 
   if (tbuf->ptr && tbuf->malloced && !bptr && bsize > tbuf->size)  /* try to reallocate to bigger memory block */
   {
-    uint8_t *pnew = (uint8_t *)realloc(tbuf->ptr, bsize);
+    uint8_t *pnew = (uint8_t *)binson_common_realloc( &tbuf->allocator, tbuf->ptr, bsize );
     if (pnew)
     {
       tbuf->ptr   = pnew;
@@ -363,7 +391,7 @@ binson_res  binson_token_buf_set_buf( binson_token_buf *tbuf, uint8_t *bptr, bin
 
   if (tbuf->ptr && tbuf->ptr != bptr && tbuf->malloced)   /* looks like already allocated */
   {
-    free( tbuf->ptr );
+    binson_common_free( &tbuf->allocator, tbuf->ptr );
     tbuf->malloced  = false;
     tbuf->ptr       = NULL;
     tbuf->size      = 0;
@@ -374,9 +402,12 @@ binson_res  binson_token_buf_set_buf( binson_token_buf *tbuf, uint8_t *bptr, bin
 
   if (!bptr)  /* allocate buffer of specified size */
   {
-     tbuf->ptr        = (uint8_t *)malloc(bsize);
-     tbuf->size       = bsize;
+     tbuf->ptr        = (uint8_t *)binson_common_alloc( &tbuf->allocator, bsize );
+     tbuf->size       = tbuf->ptr? bsize : 0;
      tbuf->malloced   = true;
+
+     if (!tbuf->ptr)
+       return BINSON_RES_ERROR_OUT_OF_MEMORY;
   }
   else  /* just use external buffer as specified by args */
   {
@@ -388,6 +419,41 @@ binson_res  binson_token_buf_set_buf( binson_token_buf *tbuf, uint8_t *bptr, bin
   return BINSON_RES_OK;
 }
 
+/** \brief Set resource ceilings. Token with bigger STRING/BYTES payload and buffer growth
+ *         beyond \c max_bytes fail with \c BINSON_RES_ERROR_LIMIT_EXCEEDED
+ *
+ * \param tbuf binson_token_buf*
+ * \param limits const binson_limits*   NULL to remove limits. \c max_nodes is not used
+ * \return binson_res
+ */
+binson_res  binson_token_buf_set_limits( binson_token_buf *tbuf, const binson_limits *limits )
+{
+  if (!tbuf)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  tbuf->max_token = limits? limits->max_token : 0;
+  tbuf->max_size  = limits? limits->max_bytes : 0;
+
+  return BINSON_RES_OK;
+}
+
+/** \brief Get current resource usage. External buffer is not accounted
+ *
+ * \param tbuf binson_token_buf*
+ * \param stats binson_stats*
+ * \return binson_res
+ */
+binson_res  binson_token_buf_get_stats( binson_token_buf *tbuf, binson_stats *stats )
+{
+  if (!tbuf || !stats)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  stats->bytes = tbuf->malloced? tbuf->size : 0;
+  stats->nodes = 0;
+
+  return BINSON_RES_OK;
+}
+
 /** \brief Read data from source io till \c tok_count tokens become valid. Subsequent calls
  *  to this function continue token filling. It's used for streaming when underlying io layer
  *  can't fulfill one-time request
@@ -413,6 +479,11 @@ binson_res  binson_token_buf_token_fill( binson_token_buf *tbuf, uint8_t *tok_co
   while (tbuf->current_token < tbuf->tokens_requested  && valid)
   {
       res = last_token_rescan(tbuf, &to_read, &valid);
+
+      /* length field is known as soon as it's read, so huge payload is refused before it's buffered */
+      if (tbuf->max_token && tok->len_size && tok->val_size > tbuf->max_token)
+        return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
       switch (res)
       {
         case BINSON_RES_OK:
@@ -430,6 +501,14 @@ binson_res  binson_token_buf_token_fill( binson_token_buf *tbuf, uint8_t *tok_co
           {
             binson_raw_size   delta = MAX( tok->offset + tok->size + to_read - tbuf->size, BINSON_TOKEN_BUF_SIZE_INC );
 
+            if (tbuf->max_size)
+            {
+              if (tok->offset + tok->size + to_read > tbuf->max_size)
+                return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
+              delta = (binson_raw_size)MIN( delta, tbuf->max_size - tbuf->size );
+            }
+
             res = binson_token_buf_set_buf( tbuf, NULL, tbuf->size + delta );
             if (FAILED(res)) return res;  /* critical error */
           }
@@ -62,11 +62,18 @@ typedef struct binson_writer_
    * current horizontal item index to restore it on the return trip. This functionality implemented
    * for BINSON_WRITER_FORMAT_JSON_* modes only to keep track of commas on each level.
    */
-  uint8_t               sig_stack[BINSON_DEPTH_LIMIT]; /* Used to keep track of parents: OBJECT or ARRAY */
-  binson_child_num      idx_stack[BINSON_DEPTH_LIMIT]; /* Tracking indexes of children */
-  int                   depth;                         /* Current tree depth. Used as stack top pointer */
+  uint8_t              *sig_stack;                     /* Used to keep track of parents: OBJECT or ARRAY */
+  binson_child_num     *idx_stack;                     /* Tracking indexes of children */
+  size_t                sig_cap, idx_cap;
+  uint8_t               sig_local[BINSON_DEPTH_STACK_SIZE];      /* initial stack storage, */
+  binson_child_num      idx_local[BINSON_DEPTH_STACK_SIZE + 1];  /* so shallow output allocates nothing */
 #endif
 
+  int                   depth;                         /* Current tree depth. Used as stack top pointer */
+  binson_depth          max_depth;                     /* see binson_writer_set_max_depth() */
+
+  binson_allocator      allocator;               /* Used for context and temporary buffers */
+
 } binson_writer_;
 
 /*
@@ -129,6 +136,33 @@ binson_res  write_key( binson_writer *writer, const char* key, int force_no_sepa
   return res;
 }
 
+#ifdef WITH_BINSON_JSON_OUTPUT
+/* \brief Private helper. Make room in tracking stacks for one more nesting level
+ *
+ * \param writer binson_writer*
+ * \return binson_res
+ */
+binson_res  write_stack_grow( binson_writer *writer )
+{
+  uint8_t           *sig_stack;
+  binson_child_num  *idx_stack;
+
+  sig_stack = (uint8_t *)binson_common_stack_grow( &writer->allocator, writer->sig_stack, &writer->sig_cap,
+                                                   (size_t)writer->depth, sizeof(uint8_t), writer->sig_local );
+  if (!sig_stack)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+  writer->sig_stack = sig_stack;
+
+  idx_stack = (binson_child_num *)binson_common_stack_grow( &writer->allocator, writer->idx_stack, &writer->idx_cap,
+                                                            (size_t)writer->depth + 1, sizeof(binson_child_num), writer->idx_local );
+  if (!idx_stack)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+  writer->idx_stack = idx_stack;
+
+  return BINSON_RES_OK;
+}
+#endif
+
 /* \brief Private helper. Common code for writing OBJECT & ARRAY signatures
  *
  * \param writer binson_writer*       Context
@@ -144,26 +178,44 @@ binson_res  write_frame_sig( binson_writer *writer, const char* key, uint8_t sig
   if (!writer)
     return BINSON_RES_ERROR_ARG_WRONG;
 
+  if (sig == BINSON_SIG_OBJ_BEGIN || sig == BINSON_SIG_ARRAY_BEGIN)
+  {
+    if (writer->depth >= writer->max_depth)
+      return BINSON_RES_ERROR_LIMIT_EXCEEDED;
+
 #ifdef WITH_BINSON_JSON_OUTPUT
+    res = write_stack_grow( writer );
+    if (FAILED(res)) return res;
+#endif
+  }
+
  if (sig == BINSON_SIG_OBJ_END || sig == BINSON_SIG_ARRAY_END)
   {
+    if (writer->depth <= 0)  /* nothing to close */
+      return BINSON_RES_ERROR_ARG_WRONG_COMB;
+
     writer->depth--;
+#ifdef WITH_BINSON_JSON_OUTPUT
     writer->idx_stack[writer->depth]++;
-  }
 #endif
+  }
 
   /* write key if needed */
   res = write_key( writer, key, (sig == BINSON_SIG_OBJ_END || sig == BINSON_SIG_ARRAY_END)? true : false );
   if (FAILED(res)) return res;
 
-#ifdef WITH_BINSON_JSON_OUTPUT
   /* Updating tracking vars for new nesting level */
   if (sig == BINSON_SIG_OBJ_BEGIN || sig == BINSON_SIG_ARRAY_BEGIN)
   {
+#ifdef WITH_BINSON_JSON_OUTPUT
     writer->sig_stack[writer->depth] = sig;
+#endif
     writer->depth++;
+#ifdef WITH_BINSON_JSON_OUTPUT
     writer->idx_stack[writer->depth] = 0;
+#endif
   }
+#ifdef WITH_BINSON_JSON_OUTPUT
   else
   if (sig != BINSON_SIG_OBJ_END && sig != BINSON_SIG_ARRAY_END)
   {
@@ -206,11 +258,37 @@ binson_res  write_frame_sig( binson_writer *writer, const char* key, uint8_t sig
  */
 binson_res  binson_writer_new( binson_writer **pwriter )
 {
+  return binson_writer_new_with_allocator( pwriter, NULL );
+}
+
+/** \brief Allocates new \c binson_writer context with specified allocator
+ *
+ * \param writer binson_writer**        Context pointer
+ * \param allocator const binson_allocator*  NULL for malloc() and free()
+ * \return binson_res                   Result code
+ */
+binson_res  binson_writer_new_with_allocator( binson_writer **pwriter, const binson_allocator *allocator )
+{
+  binson_allocator  tmp;
+
   /* Initial parameter validation */
-  if (!pwriter )
+  if (!pwriter || !binson_common_allocator_set( &tmp, allocator ))
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  *pwriter = (binson_writer *)malloc(sizeof(binson_writer_));
+  *pwriter = (binson_writer *)binson_common_alloc( &tmp, sizeof(binson_writer_) );
+  if (!*pwriter)
+    return BINSON_RES_ERROR_OUT_OF_MEMORY;
+
+  (*pwriter)->allocator = tmp;
+  (*pwriter)->depth     = 0;
+  (*pwriter)->max_depth = BINSON_DEPTH_LIMIT;
+
+#ifdef WITH_BINSON_JSON_OUTPUT
+  (*pwriter)->sig_stack = (*pwriter)->sig_local;
+  (*pwriter)->idx_stack = (*pwriter)->idx_local;
+  (*pwriter)->sig_cap   = BINSON_DEPTH_STACK_SIZE;
+  (*pwriter)->idx_cap   = BINSON_DEPTH_STACK_SIZE + 1;
+#endif
 
   return BINSON_RES_OK;
 }
@@ -222,12 +300,20 @@ binson_res  binson_writer_new( binson_writer **pwriter )
  */
 binson_res  binson_writer_free( binson_writer *writer )
 {
+  binson_allocator  tmp;
+
   /** Initial parameter validation */
   if (!writer)
     return BINSON_RES_ERROR_ARG_WRONG;
 
-  if (writer)
-    free( writer );
+  tmp = writer->allocator;
+
+#ifdef WITH_BINSON_JSON_OUTPUT
+  binson_common_stack_free( &tmp, writer->sig_stack, writer->sig_local );
+  binson_common_stack_free( &tmp, writer->idx_stack, writer->idx_local );
+#endif
+
+  binson_common_free( &tmp, writer );
 
   return BINSON_RES_OK;
 }
@@ -276,6 +362,16 @@ binson_io*  binson_writer_get_io( binson_writer *writer )
   return writer? writer->io : NULL;
 }
 
+/** \brief Get current output format
+ *
+ * \param writer binson_writer*
+ * \return binson_writer_format   BINSON_WRITER_FORMAT_LAST if no writer specified
+ */
+binson_writer_format  binson_writer_get_format( binson_writer *writer )
+{
+  return writer? writer->format : BINSON_WRITER_FORMAT_LAST;
+}
+
 /** \brief Reset current state and start new writer session
  *
  * \param writer binson_writer*   Context
@@ -292,8 +388,9 @@ binson_res  binson_writer_init( binson_writer *writer, binson_io *io, binson_wri
   writer->io                 = io;
   writer->format             = format;
 
-#ifdef WITH_BINSON_JSON_OUTPUT
   writer->depth              = 0;
+
+#ifdef WITH_BINSON_JSON_OUTPUT
   writer->idx_stack[0]       = 0;
   writer->sig_stack[0]       = 0;
 #endif
@@ -301,6 +398,24 @@ binson_res  binson_writer_init( binson_writer *writer, binson_io *io, binson_wri
   return BINSON_RES_OK;
 }
 
+/** \brief Set max nesting depth of output. Deeper OBJECT/ARRAY fails with
+ *         \c BINSON_RES_ERROR_LIMIT_EXCEEDED. Default is \c BINSON_DEPTH_LIMIT
+ *
+ * \param writer binson_writer*         Context
+ * \param max_depth binson_depth        Number of nested OBJECTs/ARRAYs, including top level one
+ * \return binson_res                   Result code
+ */
+binson_res  binson_writer_set_max_depth( binson_writer *writer, binson_depth max_depth )
+{
+  /* Initial parameter validation */
+  if (!writer || !max_depth)
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  writer->max_depth = max_depth;
+
+  return BINSON_RES_OK;
+}
+
 /** \brief Write output for OBJECT begin
  *
  * \param writer binson_writer*   Context
@@ -557,7 +672,9 @@ binson_res  write_bytes( binson_writer *writer, uint8_t *src_ptr,  size_t src_si
   if (sig == BINSON_SIG_STRING_8 && !binson_utf8_is_valid( src_ptr ) )
   {
       encoded = true;
-      src_utf8_ptr = (uint8_t*) malloc(4*src_size+2);
+      src_utf8_ptr = (uint8_t*) binson_common_alloc( &writer->allocator, 4*src_size+2 );
+      if (!src_utf8_ptr)
+        return BINSON_RES_ERROR_OUT_OF_MEMORY;
       src_utf8_size = binson_utf8_unescape( src_utf8_ptr, 4*src_size+2, src_ptr );
   }
 
@@ -625,7 +742,7 @@ binson_res  write_bytes( binson_writer *writer, uint8_t *src_ptr,  size_t src_si
 
   /* UTF-8 encoding needed some malloc's */
   if (encoded)
-    free(src_utf8_ptr);
+    binson_common_free( &writer->allocator, src_utf8_ptr );
 
   return res;
 }
@@ -673,6 +790,44 @@ binson_res  binson_writer_write_bytes( binson_writer *writer, const char* key, u
   return res;
 }
 
+/** \brief Write already serialized binson data as is. Caller is responsible for its validity.
+ *         Supported for BINSON_WRITER_FORMAT_RAW and BINSON_WRITER_FORMAT_HEX only
+ *
+ * \param writer binson_writer*   Context
+ * \param src_ptr const uint8_t*  Serialized binson tokens
+ * \param src_size size_t         Number of bytes to write
+ * \return binson_res             Result code
+ */
+binson_res  binson_writer_write_raw( binson_writer *writer, const uint8_t *src_ptr,  size_t src_size )
+{
+  binson_res  res = BINSON_RES_OK;
+  size_t      i;
+
+  /* Initial parameter validation */
+  if (!writer || (!src_ptr && src_size))
+    return BINSON_RES_ERROR_ARG_WRONG;
+
+  switch (writer->format)
+  {
+    case BINSON_WRITER_FORMAT_RAW:
+      res = binson_io_write( writer->io, src_ptr, src_size );
+    break;
+
+    case BINSON_WRITER_FORMAT_HEX:
+      for (i=0; i<src_size && SUCCESS(res); i++)
+        res = binson_io_printf( writer->io, "%02x ", src_ptr[i] );
+      if (SUCCESS(res))
+        res = binson_io_write_str( writer->io, "\n", true );
+    break;
+
+    default:
+      res = BINSON_RES_ERROR_NOT_SUPPORTED;
+    break;
+  }
+
+  return res;
+}
+
 /** \brief Write binson primitive specified by type, key, value
  *
  * \param writer binson_writer*
@@ -0,0 +1,127 @@
+/*
+ *	Test DOM storage arena allocator
+ */
+#include <string.h>
+
+#include "btest.h"
+
+#include "binson_arena.h"
+
+static void utest_binson_arena_alloc(void **state) {
+    (void) state;
+
+    binson_arena  *arena;
+    binson_res     res;
+    uint8_t       *p1, *p2, *big;
+
+    res = binson_arena_new( &arena );      assert_int_equal(res, BINSON_RES_OK );
+    res = binson_arena_init( arena, 64 );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( binson_arena_get_size(arena), 0 );
+
+    p1 = binson_arena_alloc( arena, 3 );
+    p2 = binson_arena_alloc( arena, 5 );
+    assert_true( p1 && p2 && p1 != p2 );
+    assert_int_equal( ((size_t)p2) % sizeof(void*), 0 );   /* aligned */
+    memset( p1, 0xaa, 3 );
+    memset( p2, 0xbb, 5 );
+
+    /* large allocation goes to dedicated block */
+    big = binson_arena_alloc( arena, 1000 );
+    assert_true( big != NULL );
+    memset( big, 0xcc, 1000 );
+    assert_int_equal( p1[2], 0xaa );
+
+    /* more small ones than single block can hold */
+    for (int i=0; i<100; i++)
+      assert_true( binson_arena_alloc( arena, 8 ) != NULL );
+
+    assert_true( binson_arena_get_size(arena) > 1000 + 100*8 );
+
+    res = binson_arena_free( arena );    assert_int_equal(res, BINSON_RES_OK );
+}
+
+static void utest_binson_arena_memdup(void **state) {
+    (void) state;
+
+    binson_arena  *arena;
+    binson_res     res;
+    char          *s;
+    uint8_t       *b;
+
+    res = binson_arena_new( &arena );      assert_int_equal(res, BINSON_RES_OK );
+    res = binson_arena_init( arena, 0 );   assert_int_equal(res, BINSON_RES_OK );
+
+    s = binson_arena_memdup( arena, "abcdef", 3, true );
+    assert_string_equal( s, "abc" );
+
+    b = binson_arena_memdup( arena, "\x01\x02\x03", 3, false );
+    assert_memory_equal( b, "\x01\x02\x03", 3 );
+
+    s = binson_arena_memdup( arena, NULL, 0, true );
+    assert_string_equal( s, "" );
+
+    res = binson_arena_free( arena );    assert_int_equal(res, BINSON_RES_OK );
+}
+
+static void utest_binson_arena_reset(void **state) {
+    (void) state;
+
+    binson_arena  *arena;
+    binson_res     res;
+    size_t         sz;
+
+    res = binson_arena_new( &arena );      assert_int_equal(res, BINSON_RES_OK );
+    res = binson_arena_init( arena, 64 );  assert_int_equal(res, BINSON_RES_OK );
+
+    for (int i=0; i<50; i++)
+      assert_true( binson_arena_alloc( arena, 16 ) != NULL );
+    assert_true( binson_arena_alloc( arena, 500 ) != NULL );
+
+    /* only single regular block survives reset */
+    res = binson_arena_reset( arena );     assert_int_equal(res, BINSON_RES_OK );
+    sz = binson_arena_get_size( arena );
+    assert_true( sz > 0 && sz < 200 );
+
+    assert_true( binson_arena_alloc( arena, 16 ) != NULL );
+    assert_int_equal( binson_arena_get_size( arena ), sz );
+
+    res = binson_arena_free( arena );    assert_int_equal(res, BINSON_RES_OK );
+}
+
+static void utest_binson_arena_reserve(void **state) {
+    (void) state;
+
+    binson_arena  *arena;
+    binson_res     res;
+    uint8_t       *p, *prev = NULL;
+    size_t         sz;
+
+    res = binson_arena_new( &arena );      assert_int_equal(res, BINSON_RES_OK );
+    res = binson_arena_init( arena, 64 );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* reserved room serves both small and large requests */
+    res = binson_arena_reserve( arena, 10*3 + 200, 11 );  assert_int_equal(res, BINSON_RES_OK );
+    sz = binson_arena_get_size( arena );
+
+    for (int i=0; i<10; i++)
+    {
+      p = binson_arena_alloc( arena, 3 );
+      assert_true( p > prev );
+      prev = p;
+    }
+    p = binson_arena_alloc( arena, 200 );
+    assert_true( p > prev );
+    assert_int_equal( binson_arena_get_size( arena ), sz );
+
+    res = binson_arena_free( arena );    assert_int_equal(res, BINSON_RES_OK );
+}
+
+int utest_run_tests(void) {
+  const struct CMUnitTest tests[] = {
+	      cmocka_unit_test(utest_binson_arena_alloc),
+	      cmocka_unit_test(utest_binson_arena_memdup),
+	      cmocka_unit_test(utest_binson_arena_reset),
+	      cmocka_unit_test(utest_binson_arena_reserve),
+	      };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
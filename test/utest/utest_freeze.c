@@ -0,0 +1,159 @@
+/*
+ *	Test frozen read-only flat DOM
+ */
+#include <string.h>
+
+#include "btest.h"
+
+#include "binson/binson.h"
+#include "binson/binson_freeze.h"
+
+// {"a":[true,13,-2.34,"zxc",{"d":false, "e":"0x030405", "q":"qwe"},9223372036854775807]}
+static const uint8_t sb1[]  = "\x40\x14\x01\x61\x42\x44\x10\x0d\x46\xb8\x1e\x85\xeb\x51\xb8\x02\xc0\x14\x03\x7a\x78\x63\x40\x14\x01\x64\x45\x14\x01\x65\x18\x03\x03\x04\x05\x14\x01\x71\x14\x03\x71\x77\x65\x41\x13\xff\xff\xff\xff\xff\xff\xff\x7f\x43\x41";
+
+static void utest_freeze_build(void **state) {
+    (void) state;
+
+    binson              *obj;
+    binson_node         *top, *arr, *node;
+    binson_frozen       *frozen;
+    binson_frozen_node  *root, *fnode, *farr;
+    binson_res           res;
+    binson_child_num     cnt;
+    int64_t              ival;
+    double               dval;
+    bool                 bval;
+    const char          *str;
+    const uint8_t       *bytes;
+    binson_raw_size      len;
+    uint8_t              raw[] = { 1, 2, 3 };
+
+    res = binson_new( &obj );         assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj, NULL );   assert_int_equal(res, BINSON_RES_OK );
+
+    /* {"c":[true,1.5,{"z":0x010203}], "a":7, "b":"str", "d":{}} with unsorted input */
+    res = binson_set_sorted_input( obj, true );   assert_int_equal(res, BINSON_RES_OK );
+    top = binson_get_root( obj );
+    res = binson_node_add_array_empty( obj, top, "c", &arr );       assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_boolean( obj, arr, NULL, NULL, true );     assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_double( obj, arr, NULL, NULL, 1.5 );       assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( obj, arr, NULL, &node );     assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_bytes( obj, node, "z", NULL, raw, sizeof(raw) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( obj, top, "a", NULL, 7 );        assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj, top, "b", NULL, "str" );        assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( obj, top, "d", NULL );      assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_freeze( obj, NULL, &frozen );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( binson_frozen_get_size( frozen ) > 9 * sizeof(void*) );
+
+    /* frozen tree is independent of the source one */
+    res = binson_free( obj );   assert_int_equal(res, BINSON_RES_OK );
+
+    root = binson_frozen_get_root( frozen );
+    assert_int_equal( binson_frozen_node_get_type( root ), BINSON_TYPE_OBJECT );
+    assert_null( binson_frozen_node_get_parent( root ) );
+    res = binson_frozen_node_get_child_count( root, &cnt );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 4 );
+
+    /* OBJECT children are sorted */
+    fnode = binson_frozen_node_get_first_child( root );
+    assert_string_equal( binson_frozen_node_get_key( fnode ), "a" );
+    fnode = binson_frozen_node_get_next( fnode );
+    assert_string_equal( binson_frozen_node_get_key( fnode ), "b" );
+    res = binson_frozen_node_get_string( fnode, &str );   assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( str, "str" );
+    res = binson_frozen_node_get_integer( fnode, &ival );   assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+    fnode = binson_frozen_node_get_last_child( root );
+    assert_string_equal( binson_frozen_node_get_key( fnode ), "d" );
+    assert_null( binson_frozen_node_get_next( fnode ) );
+    assert_null( binson_frozen_node_get_first_child( fnode ) );
+    assert_string_equal( binson_frozen_node_get_key( binson_frozen_node_get_prev( fnode ) ), "c" );
+
+    res = binson_frozen_node_get_child_by_key( root, "a", &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_integer( fnode, &ival );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 7 );
+    res = binson_frozen_node_get_child_by_key( root, "aa", &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    assert_null( fnode );
+
+    res = binson_frozen_node_get_child_by_key( root, "c", &farr );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( binson_frozen_node_get_type( farr ), BINSON_TYPE_ARRAY );
+    res = binson_frozen_node_get_child_by_idx( farr, 0, &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_boolean( fnode, &bval );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( bval );
+    assert_null( binson_frozen_node_get_key( fnode ) );
+    res = binson_frozen_node_get_child_by_idx( farr, 1, &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_double( fnode, &dval );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( dval == 1.5 );
+    res = binson_frozen_node_get_child_by_idx( farr, 3, &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    assert_null( fnode );
+
+    res = binson_frozen_node_get_child_by_idx( farr, 2, &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_child_by_key( fnode, "z", &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_bytes( fnode, &bytes, &len );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( len, 3 );
+    assert_memory_equal( bytes, raw, 3 );
+    assert_true( binson_frozen_node_get_parent( binson_frozen_node_get_parent( fnode ) ) == farr );
+
+    res = binson_frozen_free( frozen );   assert_int_equal(res, BINSON_RES_OK );
+}
+
+static void utest_freeze_lazy(void **state) {
+    (void) state;
+
+    binson              *obj;
+    binson_io           *io;
+    binson_parser       *parser;
+    binson_frozen       *frozen;
+    binson_frozen_node  *root, *fnode;
+    binson_res           res;
+    binson_child_num     cnt;
+    int64_t              ival;
+    const char          *str;
+    binson_raw_size      len;
+    uint8_t              buf[sizeof(sb1)];
+
+    memcpy( buf, sb1, sizeof(sb1) );
+
+    res = binson_io_new( &io );                              assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_attach_bytebuf( io, buf, sizeof(buf) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_new( &parser );                      assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_new( &obj );                                assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj, NULL );                          assert_int_equal(res, BINSON_RES_OK );
+
+    /* lazy containers are parsed while freezing */
+    res = binson_deserialize( obj, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_freeze( obj, NULL, &frozen );   assert_int_equal(res, BINSON_RES_OK );
+
+    binson_free( obj );
+    binson_parser_free( parser );
+    binson_io_free( io );
+    memset( buf, 0, sizeof(buf) );
+
+    root = binson_frozen_get_root( frozen );
+    res = binson_frozen_node_get_child_by_key( root, "a", &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_child_count( fnode, &cnt );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 6 );
+
+    res = binson_frozen_node_get_child_by_idx( fnode, 5, &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_integer( fnode, &ival );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( ival == INT64_MAX );
+
+    fnode = binson_frozen_node_get_prev( fnode );
+    res = binson_frozen_node_get_child_by_key( fnode, "q", &fnode );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_frozen_node_get_string_ref( fnode, &str, &len );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( len, 3 );
+    assert_string_equal( str, "qwe" );
+
+    res = binson_frozen_free( frozen );   assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+int utest_run_tests(void) {
+  const struct CMUnitTest tests[] = {
+            cmocka_unit_test(utest_freeze_build),
+            cmocka_unit_test(utest_freeze_lazy),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -7,6 +7,7 @@
 #include "btest.h"
 
 #include "binson/binson.h"
+#include "binson/binson_path.h"
 
 /* composite context used to pass ref via single pointer */
 typedef struct binson_composite
@@ -320,11 +321,1860 @@ static void utest_highlevel_recycle(void **state) {
     //UTEST_HL_RECYCLE( sb4 );
 }
 
+/************************************************************/
+static void utest_highlevel_append(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs;
+    binson_node      *root, *arr;
+
+    UNUSED(res);
+
+    /* out-of-order keys are still sorted, tail ones are appended */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_object_empty( bc->obj, root, "bca", NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( bc->obj, root, "cba", NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( bc->obj, root, "a", NULL );    assert_int_equal(res, BINSON_RES_OK );
+
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, sizeof(s10)-1 );
+    assert_memory_equal( s10, dbuf, rs );
+
+    /* wide array keeps insertion order */
+    res = binson_node_add_array_empty( bc->obj, root, "d", &arr );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<100000; i++)
+    {
+      res = binson_node_add_integer( bc->obj, arr, NULL, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+
+    /* trusted sorted input mode */
+    res = binson_set_sorted_input( bc->obj, true );  assert_int_equal(res, BINSON_RES_OK );
+    UTEST_HL_RECYCLE( s8 );
+    UTEST_HL_RECYCLE( sa6 );
+    UTEST_HL_RECYCLE( sb1 );
+    res = binson_set_sorted_input( bc->obj, false );  assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+static void utest_highlevel_lookup(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_node      *root, *node, *np[300];
+    char             key[16];
+    int64_t          v;
+
+    UNUSED(res);
+
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+
+    /* wide object, keys added out of order */
+    for (int i=0; i<300; i++)
+    {
+      int k = (i * 7) % 300;
+      sprintf( key, "k%d", k );
+      res = binson_node_add_integer( bc->obj, root, key, &np[k], k );  assert_int_equal(res, BINSON_RES_OK );
+    }
+
+    for (int i=0; i<300; i++)
+    {
+      sprintf( key, "k%d", i );
+      res = binson_node_get_child_by_key( bc->obj, root, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+      assert_true( node == np[i] );
+      res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( v, i );
+    }
+
+    res = binson_node_get_child_by_key( bc->obj, root, "missing", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( node == NULL );
+
+    /* removed keys are not found, the rest still are */
+    for (int i=0; i<300; i+=3)
+    {
+      res = binson_node_remove( bc->obj, np[i] );  assert_int_equal(res, BINSON_RES_OK );
+    }
+
+    for (int i=0; i<300; i++)
+    {
+      sprintf( key, "k%d", i );
+      res = binson_node_get_child_by_key( bc->obj, root, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+      assert_true( node == (i % 3 ? np[i] : NULL) );
+    }
+
+    /* equal keys: first added one is found until it's removed */
+    res = binson_node_add_integer( bc->obj, root, "k1", &node, 1000 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, root, "k1", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( node == np[1] );
+    res = binson_node_remove( bc->obj, np[1] );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, root, "k1", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( v, 1000 );
+
+    /* batch lookup: hash indexed OBJECT */
+    {
+      const char  *keys[] = { "a", "k1", "k100", "k101", "k299", "k3", "zz" };
+      const char  *unsorted[] = { "k2", "k1" };
+      binson_node *found[7], *obj_small;
+
+      res = binson_node_get_children_by_keys( bc->obj, root, keys, 7, found );  assert_int_equal(res, BINSON_RES_OK );
+      assert_true( found[0] == NULL );
+      assert_true( found[1] == node );
+      assert_true( found[2] == np[100] );
+      assert_true( found[3] == np[101] );
+      assert_true( found[4] == np[299] );
+      assert_true( found[5] == NULL );   /* removed */
+      assert_true( found[6] == NULL );
+
+      res = binson_node_get_children_by_keys( bc->obj, root, unsorted, 2, found );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+
+      /* merge over short list: {"k1":1, "k100":100, "k299":299, "k3":3}, keys added out of order */
+      res = binson_node_add_object_empty( bc->obj, root, "small", &obj_small );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_integer( bc->obj, obj_small, "k3", &np[3], 3 );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_integer( bc->obj, obj_small, "k100", &np[100], 100 );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_integer( bc->obj, obj_small, "k299", &np[299], 299 );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_integer( bc->obj, obj_small, "k1", &np[1], 1 );  assert_int_equal(res, BINSON_RES_OK );
+
+      res = binson_node_get_children_by_keys( bc->obj, obj_small, keys, 7, found );  assert_int_equal(res, BINSON_RES_OK );
+      assert_true( found[0] == NULL );
+      assert_true( found[1] == np[1] );
+      assert_true( found[2] == np[100] );
+      assert_true( found[3] == NULL );
+      assert_true( found[4] == np[299] );
+      assert_true( found[5] == np[3] );
+      assert_true( found[6] == NULL );
+    }
+}
+
+/************************************************************/
+static void utest_highlevel_index(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_node      *root, *arr, *node;
+    binson_child_num cnt;
+    int64_t          v;
+
+    UNUSED(res);
+
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_array_empty( bc->obj, root, "a", &arr );  assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_node_get_child_count( arr, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 0 );
+    res = binson_node_get_child_by_idx( bc->obj, arr, 0, &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( node == NULL );
+
+    for (int i=0; i<1000; i++)
+    {
+      res = binson_node_add_integer( bc->obj, arr, NULL, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+      if (i == 100)  /* vector is built on first access and then maintained */
+      {
+        res = binson_node_get_child_by_idx( bc->obj, arr, 50, &node );  assert_int_equal(res, BINSON_RES_OK );
+      }
+    }
+
+    res = binson_node_get_child_count( arr, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 1000 );
+    res = binson_node_get_child_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 1 );
+    res = binson_node_get_sibling_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 1 );
+
+    for (int i=0; i<1000; i++)
+    {
+      res = binson_node_get_child_by_idx( bc->obj, arr, i, &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( v, i );
+    }
+
+    res = binson_node_get_child_by_idx( bc->obj, arr, 1000, &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( node == NULL );
+
+    /* removal in the middle and at tail */
+    res = binson_node_get_child_by_idx( bc->obj, arr, 10, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( bc->obj, node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( bc->obj, binson_node_get_last_child( arr ) );  assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_node_get_sibling_count( binson_node_get_first_child( arr ), &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 998 );
+
+    for (int i=0; i<998; i++)
+    {
+      res = binson_node_get_child_by_idx( bc->obj, arr, i, &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( v, i < 10 ? i : i+1 );
+    }
+
+    /* short list */
+    res = binson_node_get_child_by_idx( bc->obj, NULL, 0, &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( node == arr );
+}
+
+/************************************************************/
+static void utest_highlevel_inline(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs, bs;
+    binson_node      *root, *node, *copy;
+    char             *str;
+    uint8_t          *bytes;
+    const char       *keys[] = { "", "k", "abcdefg", "abcdefgh", "abcdefghijklmnopqrstuvwxyz" };
+    const char       *strs[] = { "", "s", "0123456789abcde", "0123456789abcdef", "0123456789abcdefghijklmnopqrstuvwxyz" };
+    const uint8_t    raw[32] = { 1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20 };
+    const size_t     sizes[] = { 0, 1, 16, 17, 32 };
+
+    UNUSED(res);
+
+    /* keys and payloads around inline storage size limits */
+    for (int i=0; i<5; i++)
+    {
+      res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+      root = binson_get_root( bc->obj );
+
+      res = binson_node_add_str( bc->obj, root, keys[i], &node, strs[i] );  assert_int_equal(res, BINSON_RES_OK );
+      assert_string_equal( binson_node_get_key( node ), keys[i] );
+      res = binson_node_get_string( node, &str );  assert_int_equal(res, BINSON_RES_OK );
+      assert_string_equal( str, strs[i] );
+
+      res = binson_node_clone( bc->obj, root, &copy, node, "zz" );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_string( copy, &str );  assert_int_equal(res, BINSON_RES_OK );
+      assert_string_equal( str, strs[i] );
+
+      res = binson_node_add_bytes( bc->obj, root, "zzz", &node, (uint8_t *)raw, sizes[i] );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_bytes( node, &bytes, &bs );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( bs, sizes[i] );
+      assert_memory_equal( bytes, raw, bs );
+
+      res = binson_node_clone( bc->obj, root, &copy, node, "zzzz" );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_bytes( copy, &bytes, &bs );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( bs, sizes[i] );
+      assert_memory_equal( bytes, raw, bs );
+
+      /* same tree back from serialized form */
+      binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+      res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+      memcpy( sbuf, dbuf, rs );
+      binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+      res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+
+      res = binson_node_get_child_by_key( bc->obj, NULL, keys[i], &node );  assert_int_equal(res, BINSON_RES_OK );
+      assert_true( node != NULL );
+      res = binson_node_get_string( node, &str );  assert_int_equal(res, BINSON_RES_OK );
+      assert_string_equal( str, strs[i] );
+
+      res = binson_node_get_child_by_key( bc->obj, NULL, "zzzz", &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_bytes( node, &bytes, &bs );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( bs, sizes[i] );
+      assert_memory_equal( bytes, raw, bs );
+    }
+}
+
+/************************************************************/
+static void utest_highlevel_remove(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs;
+    binson_node      *np[4];
+    const int        order[3][3] = { {2,1,3}, {1,3,2}, {3,2,1} };
+
+    UNUSED(res);
+
+    /* removing nodes in the middle, at head and at tail of children list */
+    for (int round=0; round<3; round++)
+    {
+      res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+      np[0] = binson_get_root( bc->obj );
+      res = binson_node_add_object_empty( bc->obj, np[0], "a", &np[1] );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_str( bc->obj, np[1], "x", NULL, "qwe" );      assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_object_empty( bc->obj, np[0], "b", &np[2] );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_array_empty( bc->obj, np[2], "c", &np[3] );   assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_object_empty( bc->obj, np[3], NULL, NULL );   assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_object_empty( bc->obj, np[0], "d", &np[3] );  assert_int_equal(res, BINSON_RES_OK );
+
+      for (int i=0; i<3; i++)
+      {
+        res = binson_node_remove( bc->obj, np[ order[round][i] ] );  assert_int_equal(res, BINSON_RES_OK );
+      }
+
+      /* removed nodes are reused */
+      res = binson_node_add_object_empty( bc->obj, np[0], "", NULL );   assert_int_equal(res, BINSON_RES_OK );
+
+      binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+      res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( rs, sizeof(s1)-1 );
+      assert_memory_equal( s1, dbuf, rs );
+    }
+
+    /* reset after deserialization gives empty root */
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    memcpy(sbuf, sb1, sizeof(sb1)-1);
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, sizeof(s0)-1 );
+    assert_memory_equal( s0, dbuf, rs );
+}
+
+/************************************************************/
+static void utest_highlevel_raw(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs, len;
+    binson_node      *root, *arr, *node;
+    const char       *ref;
+    char             *str;
+    uint8_t          *bytes;
+    int64_t          ival;
+    double           dval;
+    char             key[16];
+
+    UNUSED(res);
+
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_RAW );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* raw references are written back as is */
+    UTEST_HL_RECYCLE( s0 );
+    UTEST_HL_RECYCLE( s4 );
+    UTEST_HL_RECYCLE( s5 );
+    UTEST_HL_RECYCLE( s6 );
+    UTEST_HL_RECYCLE( s10 );
+    UTEST_HL_RECYCLE( sa6 );
+    UTEST_HL_RECYCLE( sa8 );
+    UTEST_HL_RECYCLE( sb2 );
+    UTEST_HL_RECYCLE( sb1 );
+
+    /* keys and payloads are not copied, numbers are decoded on request */
+    root = binson_get_root( bc->obj );
+    res = binson_node_get_child_by_key( bc->obj, root, "a", &arr );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( arr != NULL );
+
+    res = binson_node_get_child_by_idx( bc->obj, arr, 1, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 13 );
+    res = binson_node_get_child_by_idx( bc->obj, arr, 2, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_double( node, &dval );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( dval == -2.34 );
+    res = binson_node_get_child_by_idx( bc->obj, arr, 5, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( ival == INT64_MAX );
+
+    res = binson_node_get_child_by_idx( bc->obj, arr, 3, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string_ref( node, &ref, &len );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( len, 3 );
+    assert_true( (const uint8_t *)ref > sbuf && (const uint8_t *)ref < sbuf + sizeof(sb1) );
+    assert_memory_equal( ref, "zxc", len );
+
+    res = binson_node_get_child_by_idx( bc->obj, arr, 4, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, node, "e", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_bytes( node, &bytes, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, 3 );
+    assert_true( bytes > sbuf && bytes < sbuf + sizeof(sb1) );
+    assert_memory_equal( bytes, "\x03\x04\x05", rs );
+    res = binson_node_get_key_ref( node, &ref, &len );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( len, 1 );
+    assert_true( (const uint8_t *)ref > sbuf && (const uint8_t *)ref < sbuf + sizeof(sb1) );
+
+    /* zero-terminated copies are made on request */
+    assert_string_equal( binson_node_get_key( node ), "e" );
+    res = binson_node_get_child_by_idx( bc->obj, arr, 3, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &str );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( str, "zxc" );
+    res = binson_node_clone( bc->obj, arr, NULL, node, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_idx( bc->obj, arr, 1, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_clone( bc->obj, arr, &node, node, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 13 );
+
+    /* wide OBJECT gets hash index over raw keys */
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    for (int i=0; i<40; i++)
+    {
+      sprintf( key, "key%d", i );
+      res = binson_node_add_integer( bc->obj, root, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( sbuf, dbuf, rs );
+
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_RAW );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<40; i++)
+    {
+      sprintf( key, "key%d", i );
+      res = binson_node_get_child_by_key( bc->obj, NULL, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+      assert_true( node != NULL );
+      res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( ival, i );
+    }
+    res = binson_node_get_child_by_key( bc->obj, NULL, "key", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( node == NULL );
+
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+static void utest_highlevel_lazy(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs;
+    binson_child_num cnt;
+    binson_node      *root, *arr, *node;
+    int64_t          ival;
+    char             *str;
+    char             key[16];
+
+    UNUSED(res);
+
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* traversal parses lazy containers, so output is the same */
+    UTEST_HL_RECYCLE( s0 );
+    UTEST_HL_RECYCLE( s2 );
+    UTEST_HL_RECYCLE( s8 );
+    UTEST_HL_RECYCLE( s10 );
+    UTEST_HL_RECYCLE( sa5 );
+    UTEST_HL_RECYCLE( sa6 );
+    UTEST_HL_RECYCLE( sb3 );
+    UTEST_HL_RECYCLE( sb1 );
+
+    /* nested containers are parsed on access */
+    root = binson_get_root( bc->obj );
+    res = binson_node_get_child_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 1 );
+    arr = binson_node_get_first_child( root );
+    assert_true( arr != NULL );
+    res = binson_node_get_child_count( arr, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 6 );
+    res = binson_node_get_child_by_idx( bc->obj, arr, 4, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, node, "q", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &str );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( str, "qwe" );
+
+    /* adding to lazy container */
+    UTEST_HL_RECYCLE( sa6 );
+    res = binson_node_get_child_by_key( bc->obj, NULL, "b", &arr );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( bc->obj, arr, NULL, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_count( arr, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 3 );
+
+    /* malformed input is rejected */
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    memcpy( sbuf, "\x40\x14\x01\x61\x41", 5 );  /* key without value */
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_ERROR_PARSE_INVALID_INPUT );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    memcpy( sbuf, "\x40\x10\x01\x44\x41", 5 );  /* non-string key */
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_ERROR_PARSE_INVALID_INPUT );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    memcpy( sbuf, "\x40\x14\x01\x61\x42\x41\x41", 7 );  /* unbalanced */
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_ERROR_PARSE_INVALID_INPUT );
+
+    /* {"o":{"b":1,"a":2}} is sorted on expand, as mode was off at parse time */
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    memcpy( sbuf, "\x40\x14\x01\x6f\x40\x14\x01\x62\x10\x01\x14\x01\x61\x10\x02\x41\x41", 17 );
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_sorted_input( bc->obj, true );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, NULL, "o", &node );  assert_int_equal(res, BINSON_RES_OK );
+    node = binson_node_get_first_child( node );
+    assert_non_null( node );
+    assert_string_equal( binson_node_get_key( node ), "a" );
+    res = binson_set_sorted_input( bc->obj, false );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* few fields of wide message */
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    for (int i=0; i<30; i++)
+    {
+      sprintf( key, "obj%02d", i );
+      res = binson_node_add_object_empty( bc->obj, root, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_integer( bc->obj, node, "val", NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( sbuf, dbuf, rs );
+
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    for (int i=5; i<30; i+=10)
+    {
+      sprintf( key, "obj%02d", i );
+      res = binson_node_get_child_by_key( bc->obj, NULL, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_child_by_key( bc->obj, node, "val", &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( ival, i );
+    }
+
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+static void utest_highlevel_clone_tree(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs;
+    binson_child_num cnt;
+    binson_node      *root, *a, *b, *node;
+    uint8_t          expected[256];
+    size_t           arr_size = sizeof(sb1)-1 - 5;  /* "a" ARRAY without key and root OBJECT */
+    char             key[16];
+
+    UNUSED(res);
+
+    /* {"a":[...], "b":[...]} */
+    memcpy( expected, sb1, sizeof(sb1)-2 );
+    memcpy( expected + sizeof(sb1)-2, "\x14\x01\x62", 3 );
+    memcpy( expected + sizeof(sb1)+1, sb1 + 4, arr_size );
+    expected[ sizeof(sb1)+1 + arr_size ] = 0x41;
+
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    memcpy( sbuf, sb1, sizeof(sb1)-1 );
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_get_child_by_key( bc->obj, root, "a", &a );  assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_node_clone_tree( bc->obj, root, &b, a, "b" );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, sizeof(sb1)-1 + 3 + arr_size );
+    assert_memory_equal( expected, dbuf, rs );
+
+    /* changes of original are not visible in copy and vice versa */
+    res = binson_node_clone_tree( bc->obj, root, &b, a, "c" );  assert_int_equal(res, BINSON_RES_OK );
+    node = binson_node_get_first_child( b );   /* context-free getter copies children too */
+    assert_true( node && binson_node_get_parent( node ) == b );
+    res = binson_node_get_child_by_idx( bc->obj, a, 4, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, node, "z", NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_idx( bc->obj, b, 4, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_count( node, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 3 );
+    res = binson_node_remove( bc->obj, node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_count( b, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 5 );
+    res = binson_node_get_child_count( a, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 6 );
+    res = binson_node_remove( bc->obj, b );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* copy survives removal of original */
+    res = binson_node_remove( bc->obj, a );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_clone_tree( bc->obj, root, &a, binson_node_get_first_child( root ), "a" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( bc->obj, binson_node_get_last_child( root ) );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, sizeof(sb1)-1 );
+    assert_memory_equal( sb1, dbuf, rs );
+
+    /* fan out, copies of copies */
+    for (int i=0; i<1000; i++)
+    {
+      sprintf( key, "x%04d", i );
+      res = binson_node_clone_tree( bc->obj, root, &b, i? b : a, key );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_node_get_child_by_idx( bc->obj, b, 3, &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( binson_node_get_type( node ), BINSON_TYPE_STRING );
+
+    /* subtree can't be copied into itself */
+    res = binson_node_get_child_by_idx( bc->obj, a, 4, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_clone_tree( bc->obj, node, NULL, a, "y" );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG_COMB );
+}
+
+/************************************************************/
+static void utest_highlevel_serialize_cache(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs, rs_ref;
+    binson_node      *root, *a, *b, *x, *node;
+    uint8_t          ref[1024];
+    char             key[16];
+
+    UNUSED(res);
+
+/* serialize with cache and compare with output encoded from scratch */
+#define UTEST_HL_CACHE_CHECK() \
+    res = binson_set_serialize_cache( bc->obj, false );  assert_int_equal(res, BINSON_RES_OK ); \
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );    \
+    res = binson_serialize( bc->obj, bc->writer, &rs_ref );  assert_int_equal(res, BINSON_RES_OK ); \
+    memcpy( ref, dbuf, rs_ref ); \
+    res = binson_set_serialize_cache( bc->obj, true );  assert_int_equal(res, BINSON_RES_OK ); \
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );    \
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK ); \
+    assert_int_equal( rs, rs_ref ); \
+    assert_memory_equal( ref, dbuf, rs );
+
+    /* {"a":{"k00":0, ...}, "b":[{"x":[...]}, ...]}. Stays well below output buffer size */
+    res = binson_reset( bc->obj );  assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_object_empty( bc->obj, root, "a", &a );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_array_empty( bc->obj, root, "b", &b );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<10; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( bc->obj, a, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_object_empty( bc->obj, b, NULL, &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_array_empty( bc->obj, node, "x", &x );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_str( bc->obj, x, NULL, NULL, "0123456789abcdef0123456789abcdef0123456789abcdef" );
+      assert_int_equal(res, BINSON_RES_OK );
+    }
+
+    UTEST_HL_CACHE_CHECK();
+    UTEST_HL_CACHE_CHECK();   /* cached root is written at once */
+
+    /* changes drop cached copies on the way up */
+    res = binson_node_add_integer( bc->obj, x, NULL, NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+    UTEST_HL_CACHE_CHECK();
+    res = binson_node_get_child_by_key( bc->obj, a, "k07", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( bc->obj, node );  assert_int_equal(res, BINSON_RES_OK );
+    UTEST_HL_CACHE_CHECK();
+    res = binson_node_get_child_by_idx( bc->obj, b, 3, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_clone_tree( bc->obj, root, NULL, node, "c" );  assert_int_equal(res, BINSON_RES_OK );
+    UTEST_HL_CACHE_CHECK();
+
+    /* {"":{}} deserialized into nested OBJECT */
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    memcpy( sbuf, s1, sizeof(s1)-1 );
+    res = binson_node_get_child_by_idx( bc->obj, b, 0, &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( bc->obj, bc->parser, node, "y", false );  assert_int_equal(res, BINSON_RES_OK );
+    UTEST_HL_CACHE_CHECK();
+
+    res = binson_set_serialize_cache( bc->obj, false );  assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+/* nodes visited by binson_traverse(), reference for binson_iter */
+typedef struct utest_hl_visit
+{
+    binson_node  *node[64];
+    bool          closing[64];
+    int           cnt;
+
+} utest_hl_visit;
+
+static binson_res utest_hl_cb_collect( binson *obj, binson_node *node, binson_traverse_cb_status *status, void* param )
+{
+    utest_hl_visit *v = (utest_hl_visit *)param;
+
+    UNUSED(obj);
+
+    v->node[v->cnt]    = node;
+    v->closing[v->cnt] = binson_traverse_get_dir( status ) == BINSON_TRAVERSE_DIR_UP && !binson_node_is_leaf_type( node );
+    v->cnt++;
+
+    return BINSON_RES_OK;
+}
+
+static void utest_highlevel_iter(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs;
+    binson_node      *node;
+    binson_iter      it;
+    utest_hl_visit   ref;
+    int              cnt;
+    const uint8_t    post_types[] = { BINSON_TYPE_BOOLEAN, BINSON_TYPE_INTEGER, BINSON_TYPE_DOUBLE, BINSON_TYPE_STRING,
+                                      BINSON_TYPE_BOOLEAN, BINSON_TYPE_BYTES, BINSON_TYPE_STRING, BINSON_TYPE_OBJECT,
+                                      BINSON_TYPE_INTEGER, BINSON_TYPE_ARRAY, BINSON_TYPE_OBJECT };
+
+    UNUSED(res);
+
+/* iterator visits same nodes in same order as traversal */
+#define UTEST_HL_ITER_CHECK( sample, method ) \
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 ); \
+    memcpy( sbuf, sample, sizeof(sample)-1 ); \
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK ); \
+    ref.cnt = 0; \
+    binson_traverse( bc->obj, binson_get_root( bc->obj ), method, BINSON_DEPTH_LIMIT, utest_hl_cb_collect, &ref ); \
+    res = binson_iter_init( &it, bc->obj, binson_get_root( bc->obj ), method, BINSON_DEPTH_LIMIT );  assert_int_equal(res, BINSON_RES_OK ); \
+    for (cnt = 0; (res = binson_iter_next( &it, &node )) == BINSON_RES_OK; cnt++) \
+    { \
+      assert_true( cnt < ref.cnt ); \
+      assert_ptr_equal( node, ref.node[cnt] ); \
+      if (method == BINSON_TRAVERSE_BOTHORDER) \
+        assert_int_equal( binson_iter_is_closing( &it ), ref.closing[cnt] ); \
+    } \
+    assert_int_equal( res, BINSON_RES_TRAVERSAL_DONE ); \
+    assert_int_equal( cnt, ref.cnt ); \
+    assert_true( node == NULL );
+
+    UTEST_HL_ITER_CHECK( s0, BINSON_TRAVERSE_PREORDER );
+    UTEST_HL_ITER_CHECK( s8, BINSON_TRAVERSE_PREORDER );
+    UTEST_HL_ITER_CHECK( sa6, BINSON_TRAVERSE_PREORDER );
+    UTEST_HL_ITER_CHECK( s8, BINSON_TRAVERSE_POSTORDER );
+
+    /* binson_traverse() loses siblings in postorder, so sb1 is checked by hand */
+    UTEST_HL_ITER_CHECK( sb1, BINSON_TRAVERSE_PREORDER );
+    res = binson_iter_init( &it, bc->obj, binson_get_root( bc->obj ), BINSON_TRAVERSE_POSTORDER, BINSON_DEPTH_LIMIT );
+    assert_int_equal(res, BINSON_RES_OK );
+    for (cnt = 0; (res = binson_iter_next( &it, &node )) == BINSON_RES_OK; cnt++)
+    {
+      assert_true( cnt < (int)sizeof(post_types) );
+      assert_int_equal( binson_node_get_type( node ), post_types[cnt] );
+    }
+    assert_int_equal( cnt, sizeof(post_types) );
+
+    UTEST_HL_ITER_CHECK( s0, BINSON_TRAVERSE_BOTHORDER );
+    UTEST_HL_ITER_CHECK( s8, BINSON_TRAVERSE_BOTHORDER );
+    UTEST_HL_ITER_CHECK( sa6, BINSON_TRAVERSE_BOTHORDER );
+    UTEST_HL_ITER_CHECK( sb1, BINSON_TRAVERSE_BOTHORDER );
+
+    /* lazy containers are parsed on the way */
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    UTEST_HL_ITER_CHECK( sb1, BINSON_TRAVERSE_BOTHORDER );
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* early exit at first INTEGER: {"a":[true,13,...]} */
+    res = binson_iter_init( &it, bc->obj, binson_get_root( bc->obj ), BINSON_TRAVERSE_PREORDER, BINSON_DEPTH_LIMIT );
+    assert_int_equal(res, BINSON_RES_OK );
+    while ((res = binson_iter_next( &it, &node )) == BINSON_RES_OK && binson_node_get_type( node ) != BINSON_TYPE_INTEGER) ;
+    assert_int_equal( res, BINSON_RES_OK );
+    assert_int_equal( binson_iter_get_depth( &it ), 2 );
+
+    /* skipped container is closed at once: {"a":[{},{}], "b":[[],[]]} */
+    UTEST_HL_ITER_CHECK( sa6, BINSON_TRAVERSE_BOTHORDER );
+    res = binson_iter_init( &it, bc->obj, binson_get_root( bc->obj ), BINSON_TRAVERSE_BOTHORDER, BINSON_DEPTH_LIMIT );
+    assert_int_equal(res, BINSON_RES_OK );
+    for (cnt = 0; (res = binson_iter_next( &it, &node )) == BINSON_RES_OK; cnt++)
+    {
+      if (binson_iter_get_depth( &it ) == 1 && !binson_iter_is_closing( &it ))
+      {
+        res = binson_iter_skip_children( &it );  assert_int_equal(res, BINSON_RES_OK );
+      }
+    }
+    assert_int_equal( cnt, 6 );
+
+    /* whole tree removed node by node in postorder. Empty siblings are not lost, unlike binson_traverse() */
+    res = binson_iter_init( &it, bc->obj, binson_get_root( bc->obj ), BINSON_TRAVERSE_POSTORDER, BINSON_DEPTH_LIMIT );
+    assert_int_equal(res, BINSON_RES_OK );
+    for (cnt = 0; (res = binson_iter_next( &it, &node )) == BINSON_RES_OK; cnt++)
+    {
+      if (node != binson_get_root( bc->obj ))
+      {
+        res = binson_node_remove( bc->obj, node );  assert_int_equal(res, BINSON_RES_OK );
+      }
+    }
+    assert_int_equal( res, BINSON_RES_TRAVERSAL_DONE );
+    assert_int_equal( cnt, 7 );
+
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, sizeof(s0)-1 );
+    assert_memory_equal( s0, dbuf, rs );
+}
+
+/************************************************************/
+static void utest_highlevel_hash(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs;
+    binson           *obj2;
+    binson_node      *root, *root2, *a, *b, *arr, *node;
+    uint64_t         h1, h2, h3;
+    bool             eq;
+    char             key[16];
+
+    UNUSED(res);
+
+    res = binson_new( &obj2 );         assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj2, NULL );   assert_int_equal(res, BINSON_RES_OK );
+
+    /* {"a":{"k00":0, ... "k11":11}, "b":[1.5, "str", true]} built in different key order */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    root2 = binson_get_root( obj2 );
+    res = binson_node_add_object_empty( bc->obj, root, "a", &a );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_array_empty( bc->obj, root, "b", &arr );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_array_empty( obj2, root2, "b", &b );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( obj2, root2, "a", &node );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<12; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( bc->obj, a, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+      sprintf( key, "k%02d", 11-i );
+      res = binson_node_add_integer( obj2, node, key, NULL, 11-i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_node_add_double( bc->obj, arr, NULL, NULL, 1.5 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( bc->obj, arr, NULL, NULL, "str" );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_boolean( bc->obj, arr, NULL, NULL, true );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_double( obj2, b, NULL, NULL, 1.5 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj2, b, NULL, NULL, "str" );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_boolean( obj2, b, NULL, NULL, true );   assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_node_hash( bc->obj, NULL, &h1 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( obj2, NULL, &h2 );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( h1 == h2 );
+    res = binson_node_equal( root, root2, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( eq );
+
+    /* own key doesn't matter, ARRAY order does */
+    res = binson_node_clone_tree( bc->obj, root, NULL, arr, "c" );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, root, "c", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( arr, node, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( eq );
+    res = binson_node_hash( bc->obj, node, &h3 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( obj2, b, &h2 );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( h3 == h2 );
+    res = binson_node_remove( bc->obj, binson_node_get_first_child( node ) );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_double( bc->obj, node, NULL, NULL, 1.5 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( arr, node, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_false( eq );
+    res = binson_node_hash( bc->obj, node, &h3 );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( h3 != h2 );
+    res = binson_node_remove( bc->obj, node );   assert_int_equal(res, BINSON_RES_OK );
+
+    /* cached hashes are dropped on change */
+    res = binson_set_hash_cache( bc->obj, true );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_hash_cache( obj2, true );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( bc->obj, NULL, &h1 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( obj2, NULL, &h2 );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( h1 == h2 );
+    res = binson_node_get_child_by_key( obj2, NULL, "a", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, node, "k05", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, NULL, "a", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( obj2, node, "k05", NULL, 500 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( obj2, NULL, &h2 );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( h1 != h2 );
+    res = binson_node_hash( obj2, node, &h2 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( bc->obj, a, &h1 );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( h1 != h2 );
+    res = binson_node_equal( a, node, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_false( eq );
+
+    /* lazy tree equals its source */
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( sbuf, dbuf, rs );
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_deserialize( obj2, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_set_mode( bc->parser, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( obj2 ), root, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( eq );
+    res = binson_node_hash( bc->obj, NULL, &h1 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( obj2, NULL, &h2 );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( h1 == h2 );
+
+    res = binson_set_hash_cache( bc->obj, false );   assert_int_equal(res, BINSON_RES_OK );
+    binson_free( obj2 );
+}
+
+/************************************************************/
+static binson_raw_size utest_hl_diff( binson *from, binson *to, binson_writer *writer )
+{
+    binson_io        *io = binson_writer_get_io( writer );
+    binson_raw_size  rs = 0;
+    binson_res       res;
+
+    binson_io_seek( io, 0 );
+    binson_io_reset_counters( io );
+    res = binson_diff( from, to, writer );   assert_int_equal(res, BINSON_RES_OK );
+    binson_io_get_write_counter( io, &rs );
+    memcpy( sbuf, dbuf, rs );
+
+    return rs;
+}
+
+/************************************************************/
+static void utest_highlevel_diff(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs, full;
+    binson           *obj2;
+    binson_node      *root, *root2, *node, *arr;
+    bool             eq;
+    char             key[16];
+
+    UNUSED(res);
+
+    res = binson_new( &obj2 );         assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj2, NULL );   assert_int_equal(res, BINSON_RES_OK );
+
+    /* {"a":{"k00":0, ... "k39":39}, "b":[1,2,3], "c":"x", "d":{"e":{"f":1}}} */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_object_empty( bc->obj, root, "a", &node );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<40; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( bc->obj, node, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_node_add_array_empty( bc->obj, root, "b", &arr );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=1; i<=3; i++)
+    {
+      res = binson_node_add_integer( bc->obj, arr, NULL, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_node_add_str( bc->obj, root, "c", NULL, "x" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( bc->obj, root, "d", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( bc->obj, node, "e", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, node, "f", NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &full );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( sbuf, dbuf, full );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_deserialize( obj2, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    root2 = binson_get_root( obj2 );
+
+    /* equal trees give empty patch {"ops":[]} */
+    rs = utest_hl_diff( bc->obj, obj2, bc->writer );
+    assert_int_equal( rs, 9 );
+
+    /* every kind of change */
+    res = binson_node_get_child_by_key( obj2, NULL, "c", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_boolean( obj2, root2, "c2", NULL, true );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, NULL, "a", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, node, "k05", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, NULL, "a", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( obj2, node, "k05", NULL, 500 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, NULL, "b", &arr );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_idx( obj2, arr, 1, &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj2, arr, NULL, NULL, "two" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( obj2, arr, NULL, NULL, 4 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, NULL, "d", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, node, "e", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, node, "f", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, NULL, "d", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, node, "e", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_array_empty( obj2, node, "f", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_double( obj2, node, NULL, NULL, 2.5 );  assert_int_equal(res, BINSON_RES_OK );
+
+    rs = utest_hl_diff( bc->obj, obj2, bc->writer );
+    assert_true( rs < full );
+
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_patch_apply( bc->obj, bc->parser );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( bc->obj ), root2, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( eq );
+    res = binson_node_get_child_by_key( bc->obj, NULL, "b", &arr );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_idx( bc->obj, arr, 3, &node );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( binson_node_get_type( node ), BINSON_TYPE_INTEGER );
+
+    /* same patch doesn't match patched tree anymore, neither is patch of wrong layout accepted */
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_patch_apply( bc->obj, bc->parser );   assert_int_equal(res, BINSON_RES_ERROR_PARSE_INVALID_INPUT );
+    memcpy( sbuf, s0, sizeof(s0)-1 );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_patch_apply( bc->obj, bc->parser );   assert_int_equal(res, BINSON_RES_ERROR_PARSE_INVALID_INPUT );
+
+    /* shrinking: ARRAY tail and whole subtree go, hashes are used to skip unchanged parts */
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( obj2, bc->writer, &full );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( sbuf, dbuf, full );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_deserialize( bc->obj, bc->parser, NULL, NULL, false );    assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_hash_cache( bc->obj, true );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_hash_cache( obj2, true );   assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_node_get_child_by_key( obj2, NULL, "b", &arr );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, binson_node_get_last_child( arr ) );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, binson_node_get_last_child( arr ) );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj2, NULL, "d", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, node );   assert_int_equal(res, BINSON_RES_OK );
+
+    rs = utest_hl_diff( bc->obj, obj2, bc->writer );
+    assert_true( rs < full );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_patch_apply( bc->obj, bc->parser );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( bc->obj ), root2, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( eq );
+
+    /* container turned to leaf */
+    res = binson_node_get_child_by_key( obj2, NULL, "a", &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( obj2, node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj2, root2, "a", NULL, "flat" );  assert_int_equal(res, BINSON_RES_OK );
+
+    rs = utest_hl_diff( bc->obj, obj2, bc->writer );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_patch_apply( bc->obj, bc->parser );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( bc->obj ), root2, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( eq );
+
+    /* path deeper than initial size of its stack, siblings follow the deep change */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( obj2 );   assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<2; i++)
+    {
+      binson *o = i? obj2 : bc->obj;
+
+      node = binson_get_root( o );
+      res = binson_node_add_integer( o, node, "b", NULL, i+1 );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_integer( o, node, "c", NULL, i+1 );  assert_int_equal(res, BINSON_RES_OK );
+      for (int j=0; j<21; j++)
+      {
+        res = binson_node_add_object_empty( o, node, "a", &node );  assert_int_equal(res, BINSON_RES_OK );
+      }
+      res = binson_node_add_integer( o, node, "v", NULL, i+1 );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    root2 = binson_get_root( obj2 );
+
+    rs = utest_hl_diff( bc->obj, obj2, bc->writer );
+    binson_io_seek( binson_parser_get_io( bc->parser ), 0 );
+    res = binson_patch_apply( bc->obj, bc->parser );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( bc->obj ), root2, &eq );   assert_int_equal(res, BINSON_RES_OK );
+    assert_true( eq );
+
+    res = binson_set_hash_cache( bc->obj, false );   assert_int_equal(res, BINSON_RES_OK );
+    binson_free( obj2 );
+}
+
+/************************************************************/
+static void utest_highlevel_merge(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson           *obj2;
+    binson_node      *root, *root2, *node, *c, *prev;
+    binson_child_num cnt;
+    int64_t          ival;
+    char             *str;
+    char             key[16];
+    char             big[2001];
+    binson_limits    lim = { 0, 100, 0 };
+
+    UNUSED(res);
+
+    res = binson_new( &obj2 );         assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj2, NULL );   assert_int_equal(res, BINSON_RES_OK );
+
+    /* base {"a":1, "c":{"x":1, "y":2}, "e":[1], "k00":0, "k02":2, ... "k38":38} */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_integer( bc->obj, root, "a", NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( bc->obj, root, "c", &c );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, c, "x", NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, c, "y", NULL, 2 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_array_empty( bc->obj, root, "e", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, node, NULL, NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* overlay {"b":2, "c":{"y":3, "z":4}, "e":"s", "f":{"g":1}, "k01":1, "k03":3, ... "k39":39} */
+    root2 = binson_get_root( obj2 );
+    res = binson_node_add_integer( obj2, root2, "b", NULL, 2 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( obj2, root2, "c", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( obj2, node, "y", NULL, 3 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( obj2, node, "z", NULL, 4 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj2, root2, "e", NULL, "s" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( obj2, root2, "f", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( obj2, node, "g", NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+
+    for (int i=0; i<40; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( (i%2)? obj2 : bc->obj, (i%2)? root2 : root, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+
+    /* conflicting leaves are not touched */
+    res = binson_node_merge( bc->obj, NULL, obj2, root2, BINSON_MERGE_ERROR );  assert_int_equal(res, BINSON_RES_ERROR_TREE_KEY_CONFLICT );
+    res = binson_node_merge( bc->obj, NULL, obj2, root2, BINSON_MERGE_KEEP );  assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_node_get_child_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 45 );
+    res = binson_node_get_child_by_key( bc->obj, c, "y", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 2 );
+    res = binson_node_get_child_by_key( bc->obj, c, "z", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_non_null( node );
+    res = binson_node_get_child_by_key( bc->obj, NULL, "e", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( binson_node_get_type( node ), BINSON_TYPE_ARRAY );
+
+    /* children stay sorted and indexed */
+    for (prev = NULL, node = binson_node_get_first_child( root ); node; prev = node, node = binson_node_get_next( node ))
+      if (prev)
+        assert_true( strcmp( binson_node_get_key( prev ), binson_node_get_key( node ) ) < 0 );
+    for (int i=0; i<40; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_get_child_by_key( bc->obj, NULL, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( ival, i );
+    }
+    res = binson_node_get_child_by_idx( bc->obj, NULL, 44, &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( binson_node_get_key( node ), "k39" );
+
+    /* overwrite */
+    res = binson_node_merge( bc->obj, NULL, obj2, root2, BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, c, "y", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 3 );
+    res = binson_node_get_child_by_key( bc->obj, c, "x", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_non_null( node );
+    res = binson_node_get_child_by_key( bc->obj, NULL, "e", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &str );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( str, "s" );
+    res = binson_node_get_child_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 45 );
+
+    /* wrong arguments */
+    res = binson_node_merge( bc->obj, c, obj2, node, BINSON_MERGE_KEEP );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG_COMB );
+    res = binson_node_merge( bc->obj, c, bc->obj, root, BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG_COMB );
+    res = binson_node_merge( bc->obj, NULL, bc->obj, c, BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG_COMB );
+    res = binson_node_get_child_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 45 );
+
+    /* failed copy keeps overwritten child */
+    memset( big, 'x', sizeof(big) - 1 );
+    big[ sizeof(big) - 1 ] = 0;
+    res = binson_reset( obj2 );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj2, binson_get_root( obj2 ), "a", NULL, big );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_limits( bc->obj, &lim );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_merge( bc->obj, NULL, obj2, binson_get_root( obj2 ), BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    res = binson_set_limits( bc->obj, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, NULL, "a", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 1 );
+    res = binson_node_get_child_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 45 );
+
+    binson_free( obj2 );
+}
+
+/************************************************************/
+static void utest_highlevel_bulk(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_raw_size  rs, rs2;
+    binson_node      *root, *obj_node, *node, *prev;
+    binson_child_num cnt;
+    int64_t          v;
+    uint64_t         hash;
+    char             key[16];
+    uint8_t          ref[512];
+
+    UNUSED(res);
+
+    /* reference: 64 keys added in order, "k00":0 ... "k63":63 */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    for (int i=0; i<64; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( bc->obj, root, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( rs <= sizeof(ref) );
+    memcpy( ref, dbuf, rs );
+
+    /* same keys in scrambled order, with 10 duplicates carrying wrong values */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_bulk_begin( bc->obj, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<10; i++)
+    {
+      sprintf( key, "k%02d", i*7 );
+      res = binson_node_add_integer( bc->obj, root, key, NULL, -1 );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    for (int i=0; i<64; i++)
+    {
+      sprintf( key, "k%02d", (i*37) % 64 );
+      res = binson_node_add_integer( bc->obj, root, key, NULL, (i*37) % 64 );  assert_int_equal(res, BINSON_RES_OK );
+    }
+
+    /* lookups work before commit */
+    res = binson_node_get_child_by_key( bc->obj, NULL, "k44", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( v, 44 );
+
+    res = binson_node_bulk_commit( bc->obj, NULL, BINSON_MERGE_ERROR );  assert_int_equal(res, BINSON_RES_ERROR_TREE_KEY_CONFLICT );
+    res = binson_node_bulk_commit( bc->obj, NULL, BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_commit( bc->obj, NULL, BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+
+    res = binson_node_get_child_count( root, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 64 );
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs2 );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, rs2 );
+    assert_memory_equal( ref, dbuf, rs );
+
+    for (int i=0; i<64; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_get_child_by_key( bc->obj, NULL, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( v, i );
+    }
+
+    /* nested OBJECT, first added duplicate wins */
+    res = binson_node_add_object_empty( bc->obj, root, "z", &obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_begin( bc->obj, obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, obj_node, "b", NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, obj_node, "a", NULL, 2 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, obj_node, "b", NULL, 3 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, obj_node, "c", NULL, 4 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_commit( bc->obj, obj_node, BINSON_MERGE_KEEP );  assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_node_get_child_count( obj_node, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 3 );
+    for (prev = NULL, node = binson_node_get_first_child( obj_node ); node; prev = node, node = binson_node_get_next( node ))
+      if (prev)
+        assert_true( strcmp( binson_node_get_key( prev ), binson_node_get_key( node ) ) < 0 );
+    res = binson_node_get_child_by_key( bc->obj, obj_node, "b", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( v, 1 );
+
+    /* clone of unfinished build is committed on its own */
+    res = binson_node_add_object_empty( bc->obj, root, "y", &obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_begin( bc->obj, obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, obj_node, "b", NULL, 1 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, obj_node, "a", NULL, 2 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_integer( bc->obj, obj_node, "b", NULL, 3 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_clone_tree( bc->obj, root, &node, obj_node, "x" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_commit( bc->obj, obj_node, BINSON_MERGE_KEEP );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_commit( bc->obj, node, BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_count( node, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 2 );
+    res = binson_node_get_child_by_key( bc->obj, node, "b", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( v, 3 );
+    res = binson_node_get_child_by_key( bc->obj, obj_node, "b", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &v );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( v, 1 );
+
+    /* ARRAY has no key order */
+    res = binson_node_add_array_empty( bc->obj, root, "zz", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_begin( bc->obj, node );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+
+    /* unsorted children are neither written nor hashed, encoding cached before commit is dropped */
+    res = binson_set_serialize_cache( bc->obj, true );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_object_empty( bc->obj, root, "o", &obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=0; i<30; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( bc->obj, obj_node, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( rs <= sizeof(ref) );
+    memcpy( ref, dbuf, rs );
+
+    res = binson_node_remove( bc->obj, obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_object_empty( bc->obj, root, "o", &obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_bulk_begin( bc->obj, obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    for (int i=29; i>=0; i--)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( bc->obj, obj_node, key, NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs2 );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG_COMB );
+    res = binson_node_hash( bc->obj, NULL, &hash );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG_COMB );
+    res = binson_node_bulk_commit( bc->obj, obj_node, BINSON_MERGE_ERROR );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs2 );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, rs2 );
+    assert_memory_equal( ref, dbuf, rs );
+    res = binson_set_serialize_cache( bc->obj, false );  assert_int_equal(res, BINSON_RES_OK );
+}
+
+/* malloc'ed copy of string, strdup() is not C99 */
+static char *utest_strdup(const char *str) {
+    char *dup = (char *)malloc( strlen(str) + 1 );
+    strcpy( dup, str );
+    return dup;
+}
+
+/************************************************************/
+static void utest_highlevel_take(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_node      *root, *obj_node, *node, *copy;
+    binson_raw_size  rs;
+    uint8_t          *blob, *bytes;
+    char             *str, *out;
+    size_t           size;
+
+    UNUSED(res);
+
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_object_empty( bc->obj, root, "o", &obj_node );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* adopted payloads are not copied */
+    blob = (uint8_t *)malloc( 300 );
+    memset( blob, 0x5a, 300 );
+    res = binson_node_add_bytes_take( bc->obj, obj_node, "b", &node, blob, 300 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_bytes( node, &bytes, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( bytes == blob );
+    assert_int_equal( rs, 300 );
+
+    str = utest_strdup( "long enough string to be kept outside of node" );
+    res = binson_node_add_str_take( bc->obj, obj_node, "s", &node, str );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &out );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( out == str );
+
+    res = binson_node_add_str_take( bc->obj, obj_node, "t", &node, utest_strdup( "short" ) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &out );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( out, "short" );
+
+    /* clone keeps own copy when original goes */
+    res = binson_node_clone_tree( bc->obj, root, &copy, obj_node, "p" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, copy, "s", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( bc->obj, obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &out );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( out, "long enough string to be kept outside of node" );
+
+    /* adopted buffer is handed back as is, other ones are copied */
+    res = binson_node_add_bytes_take( bc->obj, root, "b", &node, (blob = (uint8_t *)malloc( 300 )), 300 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_take_bytes( bc->obj, node, &bytes, &size );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( bytes == blob );
+    assert_int_equal( size, 300 );
+    free( bytes );
+    res = binson_node_get_bytes( node, &bytes, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, 0 );
+
+    res = binson_node_get_child_by_key( bc->obj, copy, "s", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_take_string( bc->obj, node, &out );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( out, "long enough string to be kept outside of node" );
+    free( out );
+    res = binson_node_get_string( node, &out );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( out, "" );
+    res = binson_node_take_bytes( bc->obj, node, &bytes, &size );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+
+    /* {"b":0x, "p":{"b":0x5a5a..., "s":"", "t":"short"}} */
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, 2 + 5 + (3+2) + (3+3+300) + 5 + (3+7) );
+
+    /* adopted payloads left in tree are freed with it */
+    res = binson_node_add_str_take( bc->obj, copy, "u", NULL, utest_strdup( "one more long string kept outside of node" ) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+static void utest_highlevel_ref(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_node      *root, *node;
+    binson_raw_size  rs, ref_size;
+    uint8_t          blob[200], ref[512];
+    uint8_t          *bytes;
+    char             *out;
+    const char       *str = "string long enough to be referenced";
+    size_t           size;
+
+    UNUSED(res);
+    memset( blob, 0xa5, sizeof(blob) );
+
+    /* reference tree with copied payloads */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_bytes( bc->obj, root, "b", NULL, blob, sizeof(blob) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( bc->obj, root, "s", NULL, str );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( bc->obj, root, "t", NULL, "tiny" );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &ref_size );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( ref, dbuf, ref_size );
+
+    /* same tree with borrowed payloads */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_add_bytes_ref( bc->obj, root, "b", &node, blob, sizeof(blob) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_bytes( node, &bytes, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( bytes == blob );
+    res = binson_node_add_str_ref( bc->obj, root, "s", &node, str );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &out );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( out == str );
+    res = binson_node_add_str_ref( bc->obj, root, "t", NULL, "tiny" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_bytes_ref( bc->obj, root, "x", NULL, NULL, 1 );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, ref_size );
+    assert_memory_equal( ref, dbuf, rs );
+
+    /* borrowed memory is copied on take and never freed by tree */
+    res = binson_node_take_string( bc->obj, node, &out );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( out != str );
+    assert_string_equal( out, str );
+    free( out );
+    res = binson_node_get_child_by_key( bc->obj, root, "b", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_take_bytes( bc->obj, node, &bytes, &size );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( bytes != blob );
+    assert_int_equal( size, sizeof(blob) );
+    free( bytes );
+    res = binson_node_remove( bc->obj, node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_bytes_ref( bc->obj, root, "b", NULL, blob, sizeof(blob) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+static void utest_highlevel_compact(void **state) {
+    UNUSED(state);
+    binson_composite *bc = *state;
+    binson_res       res;
+    binson_node      *root, *old_root, *obj_node, *node, *prev;
+    binson_raw_size  rs, ref_size;
+    binson_iter      it;
+    binson_limits    lim;
+    uint8_t          blob[100], ref[512];
+    char             key[16];
+    int              i;
+
+    UNUSED(res);
+    memset( blob, 0x3c, sizeof(blob) );
+
+    /* tree scattered by removals and clones */
+    res = binson_reset( bc->obj );   assert_int_equal(res, BINSON_RES_OK );
+    old_root = binson_get_root( bc->obj );
+    for (i = 0; i < 40; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( bc->obj, old_root, key, &node, i );  assert_int_equal(res, BINSON_RES_OK );
+      if (i % 2 == 0)
+      {
+        res = binson_node_remove( bc->obj, node );  assert_int_equal(res, BINSON_RES_OK );
+      }
+    }
+    res = binson_node_add_object_empty( bc->obj, old_root, "nested", &obj_node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( bc->obj, obj_node, "long_key_name", NULL, "long string payload" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_bytes_ref( bc->obj, obj_node, "b", NULL, blob, sizeof(blob) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_clone_tree( bc->obj, old_root, NULL, obj_node, "clone" );  assert_int_equal(res, BINSON_RES_OK );
+
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &ref_size );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( ref, dbuf, ref_size );
+
+    res = binson_compact( bc->obj );  assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    assert_true( root != old_root );
+
+    /* nodes follow each other in depth-first order */
+    res = binson_iter_init( &it, bc->obj, root, BINSON_TRAVERSE_PREORDER, BINSON_DEPTH_LIMIT );  assert_int_equal(res, BINSON_RES_OK );
+    for (prev = NULL; binson_iter_next( &it, &node ) == BINSON_RES_OK; prev = node)
+      assert_true( !prev || (uint8_t *)prev < (uint8_t *)node );
+
+    /* borrowed payload is not referred anymore */
+    memset( blob, 0, sizeof(blob) );
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( rs, ref_size );
+    assert_memory_equal( ref, dbuf, rs );
+
+    res = binson_node_get_child_by_key( bc->obj, root, "k39", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_non_null( node );
+    res = binson_node_get_child_by_key( bc->obj, root, "k38", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_null( node );
+    res = binson_node_add_integer( bc->obj, root, "k38", NULL, 38 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( bc->obj, root, "k38", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_non_null( node );
+
+    /* failure at any point leaves tree in old storage */
+    binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+    res = binson_serialize( bc->obj, bc->writer, &ref_size );  assert_int_equal(res, BINSON_RES_OK );
+    memcpy( ref, dbuf, ref_size );
+    memset( &lim, 0, sizeof(lim) );
+    for (lim.max_bytes = 64; ; lim.max_bytes += 8)
+    {
+      res = binson_set_limits( bc->obj, &lim );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_compact( bc->obj );
+      if (res == BINSON_RES_OK) break;
+      assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+      assert_true( binson_get_root( bc->obj ) == root );
+      res = binson_node_get_child_by_key( bc->obj, root, "k38", &node );  assert_int_equal(res, BINSON_RES_OK );
+      assert_non_null( node );
+      binson_io_seek( binson_writer_get_io( bc->writer ), 0 );
+      res = binson_serialize( bc->obj, bc->writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+      assert_int_equal( rs, ref_size );
+      assert_memory_equal( ref, dbuf, rs );
+    }
+    res = binson_set_limits( bc->obj, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    root = binson_get_root( bc->obj );
+    res = binson_node_get_child_by_key( bc->obj, root, "k38", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_non_null( node );
+}
+
+/* allocator counting calls and live blocks */
+typedef struct utest_alloc_stat
+{
+    int  allocs;
+    int  live;
+
+} utest_alloc_stat;
+
+static void *utest_alloc(void *param, size_t size) {
+    utest_alloc_stat *st = (utest_alloc_stat *)param;
+    st->allocs++;
+    st->live++;
+    return malloc( size );
+}
+
+static void *utest_realloc(void *param, void *ptr, size_t size) {
+    utest_alloc_stat *st = (utest_alloc_stat *)param;
+    st->allocs++;
+    if (!ptr)
+      st->live++;
+    return realloc( ptr, size );
+}
+
+static void utest_free(void *param, void *ptr) {
+    utest_alloc_stat *st = (utest_alloc_stat *)param;
+    if (ptr)
+      st->live--;
+    free( ptr );
+}
+
+/************************************************************/
+static void utest_highlevel_allocator(void **state) {
+    UNUSED(state);
+    utest_alloc_stat  st = { 0, 0 };
+    binson_allocator  alloc = { utest_alloc, utest_realloc, utest_free, NULL };
+    binson_allocator  bad = { utest_alloc, utest_realloc, NULL, NULL };
+    binson           *obj;
+    binson_io        *io;
+    binson_writer    *writer;
+    binson_parser    *parser;
+    binson_path      *path;
+    binson_node      *node;
+    binson_res       res;
+    binson_raw_size  rs;
+    uint8_t          buf[512], *bytes;
+    char             *str, key[32];
+    int              i;
+
+    UNUSED(res);
+    alloc.param = &st;
+
+    res = binson_new_with_allocator( &obj, &bad );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+
+    res = binson_new_with_allocator( &obj, &alloc );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_new_with_allocator( &io, &alloc );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_init( io );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_writer_new_with_allocator( &writer, &alloc );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_new_with_allocator( &parser, &alloc );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_compile_with_allocator( "a.b", &path, &alloc );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( binson_get_allocator( obj )->param == &st );
+
+    /* tree storage and adopted payloads come from the allocator too */
+    for (i = 0; i < 5; i++)
+    {
+      sprintf( key, "long enough key %d", i );
+      res = binson_node_add_str( obj, binson_get_root( obj ), key, NULL, "and long enough string value" );
+      assert_int_equal(res, BINSON_RES_OK );
+    }
+    bytes = (uint8_t *)binson_get_allocator( obj )->alloc_cb( binson_get_allocator( obj )->param, 100 );
+    memset( bytes, 0x11, 100 );
+    res = binson_node_add_bytes_take( obj, binson_get_root( obj ), "blob", &node, bytes, 100 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj, binson_get_root( obj ), "str", &node, "string copied on take" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_take_string( obj, node, &str );  assert_int_equal(res, BINSON_RES_OK );
+    binson_get_allocator( obj )->free_cb( binson_get_allocator( obj )->param, str );
+
+    res = binson_io_attach_bytebuf( io, buf, sizeof(buf) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_writer_init( writer, io, BINSON_WRITER_FORMAT_RAW );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_serialize( obj, writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+
+    binson_io_seek( io, 0 );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( obj, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_child_by_key( obj, NULL, "blob", &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_non_null( node );
+
+    assert_true( st.allocs > 5 );
+    assert_true( st.live > 0 );
+
+    binson_path_free( path );
+    binson_parser_free( parser );
+    binson_writer_free( writer );
+    binson_io_free( io );
+    binson_free( obj );
+    assert_int_equal( st.live, 0 );
+}
+
+/************************************************************/
+static void utest_highlevel_limits(void **state) {
+    UNUSED(state);
+    binson_limits    lim = { 0, 10, 4 };
+    binson_stats     stats;
+    binson          *obj;
+    binson_io       *io;
+    binson_parser   *parser;
+    binson_writer   *writer;
+    binson_node     *node, *child;
+    binson_child_num cnt;
+    binson_res       res;
+    uint64_t         hash;
+    uint8_t         *out;
+    uint8_t          huge[] = { 0x40, 0x14, 0x01, 'a', 0x16, 0xff, 0xff, 0xff, 0x7f, 'x' };
+    uint8_t          nested[] = { 0x40, 0x14, 0x01, 'a', 0x40, 0x14, 0x01, 'x', 0x10, 0x01, 0x14, 0x01, 'y', 0x10, 0x02,
+                                  0x14, 0x01, 'z', 0x10, 0x03, 0x41, 0x41 };   /* {"a":{"x":1, "y":2, "z":3}} */
+    char             *str, key[16];
+    int              i;
+
+    UNUSED(res);
+    res = binson_new( &obj );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_limits( obj, &lim );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* root counts too */
+    for (i = 0; i < 3; i++)
+    {
+      res = binson_node_add_integer( obj, binson_get_root( obj ), i? "b" : "a", &node, i );
+      assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_node_add_integer( obj, binson_get_root( obj ), "c", NULL, 3 );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    res = binson_get_stats( obj, &stats );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( stats.nodes, 4 );
+    res = binson_node_remove( obj, node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_get_stats( obj, &stats );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( stats.nodes, 3 );
+
+    /* payload is checked before node is created, rejected buffer stays with caller */
+    res = binson_node_add_str( obj, binson_get_root( obj ), "s", NULL, "0123456789a" );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    res = binson_node_add_str_ref( obj, binson_get_root( obj ), "s", NULL, "0123456789a" );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    str = utest_strdup( "0123456789a" );
+    res = binson_node_add_str_take( obj, binson_get_root( obj ), "s", NULL, str );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    free( str );
+    res = binson_node_add_str( obj, binson_get_root( obj ), "s", NULL, "0123456789" );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_get_stats( obj, &stats );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( stats.nodes, 4 );
+
+    /* storage growth stops at the limit */
+    lim.max_token = 0;
+    lim.max_nodes = 0;
+    lim.max_bytes = BINSON_ARENA_BLOCK_SIZE + 1024;
+    res = binson_set_limits( obj, &lim );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( obj );  assert_int_equal(res, BINSON_RES_OK );
+    i = 0;
+    do
+    {
+      sprintf( key, "%d", i++ );
+      res = binson_node_add_str( obj, binson_get_root( obj ), key, NULL, "string which is long enough to be stored in arena" );
+    }
+    while (res == BINSON_RES_OK);
+    assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    res = binson_get_stats( obj, &stats );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( stats.bytes > BINSON_ARENA_BLOCK_SIZE && stats.bytes <= lim.max_bytes );
+    res = binson_node_get_child_by_key( obj, NULL, key, &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_null( node );   /* refused STRING is not left without payload */
+
+    /* optional caches don't fit, while output and hash are still produced */
+    out = (uint8_t *)malloc( 2 * lim.max_bytes );
+    res = binson_io_new( &io );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_init( io );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_attach_bytebuf( io, out, 2 * lim.max_bytes );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_writer_new( &writer );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_writer_init( writer, io, BINSON_WRITER_FORMAT_RAW );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_serialize_cache( obj, true );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_hash_cache( obj, true );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_serialize( obj, writer, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_hash( obj, NULL, &hash );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_serialize_cache( obj, false );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_hash_cache( obj, false );  assert_int_equal(res, BINSON_RES_OK );
+    binson_writer_free( writer );
+    binson_io_free( io );
+    free( out );
+
+    res = binson_set_limits( obj, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj, binson_get_root( obj ), "last", NULL, "string which is long enough to be stored in arena" );
+    assert_int_equal(res, BINSON_RES_OK );
+
+    /* parser refuses huge STRING before buffering it */
+    lim.max_bytes = 0;
+    lim.max_token = 1024;
+    res = binson_io_new( &io );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_init( io );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_attach_bytebuf( io, huge, sizeof(huge) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_new( &parser );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_set_limits( parser, &lim );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( obj, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    res = binson_parser_get_stats( parser, &stats );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( stats.bytes < lim.max_token );
+
+    /* lazy container stays intact when its children don't fit */
+    lim.max_bytes = 0;
+    lim.max_token = 0;
+    lim.max_nodes = 4;
+    res = binson_set_limits( obj, &lim );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_set_limits( parser, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_set_mode( parser, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_attach_bytebuf( io, nested, sizeof(nested) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( obj, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_OK );
+    node = binson_get_root( obj );
+    res = binson_node_get_first_child_ex( node, &node );  assert_int_equal(res, BINSON_RES_OK );
+    assert_non_null( node );
+    res = binson_node_get_first_child_ex( node, &child );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    assert_null( child );
+    res = binson_node_get_last_child_ex( node, &child );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    assert_null( binson_node_get_first_child( node ) );
+    res = binson_get_stats( obj, &stats );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( stats.nodes, 2 );
+
+    lim.max_nodes = 5;
+    res = binson_set_limits( obj, &lim );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_last_child_ex( node, &child );  assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( binson_node_get_key( child ), "z" );
+    res = binson_node_get_child_count( node, &cnt );  assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 3 );
+
+    binson_parser_free( parser );
+    binson_io_free( io );
+    binson_free( obj );
+}
+
+/************************************************************/
+static void utest_highlevel_depth(void **state) {
+    UNUSED(state);
+    binson          *obj, *copy;
+    binson_io       *io;
+    binson_writer   *writer;
+    binson_parser   *parser;
+    binson_node     *node;
+    binson_res       res;
+    binson_raw_size  rs;
+    uint8_t          buf[512];
+    uint64_t         hash;
+    bool             equal;
+    int              i;
+
+    UNUSED(res);
+    res = binson_new( &obj );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_new( &copy );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( copy, NULL );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_new( &io );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_init( io );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_attach_bytebuf( io, buf, sizeof(buf) );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_writer_new( &writer );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_writer_init( writer, io, BINSON_WRITER_FORMAT_RAW );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_new( &parser );  assert_int_equal(res, BINSON_RES_OK );
+
+    /* much deeper than initial size of nesting stacks */
+    node = binson_get_root( obj );
+    for (i = 0; i < 40; i++)
+    {
+      res = binson_node_add_integer( obj, node, "i", NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_object_empty( obj, node, "o", &node );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_serialize( obj, writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+
+    binson_io_seek( io, 0 );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( copy, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( obj ), binson_get_root( copy ), &equal );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( equal );
+
+    binson_io_seek( io, 0 );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( copy, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( obj ), binson_get_root( copy ), &equal );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( equal );
+
+    /* configured bounds */
+    binson_io_seek( io, 0 );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_DOM );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_set_max_depth( parser, 20 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( copy, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+
+    binson_io_seek( io, 0 );
+    res = binson_set_max_depth( copy, 20 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( copy, parser, NULL, NULL, false );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+
+    res = binson_set_max_depth( obj, 0 );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+    res = binson_set_max_depth( obj, 41 );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( io, 0 );
+    res = binson_serialize( obj, writer, &rs );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_set_max_depth( obj, 40 );  assert_int_equal(res, BINSON_RES_OK );
+    binson_io_seek( io, 0 );
+    res = binson_serialize( obj, writer, &rs );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+
+    /* copies between contexts follow bound of destination */
+    res = binson_reset( copy );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_merge( copy, NULL, obj, binson_get_root( obj ), BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    res = binson_set_max_depth( copy, 41 );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( copy );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_merge( copy, NULL, obj, binson_get_root( obj ), BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( obj ), binson_get_root( copy ), &equal );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( equal );
+
+    /* walks of very deep trees don't exhaust call stack */
+    res = binson_reset( obj );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_reset( copy );  assert_int_equal(res, BINSON_RES_OK );
+    for (i = 0; i < 2; i++)
+    {
+      binson  *o = i? copy : obj;
+      int      j;
+
+      node = binson_get_root( o );
+      for (j = 0; j < 100000; j++)
+      {
+        res = binson_node_add_object_empty( o, node, "o", &node );  assert_int_equal(res, BINSON_RES_OK );
+      }
+      res = binson_node_add_integer( o, node, "i", NULL, i );  assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_node_hash( obj, NULL, &hash );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+    res = binson_node_equal( binson_get_root( obj ), binson_get_root( copy ), &equal );  assert_int_equal(res, BINSON_RES_OK );
+    assert_false( equal );
+    res = binson_node_get_child_by_key( copy, node, "i", &node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_remove( copy, node );  assert_int_equal(res, BINSON_RES_OK );
+    node = binson_get_root( obj );
+    while (binson_node_get_first_child( node ))
+      node = binson_node_get_first_child( node );
+    res = binson_node_remove( obj, node );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_equal( binson_get_root( obj ), binson_get_root( copy ), &equal );  assert_int_equal(res, BINSON_RES_OK );
+    assert_true( equal );
+    res = binson_node_merge( copy, NULL, obj, binson_get_root( obj ), BINSON_MERGE_OVERWRITE );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+
+    binson_parser_free( parser );
+    binson_writer_free( writer );
+    binson_io_free( io );
+    binson_free( copy );
+    binson_free( obj );
+}
+
 /************************************************************/
 int utest_run_tests(void) {
   const struct CMUnitTest tests[] = {
             cmocka_unit_test_setup_teardown(utest_highlevel_tree_build, setup, teardown),
             cmocka_unit_test_setup_teardown(utest_highlevel_recycle, setup, teardown),            
+            cmocka_unit_test_setup_teardown(utest_highlevel_remove, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_append, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_lookup, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_index, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_inline, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_raw, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_lazy, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_clone_tree, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_serialize_cache, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_iter, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_hash, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_diff, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_merge, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_bulk, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_take, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_ref, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_compact, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_allocator, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_limits, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_highlevel_depth, setup, teardown),
   };
   
   return cmocka_run_group_tests(tests, global_setup, global_teardown);
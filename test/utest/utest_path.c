@@ -0,0 +1,165 @@
+/*
+ *	Test compiled path queries
+ */
+#include <string.h>
+
+#include "btest.h"
+
+#include "binson/binson.h"
+#include "binson/binson_path.h"
+
+// {"a":[true,13,-2.34,"zxc",{"d":false, "e":"0x030405", "q":"qwe"},9223372036854775807]}
+static const uint8_t sb1[]  = "\x40\x14\x01\x61\x42\x44\x10\x0d\x46\xb8\x1e\x85\xeb\x51\xb8\x02\xc0\x14\x03\x7a\x78\x63\x40\x14\x01\x64\x45\x14\x01\x65\x18\x03\x03\x04\x05\x14\x01\x71\x14\x03\x71\x77\x65\x41\x13\xff\xff\xff\xff\xff\xff\xff\x7f\x43\x41";
+
+static void utest_path_compile(void **state) {
+    (void) state;
+
+    binson_path  *path;
+    binson_res    res;
+    const char   *bad[] = { "a[", "a[]", "a[x]", "a[1", "a[1]b", "a\\", "[99999999999]", ".", "a.", "a..b", "a.[0]" };
+    const char   *good[] = { "", ".a", "a", "a.b.c", "a[0]", "[*]", "*", "a[12].*[3]", "\\*.\\.\\[", "a.\\." };
+
+    for (size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); i++)
+    {
+      res = binson_path_compile( bad[i], &path );   assert_int_equal(res, BINSON_RES_ERROR_PARSE_INVALID_INPUT );
+      assert_null( path );
+    }
+
+    for (size_t i = 0; i < sizeof(good)/sizeof(good[0]); i++)
+    {
+      res = binson_path_compile( good[i], &path );   assert_int_equal(res, BINSON_RES_OK );
+      assert_true( binson_path_get_size( path ) >= strlen( good[i] ) );
+      res = binson_path_free( path );   assert_int_equal(res, BINSON_RES_OK );
+    }
+
+    res = binson_path_compile( NULL, &path );   assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG );
+}
+
+static void utest_path_eval(void **state) {
+    (void) state;
+
+    binson         *obj;
+    binson_io      *io;
+    binson_parser  *parser;
+    binson_node    *top, *dev, *arr, *node, *found[8];
+    binson_path    *path;
+    binson_res      res;
+    size_t          cnt;
+    int64_t         ival;
+    char           *str;
+    char            key[16];
+    uint8_t         buf[sizeof(sb1)];
+
+    res = binson_new( &obj );         assert_int_equal(res, BINSON_RES_OK );
+    res = binson_init( obj, NULL );   assert_int_equal(res, BINSON_RES_OK );
+
+    /* {"device":{"id":"x", "sensors":[{"reading":0}, ... {"reading":19}], "k00":0, ... "k39":39}, ".":1} */
+    top = binson_get_root( obj );
+    res = binson_node_add_object_empty( obj, top, "device", &dev );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_str( obj, dev, "id", NULL, "x" );           assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_add_array_empty( obj, dev, "sensors", &arr );   assert_int_equal(res, BINSON_RES_OK );
+    for (int i = 0; i < 20; i++)
+    {
+      res = binson_node_add_object_empty( obj, arr, NULL, &node );    assert_int_equal(res, BINSON_RES_OK );
+      res = binson_node_add_integer( obj, node, "reading", NULL, i ); assert_int_equal(res, BINSON_RES_OK );
+    }
+    for (int i = 0; i < 40; i++)
+    {
+      sprintf( key, "k%02d", i );
+      res = binson_node_add_integer( obj, dev, key, NULL, i );        assert_int_equal(res, BINSON_RES_OK );
+    }
+    res = binson_node_add_integer( obj, top, ".", NULL, 1 );          assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_path_compile( "device.sensors[12].reading", &path );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );       assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 12 );
+
+    /* same program on other start node */
+    res = binson_path_eval( obj, path, dev, &node );    assert_int_equal(res, BINSON_RES_OK );
+    assert_null( node );
+    binson_path_free( path );
+
+    /* hash indexed OBJECT and missing keys */
+    res = binson_path_compile( "device.k33", &path );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_integer( node, &ival );       assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 33 );
+    binson_path_free( path );
+
+    res = binson_path_compile( "device.a", &path );     assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    assert_null( node );
+    binson_path_free( path );
+
+    res = binson_path_compile( "device.sensors[20]", &path );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    assert_null( node );
+    binson_path_free( path );
+
+    /* type mismatch gives no match */
+    res = binson_path_compile( "device[0]", &path );    assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    assert_null( node );
+    binson_path_free( path );
+
+    /* escaped key */
+    res = binson_path_compile( "\\.", &path );          assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( binson_node_get_key( node ), "." );
+    binson_path_free( path );
+
+    /* wildcards, limited by array size */
+    res = binson_path_compile( "device.sensors[*].reading", &path );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval_all( obj, path, NULL, found, 8, &cnt );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 8 );
+    res = binson_node_get_integer( found[7], &ival );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( ival, 7 );
+    binson_path_free( path );
+
+    res = binson_path_compile( "*.id", &path );         assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval_all( obj, path, NULL, found, 8, &cnt );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 1 );
+    res = binson_node_get_string( found[0], &str );     assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( str, "x" );
+    binson_path_free( path );
+
+    /* lazy containers are parsed on the way */
+    memcpy( buf, sb1, sizeof(sb1) );
+    res = binson_io_new( &io );                                      assert_int_equal(res, BINSON_RES_OK );
+    res = binson_io_attach_bytebuf( io, buf, sizeof(buf) );          assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_new( &parser );                              assert_int_equal(res, BINSON_RES_OK );
+    res = binson_parser_init( parser, io, BINSON_PARSER_MODE_SMART );  assert_int_equal(res, BINSON_RES_OK );
+    res = binson_deserialize( obj, parser, NULL, NULL, false );      assert_int_equal(res, BINSON_RES_OK );
+
+    res = binson_path_compile( "a[4].q", &path );       assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    res = binson_node_get_string( node, &str );         assert_int_equal(res, BINSON_RES_OK );
+    assert_string_equal( str, "qwe" );
+    binson_path_free( path );
+
+    res = binson_path_compile( "a[*].*", &path );       assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval_all( obj, path, NULL, found, 8, &cnt );   assert_int_equal(res, BINSON_RES_OK );
+    assert_int_equal( cnt, 3 );
+    assert_string_equal( binson_node_get_key( found[1] ), "e" );
+    binson_path_free( path );
+
+    res = binson_path_compile( "", &path );             assert_int_equal(res, BINSON_RES_OK );
+    res = binson_path_eval( obj, path, NULL, &node );   assert_int_equal(res, BINSON_RES_OK );
+    assert_ptr_equal( node, binson_get_root( obj ) );
+    binson_path_free( path );
+
+    binson_parser_free( parser );
+    binson_io_free( io );
+    res = binson_free( obj );   assert_int_equal(res, BINSON_RES_OK );
+}
+
+/************************************************************/
+int utest_run_tests(void) {
+  const struct CMUnitTest tests[] = {
+            cmocka_unit_test(utest_path_compile),
+            cmocka_unit_test(utest_path_eval),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
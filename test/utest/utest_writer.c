@@ -100,6 +100,44 @@ static void utest_binson_writer_write_array(void **state) {
   UTEST_WRITER_END("\x14\x01\x61\x42\x14\x08\x67\x72\xC3\xB6\xC3\x9F\x65\x72\x42\x43\x43");   
 }
 
+/************************************************************/
+static void utest_binson_writer_depth(void **state) {
+
+  binson_writer		*writer = *state;
+  binson_res		res = BINSON_RES_OK;
+  binson_raw_size	cnt=0;
+  int			i;
+
+  UNUSED(res);
+
+  /* nesting stacks grow past their initial size */
+  UTEST_WRITER_START();
+  binson_writer_set_format( writer, BINSON_WRITER_FORMAT_JSON );
+  for (i = 0; i < 40; i++)
+  {
+    res = binson_writer_write_array_begin( writer, NULL );  assert_int_equal(res, BINSON_RES_OK );
+  }
+  for (i = 0; i < 40; i++)
+  {
+    res = binson_writer_write_array_end( writer );  assert_int_equal(res, BINSON_RES_OK );
+  }
+  binson_io_get_write_counter( binson_writer_get_io( writer ), &cnt );
+  assert_int_equal(cnt, 40 * 6);   /* each bracket written with terminator */
+  assert_memory_equal(buf + 39 * 3, "[ \0] \0", 6);
+
+  res = binson_writer_write_array_end( writer );  assert_int_equal(res, BINSON_RES_ERROR_ARG_WRONG_COMB );
+
+  UTEST_WRITER_START();
+  binson_writer_set_format( writer, BINSON_WRITER_FORMAT_RAW );
+  res = binson_writer_set_max_depth( writer, 2 );  assert_int_equal(res, BINSON_RES_OK );
+  binson_writer_write_object_begin( writer, NULL );
+  binson_writer_write_array_begin( writer, "a" );
+  res = binson_writer_write_array_begin( writer, NULL );  assert_int_equal(res, BINSON_RES_ERROR_LIMIT_EXCEEDED );
+  binson_writer_write_array_end( writer );
+  binson_writer_write_object_end( writer );
+  UTEST_WRITER_END("\x40\x14\x01\x61\x42\x43\x41");
+}
+
 /************************************************************/
 static void utest_binson_writer_write_boolean(void **state) {
   (void) state;
@@ -313,6 +351,7 @@ int utest_run_tests(void) {
   const struct CMUnitTest tests[] = {
             cmocka_unit_test_setup_teardown(utest_binson_writer_write_object, setup, teardown),
             cmocka_unit_test_setup_teardown(utest_binson_writer_write_array, setup, teardown),
+            cmocka_unit_test_setup_teardown(utest_binson_writer_depth, setup, teardown),
             cmocka_unit_test_setup_teardown(utest_binson_writer_write_boolean, setup, teardown),
             cmocka_unit_test_setup_teardown(utest_binson_writer_write_integer, setup, teardown),
             cmocka_unit_test_setup_teardown(utest_binson_writer_write_double, setup, teardown),